@@ -0,0 +1,342 @@
+/* baseline.c - saving bench results as a baseline and comparing against it.
+ *
+ * With --save-baseline or --compare, funit has each test program append the
+ * raw samples of its benches to a scratch file, one CSV line per bench (and
+ * sweep value), with times in seconds per iteration:
+ *
+ *     "set","bench","param",value,t1,t2,...
+ *
+ * A saved baseline is just a copy of those lines.  Comparing matches each
+ * bench to its line in the baseline by name, and calls it changed if its
+ * median time moved by more than the threshold and a Mann-Whitney U test
+ * says the two sets of samples really differ.
+ */
+#include "funit.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+// how unlikely a difference must be by chance to count
+#define SIGNIFICANCE 0.05
+
+/* Reads one CSV field at *s, quoted (with "" for a quote) or not, into sb
+ * and moves *s past it and its comma.  Returns -1 if the field is bad.
+ */
+static int read_csv_field(char **s, struct StringBuffer *sb)
+{
+    char *p = *s;
+
+    sb->len = 0;
+    if (*p == '"') {
+        for (p++; ; p++) {
+            if (*p == '\0' || *p == '\n')
+                return -1;
+            if (*p == '"') {
+                if (p[1] != '"')
+                    break;
+                p++; // doubled
+            }
+            sb_add_char(sb, *p);
+        }
+        p++;
+    } else {
+        for (; *p && *p != ',' && *p != '\n'; p++)
+            sb_add_char(sb, *p);
+    }
+    if (*p == ',')
+        p++;
+    else if (*p && *p != '\n')
+        return -1;
+    *s = p;
+    sb_add_char(sb, '\0');
+    return 0;
+}
+
+/* Parses a line of samples.  Returns NULL if it is bad.
+ */
+static struct BenchSamples *parse_samples_line(char *line)
+{
+    struct BenchSamples *bs = NULL;
+    struct StringBuffer field, key;
+    size_t cap = 32;
+    char *s = line;
+
+    sb_init(&field, 64);
+    sb_init(&key, 64);
+
+    // "set/bench" or "set/bench (n = 1000)", as the test program reports it
+    if (read_csv_field(&s, &field) || !field.s[0])
+        goto done;
+    sb_add_str(&key, field.s);
+    sb_add_char(&key, '/');
+    if (read_csv_field(&s, &field) || !field.s[0])
+        goto done;
+    sb_add_str(&key, field.s);
+    if (read_csv_field(&s, &field))
+        goto done;
+    if (field.s[0]) {
+        sb_add_str(&key, " (");
+        sb_add_str(&key, field.s);
+        sb_add_str(&key, " = ");
+        if (read_csv_field(&s, &field))
+            goto done;
+        sb_add_str(&key, field.s);
+        sb_add_char(&key, ')');
+    } else if (read_csv_field(&s, &field)) {
+        goto done;
+    }
+    sb_add_char(&key, '\0');
+
+    bs = NEW0(struct BenchSamples);
+    bs->key = fu_strdup(key.s);
+    bs->t = NEWA(double, cap);
+    while (*s && *s != '\n') {
+        char *end;
+        if (read_csv_field(&s, &field))
+            goto bad;
+        if (bs->n == cap) {
+            cap += cap;
+            bs->t = realloc(bs->t, cap * sizeof(double));
+            if (!bs->t) abort(); // XXX or handle allocation better?
+        }
+        bs->t[bs->n] = strtod(field.s, &end);
+        if (end == field.s || *end)
+            goto bad;
+        bs->n++;
+    }
+    if (bs->n > 0)
+        goto done;
+ bad:
+    free_bench_samples(bs);
+    bs = NULL;
+ done:
+    sb_free(&key);
+    sb_free(&field);
+    return bs;
+}
+
+/* Reads the samples in the file at path into *list, in file order.
+ * Returns 0 on success, or -1 after reporting an error to err.
+ */
+int read_bench_samples(const char *path, struct BenchSamples **list,
+                       FILE *err)
+{
+    struct BenchSamples **tail = list;
+    char *line = NULL;
+    size_t cap = 0;
+    long lineno = 0;
+    FILE *f;
+
+    *list = NULL;
+    f = fopen(path, "r");
+    if (!f) {
+        fprintf(err, "FUnit: could not open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    while (getline(&line, &cap, f) != -1) {
+        lineno++;
+        if (line[0] == '\n' || line[0] == '\0')
+            continue;
+        struct BenchSamples *bs = parse_samples_line(line);
+        if (!bs) {
+            fprintf(err, "%s:%li: Error: bad bench samples\n", path, lineno);
+            free(line);
+            fclose(f);
+            free_bench_samples(*list);
+            *list = NULL;
+            return -1;
+        }
+        *tail = bs;
+        tail = &bs->next;
+    }
+    free(line);
+    fclose(f);
+    return 0;
+}
+
+void free_bench_samples(struct BenchSamples *bs)
+{
+    while (bs) {
+        struct BenchSamples *next = bs->next;
+        free(bs->key);
+        free(bs->t);
+        free(bs);
+        bs = next;
+    }
+}
+
+/* Copies the samples file to the baseline file, making its directory if
+ * need be.  Returns 0 on success, or -1 after reporting an error to err.
+ */
+int save_baseline(const char *samples_path, const char *baseline_path,
+                  FILE *err)
+{
+    char dir[PATH_MAX + 1], buf[8192];
+    char *slash;
+    FILE *in, *out;
+    size_t n;
+    int ret = 0;
+
+    snprintf(dir, sizeof(dir), "%s", baseline_path);
+    slash = strrchr(dir, '/');
+    if (slash) {
+        *slash = '\0';
+        if (mkdir(dir, 0777) && errno != EEXIST) {
+            fprintf(err, "FUnit: could not create the baseline directory "
+                    "%s: %s\n", dir, strerror(errno));
+            return -1;
+        }
+    }
+
+    in = fopen(samples_path, "r");
+    if (!in) {
+        fprintf(err, "FUnit: could not open %s: %s\n", samples_path,
+                strerror(errno));
+        return -1;
+    }
+    out = fopen(baseline_path, "w");
+    if (!out) {
+        fprintf(err, "FUnit: could not open %s for writing: %s\n",
+                baseline_path, strerror(errno));
+        fclose(in);
+        return -1;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (fwrite(buf, 1, n, out) != n)
+            break;
+    }
+    if (ferror(in) || ferror(out)) {
+        fprintf(err, "FUnit: error copying %s to %s\n", samples_path,
+                baseline_path);
+        ret = -1;
+    }
+    fclose(in);
+    if (fclose(out))
+        ret = -1;
+    return ret;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(const double *t, size_t n)
+{
+    double *s = NEWA(double, n), m;
+
+    memcpy(s, t, n * sizeof(double));
+    qsort(s, n, sizeof(double), compare_doubles);
+    m = (s[(n - 1) / 2] + s[n / 2]) / 2;
+    free(s);
+    return m;
+}
+
+/* The two-sided p-value of a Mann-Whitney U test that samples a and b come
+ * from the same distribution, by the normal approximation with a correction
+ * for ties, which is close enough for the 20 or so samples of a bench.
+ */
+static double mann_whitney_p(const double *a, size_t na,
+                             const double *b, size_t nb)
+{
+    size_t n = na + nb, i, j;
+    double *all = NEWA(double, n);
+    double rank_sum = 0, ties = 0, u, mu, sigma, z;
+
+    if (na == 0 || nb == 0) {
+        free(all);
+        return 1;
+    }
+    memcpy(all, a, na * sizeof(double));
+    memcpy(all + na, b, nb * sizeof(double));
+    qsort(all, n, sizeof(double), compare_doubles);
+
+    // sum of a's ranks, ties getting the mean of the ranks they span
+    for (i = 0; i < n; i = j) {
+        double rank, t;
+        size_t k;
+
+        for (j = i + 1; j < n && all[j] == all[i]; j++)
+            ;
+        t = j - i;
+        ties += t * t * t - t;
+        rank = (i + 1 + j) / 2.0;
+        for (k = 0; k < na; k++) {
+            if (a[k] == all[i])
+                rank_sum += rank;
+        }
+    }
+    free(all);
+
+    u = rank_sum - na * (na + 1) / 2.0;
+    mu = na * nb / 2.0;
+    sigma = sqrt(na * nb / 12.0 * ((n + 1) - ties / (n * (n - 1.0))));
+    if (sigma == 0)
+        return 1; // every sample the same
+    z = fabs(u - mu) - 0.5; // continuity correction
+    if (z < 0)
+        z = 0;
+    return erfc(z / sigma / sqrt(2));
+}
+
+// e.g. "  2.296 us", as the test programs print times
+static void print_time(FILE *out, double t)
+{
+    if (t >= 1)
+        fprintf(out, "%7.3f s ", t);
+    else if (t >= 1e-3)
+        fprintf(out, "%7.3f ms", t * 1e3);
+    else if (t >= 1e-6)
+        fprintf(out, "%7.3f us", t * 1e6);
+    else
+        fprintf(out, "%7.3f ns", t * 1e9);
+}
+
+/* Reports how each bench in now changed from base to out.  A bench is
+ * regressed (or improved) if its median time per iteration grew (or shrank)
+ * by more than threshold percent, and the change is significant.  Returns
+ * the number of benches that regressed.
+ */
+int compare_bench_samples(struct BenchSamples *now, struct BenchSamples *base,
+                          double threshold, FILE *out)
+{
+    int width = 0, regressed = 0;
+
+    for (struct BenchSamples *bs = now; bs; bs = bs->next)
+        width = MAX(width, (int)strlen(bs->key));
+
+    for (; now; now = now->next) {
+        struct BenchSamples *old = base;
+        while (old && strcmp(old->key, now->key))
+            old = old->next;
+
+        fprintf(out, "  %-*s  ", width, now->key);
+        if (!old) {
+            fputs("not in the baseline\n", out);
+            continue;
+        }
+
+        double m_old = median(old->t, old->n), m_now = median(now->t, now->n);
+        double change = m_old > 0 ? (m_now / m_old - 1) * 100 : 0;
+        double p = mann_whitney_p(now->t, now->n, old->t, old->n);
+        const char *verdict = "no change";
+        if (p < SIGNIFICANCE && change > threshold) {
+            verdict = "REGRESSED";
+            regressed++;
+        } else if (p < SIGNIFICANCE && change < -threshold) {
+            verdict = "improved";
+        }
+
+        print_time(out, m_old);
+        fputs(" -> ", out);
+        print_time(out, m_now);
+        fprintf(out, "  %+6.1f%%  p = %.4f  %s\n", change, p, verdict);
+    }
+    return regressed;
+}
@@ -0,0 +1,187 @@
+/* bench_env.c - quieting the machine for bench runs, and describing it.
+ *
+ * With --cpus and --nice, funit pins the test programs it runs benches in
+ * to some CPUs and changes their priority, so other work on the machine
+ * disturbs them less.  It does both to the thread that starts the programs,
+ * which they inherit, and undoes them after.  It also notes the frequency
+ * governor and speed of the CPU the benches run on, since both change
+ * bench times a lot.
+ */
+#define _GNU_SOURCE
+#include "funit.h"
+
+#include <sys/resource.h>
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+
+static cpu_set_t saved_cpus;
+static int saved_nice;
+static int pinned, reniced;
+
+/* Parses a CPU list like "0-3,6" into set.  Returns 0 on success, or -1
+ * after reporting an error to err.
+ */
+static int parse_cpu_list(const char *list, cpu_set_t *set, FILE *err)
+{
+    const char *s = list;
+    char *end;
+
+    CPU_ZERO(set);
+    do {
+        long first, last;
+
+        first = last = strtol(s, &end, 10);
+        if (end == s || first < 0)
+            goto bad;
+        s = end;
+        if (*s == '-') {
+            last = strtol(++s, &end, 10);
+            if (end == s || last < first)
+                goto bad;
+            s = end;
+        }
+        if (last >= CPU_SETSIZE) {
+            fprintf(err, "FUnit: there is no CPU %li\n", last);
+            return -1;
+        }
+        for (long cpu = first; cpu <= last; cpu++)
+            CPU_SET(cpu, set);
+    } while (*s++ == ',');
+    if (s[-1] == '\0')
+        return 0;
+ bad:
+    fprintf(err, "FUnit: '%s' is not a list of CPUs like 0-3,6\n", list);
+    return -1;
+}
+
+/* Checks that a CPU list given on the command line can be parsed.
+ */
+int check_cpu_list(const char *list, FILE *err)
+{
+    cpu_set_t set;
+
+    return parse_cpu_list(list, &set, err);
+}
+
+/* Pins the calling thread to the CPUs in list, unless it is NULL, and sets
+ * its nice value to nice if set_nice, for the benches it starts.  Returns
+ * 0 on success, or -1 after reporting an error to err; failing to get a
+ * higher priority is only warned about, as it takes privileges.
+ */
+int enter_bench_env(const char *list, int set_nice, int nice, FILE *err)
+{
+    if (list) {
+        cpu_set_t set;
+
+        if (parse_cpu_list(list, &set, err))
+            return -1;
+        if (sched_getaffinity(0, sizeof(saved_cpus), &saved_cpus) ||
+            sched_setaffinity(0, sizeof(set), &set)) {
+            fprintf(err, "FUnit: could not pin the benches to CPUs %s: %s\n",
+                    list, strerror(errno));
+            return -1;
+        }
+        pinned = TRUE;
+    }
+
+    if (set_nice) {
+        errno = 0;
+        saved_nice = getpriority(PRIO_PROCESS, 0);
+        if (errno == 0 && setpriority(PRIO_PROCESS, 0, nice) == 0)
+            reniced = TRUE;
+        else
+            fprintf(err, "FUnit: warning: could not run the benches at nice "
+                    "%i: %s\n", nice, strerror(errno));
+    }
+    return 0;
+}
+
+/* Undoes enter_bench_env.
+ */
+void leave_bench_env(void)
+{
+    if (pinned)
+        sched_setaffinity(0, sizeof(saved_cpus), &saved_cpus);
+    if (reniced)
+        setpriority(PRIO_PROCESS, 0, saved_nice);
+    pinned = reniced = FALSE;
+}
+
+/* Reads the first line of the file at path into buf, without its newline.
+ * Returns -1 if it can't.
+ */
+static int read_line(const char *path, char *buf, size_t size)
+{
+    FILE *f = fopen(path, "r");
+    int ret = -1;
+
+    if (!f)
+        return -1;
+    if (fgets(buf, size, f)) {
+        buf[strcspn(buf, "\n")] = '\0';
+        ret = 0;
+    }
+    fclose(f);
+    return ret;
+}
+
+/* The current speed of cpu in MHz from /proc/cpuinfo, or 0 if it isn't
+ * there.
+ */
+static double cpuinfo_mhz(int cpu)
+{
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    char line[256];
+    int this_cpu = -1;
+    double mhz = 0;
+
+    if (!f)
+        return 0;
+    while (fgets(line, sizeof(line), f)) {
+        char *colon = strchr(line, ':');
+
+        if (!colon)
+            continue;
+        if (!strncmp(line, "processor", 9)) {
+            this_cpu = atoi(colon + 1);
+        } else if (this_cpu == cpu && !strncmp(line, "cpu MHz", 7)) {
+            mhz = strtod(colon + 1, NULL);
+            break;
+        }
+    }
+    fclose(f);
+    return mhz;
+}
+
+/* Describes the first CPU the calling thread may run on, and so the
+ * benches it starts: its number, its frequency governor in governor (""
+ * if unknown) and its current speed in MHz (0 if unknown).  Returns the
+ * CPU's number.
+ */
+int describe_bench_cpu(char *governor, size_t size, double *mhz)
+{
+    char path[128], buf[64];
+    cpu_set_t set;
+    int cpu = 0;
+
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        while (cpu < CPU_SETSIZE - 1 && !CPU_ISSET(cpu, &set))
+            cpu++;
+    }
+
+    governor[0] = '\0';
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%i/cpufreq/scaling_governor", cpu);
+    read_line(path, governor, size);
+
+    *mhz = 0;
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%i/cpufreq/scaling_cur_freq", cpu);
+    if (read_line(path, buf, sizeof(buf)) == 0)
+        *mhz = strtod(buf, NULL) / 1000; // in kHz
+    if (*mhz <= 0)
+        *mhz = cpuinfo_mhz(cpu);
+    return cpu;
+}
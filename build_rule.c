@@ -69,6 +69,10 @@ static void expand_src_f(struct StringBuffer *sb,
                          const struct TestFile *tf,
                          const struct Config *conf)
 {
+    if (tf->src_f) { // generated code not in the usual place, e.g. in memory
+        sb_add_str(sb, tf->src_f);
+        return;
+    }
     expand_src(sb, tf, conf);
     // append fortran ext
     sb_add_nstr(sb, conf->fortran_ext, conf->fortran_ext_len);
@@ -120,7 +124,8 @@ static void expand_deps(struct StringBuffer *sb,
         set = set->next;
     }
 
-    if (n_deps == 0) return; // nothing to add? done!
+    if (n_deps == 0 && !tf->perf_c && !tf->memory_c && !tf->modules_o)
+        return; // nothing to add? done!
 
     char **deps = NEWA(char *, n_deps);
 
@@ -134,6 +139,20 @@ static void expand_deps(struct StringBuffer *sb,
             }
         }
     }
+    // and the C helpers the test program is built with
+    if (tf->perf_c) {
+        sb_add_str(sb, tf->perf_c);
+        sb_add_char(sb, ' ');
+    }
+    if (tf->memory_c) {
+        sb_add_str(sb, tf->memory_c);
+        sb_add_char(sb, ' ');
+    }
+    // and the funit modules, if they are built once for all the programs
+    if (tf->modules_o) {
+        sb_add_str(sb, tf->modules_o);
+        sb_add_char(sb, ' ');
+    }
     sb->len--; // remove trailing space
 
     free(deps);
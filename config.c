@@ -23,6 +23,7 @@ static int try_open_file(const char *path, struct ParseState *ps)
         return -1;
     }
 
+    ps->err = stderr;
     return open_file_for_parsing(path, ps);
 }
 
@@ -177,12 +178,33 @@ static int parse_config_setting(struct ParseState *ps, struct Config *conf)
     if (keylen == 5 && !strncmp("build", key, 5)) {
         conf->build = value;
         conf->build_len = valuelen;
+    } else if (keylen == 12 && !strncmp("module_build", key, 12)) {
+        conf->module_build = value;
+        conf->module_build_len = valuelen;
     } else if (keylen == 11 && !strncmp("fortran_ext", key, 11)) {
         conf->fortran_ext = value;
         conf->fortran_ext_len = valuelen;
     } else if (keylen == 12 && !strncmp("template_ext", key, 12)) {
         conf->template_ext = value;
         conf->template_ext_len = valuelen;
+    } else if (keylen == 9 && !strncmp("cache_dir", key, 9)) {
+        conf->cache_dir = value;
+        conf->cache_dir_len = valuelen;
+    } else if (keylen == 12 && !strncmp("baseline_dir", key, 12)) {
+        conf->baseline_dir = value;
+        conf->baseline_dir_len = valuelen;
+    } else if (keylen == 15 && !strncmp("bench_threshold", key, 15)) {
+        char *end;
+        conf->bench_threshold = strtod(value, &end);
+        if (end == value || (*end && strcmp(end, "%")) ||
+            conf->bench_threshold < 0) {
+            fprintf(stderr, "%s:%li: Error: bench_threshold must be a "
+                    "percentage, e.g. 5 or 2.5%%, not '%s'\n", ps->path,
+                    ps->lineno, value);
+            free(value);
+            return -1;
+        }
+        free(value);
     } else {
         free(value);
 
@@ -240,6 +262,12 @@ static void set_defaults(struct Config *conf)
     }
     conf->build_fragments = parse_build_rule(conf->build);
 
+    // no default module_build: the modules go in each test program
+    if (conf->module_build) {
+        SELF_STRNDUP(conf->module_build);
+        conf->module_build_fragments = parse_build_rule(conf->module_build);
+    }
+
     if (!conf->fortran_ext) {
         conf->fortran_ext = fu_strdup(".F90");
         conf->fortran_ext_len = 4;
@@ -253,6 +281,18 @@ static void set_defaults(struct Config *conf)
     } else {
         SELF_STRNDUP(conf->template_ext);
     }
+
+    // no default cache_dir: parse caching is off unless configured
+    if (conf->cache_dir) {
+        SELF_STRNDUP(conf->cache_dir);
+    }
+
+    if (!conf->baseline_dir) {
+        conf->baseline_dir = fu_strdup(".funit-baselines");
+        conf->baseline_dir_len = 16;
+    } else {
+        SELF_STRNDUP(conf->baseline_dir);
+    }
 }
 
 int read_config(struct Config *conf)
@@ -262,6 +302,7 @@ int read_config(struct Config *conf)
     int r;
 
     memset(conf, 0, sizeof(struct Config));
+    conf->bench_threshold = DEFAULT_BENCH_THRESHOLD;
 
     if (find_config_file(config_path, &ps)) {
         fprintf(stderr, "FUnit: warning: config file not found\n");
@@ -273,6 +314,11 @@ int read_config(struct Config *conf)
 
     if (r == 0) {
         set_defaults(conf);
+        if (conf->module_build && !conf->cache_dir) {
+            fprintf(stderr, "FUnit: module_build needs a cache_dir to keep "
+                    "the built modules in\n");
+            r = -1;
+        }
     }
 
     return r;
@@ -284,6 +330,11 @@ void free_config(struct Config *conf)
 
     free(conf->build);
     free_build_fragments(conf->build_fragments);
+    free(conf->module_build);
+    if (conf->module_build_fragments)
+        free_build_fragments(conf->module_build_fragments);
     free(conf->fortran_ext);
     free(conf->template_ext);
+    free(conf->cache_dir);
+    free(conf->baseline_dir);
 }
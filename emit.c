@@ -0,0 +1,339 @@
+/* emit.c - buffered, mostly zero-copy output for the code generator.
+ *
+ * Generated code is nearly all either literal snippets from the generator or
+ * spans of Fortran copied out of the mmap()ed template.  Rather than pushing
+ * each through stdio, the Emitter records them as a list of spans pointing
+ * at the original bytes; only printf-formatted text is copied, into a
+ * scratch buffer.  The finished list is handed out as iovecs, either to
+ * writev() or to a caller-supplied consumer.
+ *
+ * Spans are not copied, so whatever they point to (string literals, the
+ * template mapping) must outlive the Emitter.
+ */
+#ifdef __linux__
+#define _GNU_SOURCE // for memfd_create()
+#endif
+#include "funit.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define EMIT_IOV_BATCH 1024
+
+#if defined(IOV_MAX) && IOV_MAX < EMIT_IOV_BATCH
+#undef EMIT_IOV_BATCH
+#define EMIT_IOV_BATCH IOV_MAX
+#endif
+
+void emit_init(struct Emitter *em)
+{
+    em->cap = 256;
+    em->n = 0;
+    em->spans = NEWA(struct EmitSpan, em->cap);
+    sb_init(&em->scratch, 1024);
+    em->len = 0;
+}
+
+void emit_free(struct Emitter *em)
+{
+    free(em->spans);
+    sb_free(&em->scratch);
+}
+
+static struct EmitSpan *last_span(struct Emitter *em)
+{
+    return em->n > 0 ? &em->spans[em->n - 1] : NULL;
+}
+
+static struct EmitSpan *new_span(struct Emitter *em)
+{
+    if (em->n == em->cap) {
+        em->cap += em->cap;
+        em->spans = realloc(em->spans, em->cap * sizeof(struct EmitSpan));
+        if (!em->spans) abort(); // XXX or handle allocation better?
+    }
+    return &em->spans[em->n++];
+}
+
+/* Appends len bytes at s without copying them.  Runs of bytes that are
+ * adjacent in memory (e.g. consecutive template code) become one span.
+ */
+void emit_span(struct Emitter *em, const char *s, size_t len)
+{
+    struct EmitSpan *span = last_span(em);
+
+    if (len == 0) return;
+
+    em->len += len;
+    if (span && span->s && span->s + span->len == s) {
+        span->len += len;
+        return;
+    }
+    span = new_span(em);
+    span->s = s;
+    span->off = 0;
+    span->len = len;
+}
+
+void emit_str(struct Emitter *em, const char *s)
+{
+    emit_span(em, s, strlen(s));
+}
+
+/* Appends formatted text.  This is the only kind of output that is copied.
+ */
+void emit_printf(struct Emitter *em, const char *format, ...)
+{
+    struct EmitSpan *span;
+    va_list ap;
+    size_t off = em->scratch.len;
+    int n;
+
+    va_start(ap, format);
+    n = vsnprintf(NULL, 0, format, ap);
+    va_end(ap);
+    if (n <= 0) return;
+
+    // one more for vsnprintf's nul, which is then dropped
+    sb_ensure(&em->scratch, n + 1);
+    va_start(ap, format);
+    vsnprintf(em->scratch.s + off, n + 1, format, ap);
+    va_end(ap);
+    em->scratch.len += n;
+    em->len += n;
+
+    span = last_span(em);
+    if (span && !span->s && span->off + span->len == off) {
+        span->len += n;
+        return;
+    }
+    span = new_span(em);
+    span->s = NULL;
+    span->off = off;
+    span->len = n;
+}
+
+/* Passes the emitted output to consumer in order, in batches of iovecs.
+ * Stops and returns the consumer's result if it is non-zero.
+ */
+int emit_consume(struct Emitter *em, emit_consumer *consumer, void *data)
+{
+    struct iovec iov[EMIT_IOV_BATCH];
+    size_t i = 0;
+    int n, r;
+
+    while (i < em->n) {
+        for (n = 0; n < EMIT_IOV_BATCH && i < em->n; n++, i++) {
+            struct EmitSpan *span = &em->spans[i];
+            iov[n].iov_base = (void *)(span->s ? span->s
+                                       : em->scratch.s + span->off);
+            iov[n].iov_len = span->len;
+        }
+        r = consumer(data, iov, n);
+        if (r) return r;
+    }
+    return 0;
+}
+
+static int writev_consumer(void *data, const struct iovec *iov, int iovcnt)
+{
+    int fd = *(int *)data;
+    struct iovec rest[EMIT_IOV_BATCH], *v = rest;
+    ssize_t n;
+
+    memcpy(rest, iov, iovcnt * sizeof(struct iovec));
+    while (iovcnt > 0) {
+        n = writev(fd, v, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        // skip what was written, resuming partway into an iovec if need be
+        while (iovcnt > 0 && (size_t)n >= v->iov_len) {
+            n -= v->iov_len;
+            v++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            v->iov_base = (char *)v->iov_base + n;
+            v->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+/* Writes all the emitted output to fd with writev().  Returns 0 on success
+ * or -1 with errno set.
+ */
+int emit_writev(struct Emitter *em, int fd)
+{
+    return emit_consume(em, writev_consumer, &fd);
+}
+
+static int compare_consumer(void *data, const struct iovec *iov, int iovcnt)
+{
+    const char **old = (const char **)data;
+
+    for (int i = 0; i < iovcnt; i++) {
+        if (memcmp(*old, iov[i].iov_base, iov[i].iov_len))
+            return 1; // differs
+        *old += iov[i].iov_len;
+    }
+    return 0;
+}
+
+/* Returns TRUE if the file described by fd and statbuf holds exactly the
+ * emitted output.
+ */
+static int same_content(struct Emitter *em, int fd, const struct stat *statbuf)
+{
+    const char *old;
+    void *map;
+    int same;
+
+    if ((size_t)statbuf->st_size != em->len)
+        return FALSE;
+    if (em->len == 0)
+        return TRUE;
+
+    map = mmap(NULL, em->len, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return FALSE; // just rewrite it
+    old = (const char *)map;
+    same = !emit_consume(em, compare_consumer, &old);
+    munmap(map, em->len);
+
+    return same;
+}
+
+/* Writes the emitted output to path, unless path already holds exactly that
+ * output, in which case it is left alone (mtime and all) so downstream
+ * builds see nothing to redo.  A changed file is written to a temporary file
+ * next to path and renamed over it, so readers never see a partial file.
+ * Returns 1 if the file was written, 0 if it was already up to date, or -1
+ * after reporting an error to err.
+ */
+int emit_write_file(struct Emitter *em, const char *path, FILE *err)
+{
+    char tmp_path[PATH_MAX + 1];
+    struct stat statbuf;
+    mode_t mode = 0666;
+    int fd, same;
+
+    fd = open(path, O_RDONLY);
+    if (fd != -1) {
+        if (fstat(fd, &statbuf) == 0) {
+            same = same_content(em, fd, &statbuf);
+            mode = statbuf.st_mode & 07777;
+        } else {
+            same = FALSE;
+        }
+        close(fd);
+        if (same)
+            return 0;
+    }
+
+    // unique among processes and among threads (em is live until we return)
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.%ld-%lx.tmp", path,
+                 (long)getpid(), (unsigned long)(size_t)em)
+        >= (int)sizeof(tmp_path)) {
+        fprintf(err, "FUnit: the file name '%s' is too long\n", path);
+        return -1;
+    }
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, mode);
+    if (fd == -1) {
+        fprintf(err, "FUnit: could not open %s for writing: %s\n", tmp_path,
+                strerror(errno));
+        return -1;
+    }
+    if (emit_writev(em, fd)) {
+        fprintf(err, "FUnit: error writing %s: %s\n", tmp_path,
+                strerror(errno));
+        close(fd);
+        goto error;
+    }
+    if (close(fd)) {
+        fprintf(err, "FUnit: error closing %s: %s\n", tmp_path,
+                strerror(errno));
+        goto error;
+    }
+    if (rename(tmp_path, path)) {
+        fprintf(err, "FUnit: could not rename %s to %s: %s\n", tmp_path,
+                path, strerror(errno));
+        goto error;
+    }
+    return 1;
+ error:
+    unlink(tmp_path);
+    return -1;
+}
+
+/* Writes the emitted output to an anonymous file that never appears in the
+ * file system: a memfd where the system has them, otherwise a temporary file
+ * that is unlinked straight away.  name is only a label for debugging.  The
+ * descriptor is closed on exec(), so other children don't pile them up; the
+ * caller clears that in the one child that reads the file, through the
+ * /proc/self/fd or /dev/fd path stored in path.  Returns the descriptor, to
+ * be closed by the caller, or -1 after reporting an error.
+ */
+int emit_memory_file(struct Emitter *em, const char *name, char *path,
+                     size_t path_size, FILE *err)
+{
+    const char *fd_dir = "/dev/fd";
+    int fd = -1;
+
+#ifdef MFD_CLOEXEC
+    fd = memfd_create(name, MFD_CLOEXEC);
+    if (fd != -1)
+        fd_dir = "/proc/self/fd";
+#endif
+    if (fd == -1) { // no memfd support in the kernel or the C library
+        const char *tmpdir = getenv("TMPDIR");
+        char tmp_path[PATH_MAX + 1];
+
+        if (!tmpdir || !*tmpdir)
+            tmpdir = "/tmp";
+        if (snprintf(tmp_path, sizeof(tmp_path), "%s/funit-XXXXXX", tmpdir)
+            >= (int)sizeof(tmp_path)) {
+            fprintf(err, "FUnit: the directory name '%s' is too long\n",
+                    tmpdir);
+            return -1;
+        }
+#ifdef __linux__
+        fd = mkostemp(tmp_path, O_CLOEXEC);
+#else
+        fd = mkstemp(tmp_path);
+        if (fd != -1)
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+        if (fd == -1) {
+            fprintf(err, "FUnit: could not create a temporary file in %s: "
+                    "%s\n", tmpdir, strerror(errno));
+            return -1;
+        }
+        unlink(tmp_path);
+    }
+
+    if (emit_writev(em, fd)) {
+        fprintf(err, "FUnit: error writing generated code for %s: %s\n",
+                name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    // readers open their own description of the file, but rewind anyway
+    // for any that inherit this one
+    lseek(fd, 0, SEEK_SET);
+    snprintf(path, path_size, "%s/%i", fd_dir, fd);
+
+    return fd;
+}
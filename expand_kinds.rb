@@ -0,0 +1,48 @@
+#!/usr/bin/env ruby
+# expand_kinds.rb - write out a Fortran template's code for each kind
+# Usage: expand_kinds.rb <template >fortran_file
+#
+# "!@ list NAME = KIND:TYPE ..." adds kinds to the list NAME.  The lines
+# between "!@ each KIND:TYPE in NAME..." and "!@ end each" are repeated for
+# each kind in the lists, with @KIND@ and @TYPE@ replaced by its fields.
+# A "!@" line ending in "&" is continued on the next "!@" line.
+
+lists = {}
+block = nil
+
+while (line = STDIN.gets)
+  while line =~ /^\s*!@.*&$/
+    more = STDIN.gets
+    abort "#{$.}: no !@ line after &" unless more =~ /^\s*!@\s*(.*)$/m
+    line = line.chomp.chomp("&") + $1
+  end
+  case line
+  when /^\s*!@ list (\w+) = (.*)$/
+    (lists[$1] ||= []).concat($2.split)
+  when /^\s*!@ each ([\w:]+) in (.*)$/
+    abort "#{$.}: nested !@ each" if block
+    fields = $1.split(":")
+    kinds = $2.split.flat_map do |name|
+      lists.fetch(name) { abort "#{$.}: no list #{name}" }
+    end
+    block = [fields, kinds, []]
+  when /^\s*!@ end each/
+    abort "#{$.}: !@ end each without !@ each" unless block
+    fields, kinds, lines = block
+    kinds.each do |kind|
+      values = kind.split(":")
+      lines.each do |l|
+        fields.zip(values) { |f, v| l = l.gsub("@#{f}@", v) }
+        puts l
+      end
+    end
+    block = nil
+  else
+    if block
+      block[2] << line
+    else
+      puts line
+    end
+  end
+end
+abort "!@ each without !@ end each" if block
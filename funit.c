@@ -1,24 +1,155 @@
 #include "funit.h"
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <string.h>
 
+// for perf_helper_code and memory_helper_code string variables
+#include "funit_memory_helper.h"
+#include "funit_perf_helper.h"
+
 /* Command line options.
  */
 struct Options {
+    int bench;
+    char *bench_csv, *bench_json;
+    char *save_baseline, *compare_baseline;
+    char *bench_samples;  // scratch file for the raw samples of benches
+    char *bench_cpus;     // CPUs to pin benches to
+    int set_bench_nice, bench_nice;
+    double stable_cv;     // percent, or 0 to take a set number of samples
+    char governor[64];    // of the CPU benches run on, "" if unknown
+    double mhz;           // its speed, 0 if unknown
+    int perf;
+    int memory;
     int just_output_fortran;
     int stop_after_build;
+    int list_tests;
+    int in_memory;
+    long n_threads;
+    long parallel;       // CPUs to run test programs on at once, or 0 to
+                         // run them one at a time
+    double max_memory;   // bytes those may declare at once, or 0 for the
+                         // physical memory
+    char *outfile;
+};
+
+/* One input template.  Its code is generated by a worker thread, then it is
+ * built and run in command line order by the main thread.
+ */
+struct GenJob {
+    char *infile;
     char *outfile;
+    char fortran_name[PATH_MAX + 1];
+    char exe_name[PATH_MAX + 1];
+    char dep_name[PATH_MAX];
+    struct TestDependency dep;
+    struct TestFile *tf;    // NULL if generation failed
+    int mem_fd;             // in-memory generated code, or -1
+    char mem_path[32];      // mem_fd's name for child processes
+    char modules_o[PATH_MAX + 1];  // the shared funit modules' object
+    char *diag;             // diagnostics reported while generating
+    size_t diag_len;
+    int done;
+};
+
+/* The C helpers some test programs are built with, written to a temporary
+ * directory when first needed.
+ */
+struct Helpers {
+    char dir[PATH_MAX - 32]; // "" until written; short of the files' names
+    char perf_c[PATH_MAX + 1], memory_c[PATH_MAX + 1];
+};
+
+/* A test program run in parallel with others by -p.
+ */
+struct TestRun {
+    const char *exe;
+    int threads;    // declared by its sets, or 0
+    double memory;  // bytes declared by its sets, or 0
+    enum { RUN_QUEUED, RUN_RUNNING, RUN_DONE } state;
+    pid_t pid;
+    int out_fd;     // its output, kept until it exits
+};
+
+/* The test programs to run in parallel, started in order as they fit in
+ * the CPUs and memory not taken by those already running.
+ */
+struct RunQueue {
+    struct TestRun *runs;
+    size_t n_runs, next_run;  // next_run is the first not started
+    size_t n_running;
+    long cpus, cpus_used;
+    double memory, memory_used;
+    int failed;
+};
+
+/* Worker threads take the next job in order until they run out.
+ */
+struct GenPool {
+    struct GenJob *jobs;
+    size_t n_jobs, next_job;
+    const struct Config *conf;
+    int in_memory;
+    int perf;
+    int memory;
+    int shared_modules;  // the funit modules are built once, not emitted
+    pthread_mutex_t lock;
+    pthread_cond_t job_done;
 };
 
 static const char usage[] = 
 "Usage: funit [-E] [-o file] [test_file.fun...|testdir]\n"
-"             [-h]\n"
+"             [-b] [-j N] [-p[N]] [-l] [-m] [-h]\n"
 "\n"
+"  -b, --bench\n"
+"           run the benchmarks instead of the tests, in the files that\n"
+"           have any\n"
+"  --bench-csv FILE, --bench-json FILE\n"
+"           run the benchmarks and also write their results to FILE, as\n"
+"           CSV or as JSON Lines\n"
+"  --save-baseline NAME\n"
+"           run the benchmarks and save their results as baseline NAME\n"
+"  --compare NAME\n"
+"           run the benchmarks and compare them with baseline NAME,\n"
+"           failing if any is slower by more than bench_threshold\n"
 "  -E       stop after emitting Fortran code from the template .fun files\n"
 "  -c       stop after building the generated test code\n"
 "  -h       print this help message\n"
+"  -j N     parse and generate code for up to N files at once (default:\n"
+"           the number of online CPUs)\n"
+"  -l       list the test sets and cases in the template files and exit\n"
+"  -m       keep the generated code in memory rather than writing it to a\n"
+"           file; the build command reads it from the path {{SRC.F}}\n"
+"           expands to\n"
+"  --cpus LIST\n"
+"           pin the benchmarks to the CPUs in LIST, e.g. 2,3 or 0-3\n"
+"  --nice N run the benchmarks at nice value N, e.g. -10 for a higher\n"
+"           priority, if allowed\n"
+"  --repeat-until-stable[=PERCENT]\n"
+"           run the benchmarks, taking more samples while they vary by\n"
+"           more than PERCENT (default: 2)\n"
 "  -o FILE  write Fortran code to FILE instead of the default name\n"
+"  -p[N], --parallel[=N]\n"
+"           run test programs at once on up to N CPUs (default: the\n"
+"           number of online CPUs), each taking the threads its sets\n"
+"           declare, or 1, and told to use them through OMP_NUM_THREADS;\n"
+"           benchmarks still run one at a time\n"
+"  --max-memory SIZE\n"
+"           with -p, run test programs at once only while the memory\n"
+"           their sets declare adds up to at most SIZE, e.g. 16G\n"
+"           (default: the physical memory)\n"
+"  --perf   count cycles, instructions, cache misses and branch misses\n"
+"           for each test and bench with the hardware counters, building\n"
+"           their C helper into the test program through {{DEPS}}\n"
+"  --memory report each test's peak memory use and heap allocations,\n"
+"           building a C helper into the test program the same way\n"
 "\n"
 "Generates Fortran code from the test template file(s) (or all templates\n"
 "in the given directory), then compiles and runs the tests.\n"
@@ -28,13 +159,13 @@ static const char usage[] =
  * "test_THING.fun" naming convention.
  * Returns 0 if no such file dependency was set. If 1 is returned, the caller
  * is responsible for removing the added TestDependency, as it is not
- * malloc()'d.
+ * malloc()'d.  dep and buf are storage owned by the caller.
  */
 static int file_dependency(char *infile, struct TestSet *set,
-                           const struct Config *conf)
+                           const struct Config *conf,
+                           struct TestDependency *dep, char *buf)
 {
-    static struct TestDependency dep;
-    static char buf[PATH_MAX], *test, *dot;
+    char *test, *dot;
 
     test = strstr(infile, "test_");
     dot = strrchr(buf, '.');
@@ -50,8 +181,8 @@ static int file_dependency(char *infile, struct TestSet *set,
 
         // add this dependency to the dep list of each set
         while (set) {
-            dep.next = set->deps;
-            set->deps = &dep;
+            dep->next = set->deps;
+            set->deps = dep;
             set = set->next;
         }
         return 1;
@@ -60,11 +191,12 @@ static int file_dependency(char *infile, struct TestSet *set,
 }
 
 /* Given the "test_THING.fun" input file, compute the name of the output file
- * to write the Fortran code to.
+ * to write the Fortran code to in buf, which holds PATH_MAX + 1 chars.
  */
-static char *make_fortran_name(char *infile, const struct Config *conf)
+static char *make_fortran_name(char *infile, const struct Config *conf,
+                               char *buf)
 {
-    static char buf[PATH_MAX + 1], *dot;
+    char *dot;
 
     if (strlen(infile) > PATH_MAX - strlen(conf->fortran_ext)) {
         fprintf(stderr, "FUnit: the input file name '%s' is too long\n",
@@ -83,44 +215,60 @@ static char *make_fortran_name(char *infile, const struct Config *conf)
     return buf;
 }
 
+/* Computes the name of the test program built from infile in buf, which
+ * holds PATH_MAX + 1 chars: infile without its template extension, or with
+ * ".exe" appended if it has none.
+ */
+static char *make_exe_name(char *infile, const struct Config *conf, char *buf)
+{
+    char *dot;
+
+    if (strlen(infile) > PATH_MAX - 4) {
+        fprintf(stderr, "FUnit: the input file name '%s' is too long\n",
+                infile);
+        abort();
+    }
+
+    dot = strrchr(infile, '.');
+    if (dot && !strcmp(dot, conf->template_ext)) {
+        strncpy(buf, infile, dot - infile);
+        buf[dot - infile] = '\0';
+    } else {
+        strcpy(buf, infile);
+        strcat(buf, ".exe");
+    }
+    return buf;
+}
+
 static struct TestFile *
-generate_code(char *infile, char *outfile, const struct Config *conf)
+generate_code(struct GenJob *job, const struct GenPool *pool, FILE *err)
 {
+    const struct Config *conf = pool->conf;
+    char *infile = job->infile, *outfile = job->outfile;
     struct TestFile *tf;
-    FILE *fout;
-    int dep_added;
+    struct Emitter out;
+    int dep_added, ret;
 
-    tf = parse_test_file(infile);
+    tf = parse_test_file_cached(infile, conf->cache_dir, err);
     if (!tf) return NULL;
     if (!tf->sets) {
         close_testfile(tf);
         return NULL;
     }
 
-    dep_added = file_dependency(infile, tf->sets, conf);
+    dep_added = file_dependency(infile, tf->sets, conf,
+                                &job->dep, job->dep_name);
 
-    // XXX if we're generating code just to run a test, use a mkstemp
     if (!outfile) {
-        outfile = make_fortran_name(infile, conf);
-    }
-    tf->exe = outfile;
-
-    fout = fopen(outfile, "w");
-    if (!fout) {
-        fprintf(stderr, "FUnit: could not open %s for writing\n", outfile);
-        return NULL;
-    }
-
-    if (generate_code_file(tf->sets, fout)) {
-        close_testfile(tf);
-        return NULL;
+        outfile = make_fortran_name(infile, conf, job->fortran_name);
     }
+    tf->exe = make_exe_name(infile, conf, job->exe_name);
+    tf->perf = pool->perf;
+    tf->memory = pool->memory;
+    tf->shared_modules = pool->shared_modules;
 
-    if (fclose(fout)) {
-        fprintf(stderr, "FUnit: error closing %s\n", outfile);
-        close_testfile(tf);
-        return NULL;
-    }
+    emit_init(&out);
+    ret = generate_code_file(tf, &out, err);
 
     if (dep_added) { // XXX wtf is this doing?
         struct TestSet *set = tf->sets;
@@ -130,9 +278,128 @@ generate_code(char *infile, char *outfile, const struct Config *conf)
         }
     }
 
+    if (!ret && pool->in_memory) {
+        job->mem_fd = emit_memory_file(&out, outfile, job->mem_path,
+                                       sizeof(job->mem_path), err);
+        if (job->mem_fd == -1)
+            ret = -1;
+        else
+            tf->src_f = job->mem_path;
+    } else if (!ret) { // leaves an up-to-date outfile untouched
+        if (emit_write_file(&out, outfile, err) < 0)
+            ret = -1;
+    }
+    emit_free(&out);
+    if (ret) {
+        close_testfile(tf);
+        return NULL;
+    }
+
     return tf;
 }
 
+static void *generate_worker(void *arg)
+{
+    struct GenPool *pool = (struct GenPool *)arg;
+    struct GenJob *job;
+    FILE *err;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->next_job == pool->n_jobs) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        job = &pool->jobs[pool->next_job++];
+        pthread_mutex_unlock(&pool->lock);
+
+        // hold diagnostics so they are printed in command line order
+        err = open_memstream(&job->diag, &job->diag_len);
+        if (!err) abort(); // XXX or handle allocation better?
+        job->tf = generate_code(job, pool, err);
+        fclose(err);
+
+        pthread_mutex_lock(&pool->lock);
+        job->done = TRUE;
+        pthread_cond_broadcast(&pool->job_done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// Blocks until the given job has been generated.
+static struct GenJob *wait_for_job(struct GenPool *pool, size_t i)
+{
+    struct GenJob *job = &pool->jobs[i];
+
+    pthread_mutex_lock(&pool->lock);
+    while (!job->done)
+        pthread_cond_wait(&pool->job_done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    return job;
+}
+
+static void report_diagnostics(struct GenJob *job)
+{
+    if (job->diag_len > 0) {
+        fflush(stdout);
+        fwrite(job->diag, job->diag_len, 1, stderr);
+    }
+    free(job->diag);
+    job->diag = NULL;
+}
+
+static void list_tests(struct TestCase *test)
+{
+    if (test->next)
+        list_tests(test->next);
+
+    fputs("  ", stdout);
+    fwrite(test->name, test->namelen, 1, stdout);
+    if (test->over) {
+        fputs("(", stdout);
+        fwrite(test->case_name, test->case_namelen, 1, stdout);
+        fputs(") over ", stdout);
+        fwrite(test->over, test->overlen, 1, stdout);
+    }
+    fputs("\n", stdout);
+}
+
+static void list_benches(struct TestBench *bench)
+{
+    if (bench->next)
+        list_benches(bench->next);
+
+    fputs("  bench ", stdout);
+    fwrite(bench->name, bench->namelen, 1, stdout);
+    fputs("\n", stdout);
+}
+
+static void list_sets(const char *path, struct TestSet *set)
+{
+    if (set->next)
+        list_sets(path, set->next);
+
+    printf("%s: set ", path);
+    fwrite(set->name, set->namelen, 1, stdout);
+    fputs("\n", stdout);
+    if (set->tests)
+        list_tests(set->tests);
+    if (set->benches)
+        list_benches(set->benches);
+}
+
+static int list_test_file(char *infile, const struct Config *conf)
+{
+    struct TestFile *tf = parse_test_file_cached(infile, conf->cache_dir,
+                                                 stderr);
+    if (!tf) return -1;
+
+    list_sets(infile, tf->sets);
+    close_testfile(tf);
+    return 0;
+}
+
 static int checked_system(const char *command)
 {
     int ret = system(command);
@@ -148,37 +415,419 @@ static int checked_system(const char *command)
     return ret;
 }
 
-static int build_test(struct TestFile *tf, struct Config *conf)
+/* Like checked_system, but the command inherits fd, which is closed on
+ * exec in every other child.
+ */
+static int system_keeping_fd(const char *command, int fd)
+{
+    int status;
+    pid_t pid;
+
+    fflush(NULL);
+    pid = fork();
+    if (pid == 0) {
+        fcntl(fd, F_SETFD, 0);
+        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+        _exit(127);
+    }
+    if (pid == -1) {
+        fprintf(stderr, "fork(): error executing '%s': %s\n", command,
+                strerror(errno));
+        return -1;
+    }
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            fprintf(stderr, "waitpid(): error executing '%s': %s\n",
+                    command, strerror(errno));
+            return -1;
+        }
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+        fprintf(stderr, "system(): error executing '%s'\n", command);
+        return -1;
+    }
+    return status;
+}
+
+/* Builds tf's test program.  src_fd is the in-memory generated code its
+ * build command reads, or -1.
+ */
+static int build_test(struct TestFile *tf, struct Config *conf, int src_fd)
 {
     struct StringBuffer sb;
+    int ret;
+
     sb_init(&sb, 128);
 
     make_build_command(&sb, tf, conf);
 
-    int ret = checked_system(sb.s);
+    if (src_fd != -1)
+        ret = system_keeping_fd(sb.s, src_fd);
+    else
+        ret = checked_system(sb.s);
 
     sb_free(&sb);
 
     return ret;
 }
 
-static int run_test(const char *testfile)
+/* Appends s to sb quoted for the shell.
+ */
+static void add_shell_word(struct StringBuffer *sb, const char *s)
+{
+    sb_add_char(sb, '\'');
+    for (; *s; s++) {
+        if (*s == '\'')
+            sb_add_str(sb, "'\\''");
+        else
+            sb_add_char(sb, *s);
+    }
+    sb_add_char(sb, '\'');
+}
+
+/* Puts the command that runs testfile in sb, giving it threads OpenMP
+ * threads unless threads is 0.
+ */
+static void make_run_command(struct StringBuffer *sb, const char *testfile,
+                             int threads, const struct Options *opts)
+{
+    if (threads > 0) {
+        char env[32];
+        snprintf(env, sizeof(env), "OMP_NUM_THREADS=%i ", threads);
+        sb_add_str(sb, env);
+    }
+    if (!strchr(testfile, '/')) // not looked up in PATH
+        sb_add_str(sb, "./");
+    sb_add_str(sb, testfile);
+    if (opts->bench)
+        sb_add_str(sb, " --bench");
+    if (opts->bench_csv) {
+        sb_add_str(sb, " --bench-csv ");
+        add_shell_word(sb, opts->bench_csv);
+    }
+    if (opts->bench_json) {
+        sb_add_str(sb, " --bench-json ");
+        add_shell_word(sb, opts->bench_json);
+    }
+    if (opts->bench_samples) {
+        sb_add_str(sb, " --bench-samples ");
+        add_shell_word(sb, opts->bench_samples);
+    }
+    if (opts->stable_cv > 0) {
+        char cv[32];
+        snprintf(cv, sizeof(cv), " --bench-stable %g", opts->stable_cv);
+        sb_add_str(sb, cv);
+    }
+    if (opts->governor[0]) {
+        sb_add_str(sb, " --bench-governor ");
+        add_shell_word(sb, opts->governor);
+    }
+    if (opts->mhz > 0) {
+        char mhz[32];
+        snprintf(mhz, sizeof(mhz), " --bench-mhz %.0f", opts->mhz);
+        sb_add_str(sb, mhz);
+    }
+    sb_add_char(sb, '\0');
+}
+
+static int run_test(const char *testfile, int threads,
+                    const struct Options *opts)
 {
+    struct StringBuffer sb;
+    int ret;
+
     if (!fu_file_exists(testfile)) {
         fprintf(stderr, "Test executable '%s' not found\n", testfile);
         return -1;
     }
 
-    return checked_system(testfile);
+    sb_init(&sb, 128);
+    make_run_command(&sb, testfile, threads, opts);
+
+    ret = checked_system(sb.s);
+
+    sb_free(&sb);
+
+    return ret;
+}
+
+/* Runs the benches in testfile, on the CPUs and at the priority asked
+ * for, saying which CPU they run on and how fast it is the first time.
+ */
+static int run_benches(const char *testfile, int threads,
+                       struct Options *opts)
+{
+    static int described = FALSE;
+    int ret;
+
+    if (enter_bench_env(opts->bench_cpus, opts->set_bench_nice,
+                        opts->bench_nice, stderr))
+        return -1;
+    if (!described) {
+        int cpu = describe_bench_cpu(opts->governor, sizeof(opts->governor),
+                                     &opts->mhz);
+        printf("Benchmarking on CPU %i", cpu);
+        if (opts->bench_cpus)
+            printf(" (of %s)", opts->bench_cpus);
+        printf(": governor %s, ", opts->governor[0] ? opts->governor
+                                                    : "unknown");
+        if (opts->mhz > 0)
+            printf("%.0f MHz\n", opts->mhz);
+        else
+            puts("speed unknown");
+        fflush(stdout); // before the benches' own output
+        described = TRUE;
+    }
+    ret = run_test(testfile, threads, opts);
+    leave_bench_env();
+    return ret;
+}
+
+/* The threads and memory a test program needs: the most any of its sets
+ * declare, 0 for what none do.
+ */
+static void file_needs(const struct TestFile *tf, int *threads,
+                       double *memory)
+{
+    *threads = 0;
+    *memory = 0;
+    for (struct TestSet *set = tf->sets; set; set = set->next) {
+        *threads = MAX(*threads, set->threads);
+        *memory = MAX(*memory, set->memory);
+    }
+}
+
+/* Starts run's test program with its output going to a temporary file.
+ * Returns 0 on success, or -1 after reporting an error.
+ */
+static int start_run(struct TestRun *run, const struct Options *opts)
+{
+    const char *tmpdir = getenv("TMPDIR");
+    char path[PATH_MAX + 1];
+    struct StringBuffer sb;
+
+    if (!fu_file_exists(run->exe)) {
+        fprintf(stderr, "Test executable '%s' not found\n", run->exe);
+        return -1;
+    }
+    if (!tmpdir || !*tmpdir)
+        tmpdir = "/tmp";
+    snprintf(path, sizeof(path), "%s/funit-output-XXXXXX", tmpdir);
+    run->out_fd = mkstemp(path);
+    if (run->out_fd == -1) {
+        fprintf(stderr, "FUnit: could not create a temporary file in %s: "
+                "%s\n", tmpdir, strerror(errno));
+        return -1;
+    }
+    unlink(path);
+    fcntl(run->out_fd, F_SETFD, FD_CLOEXEC); // kept from the other runs
+
+    // every run is told how many threads to use, so they don't crowd
+    // each other out
+    sb_init(&sb, 128);
+    make_run_command(&sb, run->exe, MAX(run->threads, 1), opts);
+    fflush(stdout);
+    run->pid = fork();
+    if (run->pid == 0) {
+        dup2(run->out_fd, STDOUT_FILENO);
+        dup2(run->out_fd, STDERR_FILENO);
+        execl("/bin/sh", "sh", "-c", sb.s, (char *)NULL);
+        _exit(127);
+    }
+    sb_free(&sb);
+    if (run->pid == -1) {
+        fprintf(stderr, "FUnit: could not run '%s': %s\n", run->exe,
+                strerror(errno));
+        close(run->out_fd);
+        run->out_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/* Starts the queued runs that fit in the CPUs and memory left, in order,
+ * skipping those that don't.  A run is started regardless when nothing
+ * else is running, so one needing more than the machine has still runs,
+ * alone.
+ */
+static void start_runs(struct RunQueue *q, const struct Options *opts)
+{
+    for (size_t i = q->next_run; i < q->n_runs; i++) {
+        struct TestRun *run = &q->runs[i];
+        long cpus = MAX(run->threads, 1);
+
+        if (run->state != RUN_QUEUED)
+            continue;
+        if (q->n_running > 0 && (q->cpus_used + cpus > q->cpus ||
+                                 q->memory_used + run->memory > q->memory))
+            continue;
+        if (start_run(run, opts)) {
+            run->state = RUN_DONE;
+            q->failed = TRUE;
+            continue;
+        }
+        run->state = RUN_RUNNING;
+        q->cpus_used += cpus;
+        q->memory_used += run->memory;
+        q->n_running++;
+    }
+    while (q->next_run < q->n_runs && q->runs[q->next_run].state != RUN_QUEUED)
+        q->next_run++;
+}
+
+/* Prints the output of a run that has exited and frees what it used.
+ */
+static void finish_run(struct RunQueue *q, struct TestRun *run, int status)
+{
+    char buf[8192];
+    ssize_t n;
+
+    printf("running test %s\n", run->exe);
+    fflush(stdout);
+    lseek(run->out_fd, 0, SEEK_SET);
+    while ((n = read(run->out_fd, buf, sizeof(buf))) > 0)
+        fu_write_all(STDOUT_FILENO, buf, n);
+    close(run->out_fd);
+    run->out_fd = -1;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+        fprintf(stderr, "FUnit: could not run '%s'\n", run->exe);
+        q->failed = TRUE;
+    }
+
+    run->state = RUN_DONE;
+    q->cpus_used -= MAX(run->threads, 1);
+    q->memory_used -= run->memory;
+    q->n_running--;
+}
+
+/* Reaps the runs that have exited, waiting for one to if block, and starts
+ * the queued runs that now fit.
+ */
+static void reap_runs(struct RunQueue *q, int block,
+                      const struct Options *opts)
+{
+    int status;
+    pid_t pid;
+
+    while (q->n_running > 0 &&
+           (pid = waitpid(-1, &status, block ? 0 : WNOHANG)) != 0) {
+        if (pid == -1) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (size_t i = 0; i < q->n_runs; i++) {
+            if (q->runs[i].state == RUN_RUNNING && q->runs[i].pid == pid) {
+                finish_run(q, &q->runs[i], status);
+                break;
+            }
+        }
+        block = FALSE;
+    }
+    start_runs(q, opts);
+}
+
+/* Queues the test program of tf to run in parallel with others, starting
+ * it if it fits.
+ */
+static void queue_run(struct RunQueue *q, const struct TestFile *tf,
+                      const struct Options *opts)
+{
+    struct TestRun *run = &q->runs[q->n_runs++];
+
+    run->exe = tf->exe;
+    file_needs(tf, &run->threads, &run->memory);
+    run->state = RUN_QUEUED;
+    run->out_fd = -1;
+    reap_runs(q, FALSE, opts);
 }
 
 static int parse_args(int argc, char **argv, struct Options *opts)
 {
     memset(opts, 0, sizeof(struct Options));
 
+    enum { OPT_BENCH_CSV = 256, OPT_BENCH_JSON, OPT_SAVE_BASELINE,
+           OPT_COMPARE, OPT_PERF, OPT_MEMORY, OPT_CPUS, OPT_NICE, OPT_STABLE,
+           OPT_MAX_MEMORY };
+    static const struct option long_opts[] = {
+        {"bench", no_argument, NULL, 'b'},
+        {"bench-csv", required_argument, NULL, OPT_BENCH_CSV},
+        {"bench-json", required_argument, NULL, OPT_BENCH_JSON},
+        {"save-baseline", required_argument, NULL, OPT_SAVE_BASELINE},
+        {"compare", required_argument, NULL, OPT_COMPARE},
+        {"perf", no_argument, NULL, OPT_PERF},
+        {"memory", no_argument, NULL, OPT_MEMORY},
+        {"cpus", required_argument, NULL, OPT_CPUS},
+        {"nice", required_argument, NULL, OPT_NICE},
+        {"repeat-until-stable", optional_argument, NULL, OPT_STABLE},
+        {"parallel", optional_argument, NULL, 'p'},
+        {"max-memory", required_argument, NULL, OPT_MAX_MEMORY},
+        {NULL, 0, NULL, 0}
+    };
+    char *end;
     int opt;
-    while ((opt = getopt(argc, argv, "Echo:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "bEchj:lmo:p::", long_opts, NULL))
+           != -1) {
         switch (opt) {
+        case 'b':
+            opts->bench = TRUE;
+            break;
+        case OPT_BENCH_CSV:
+            opts->bench_csv = optarg;
+            opts->bench = TRUE;
+            break;
+        case OPT_BENCH_JSON:
+            opts->bench_json = optarg;
+            opts->bench = TRUE;
+            break;
+        case OPT_SAVE_BASELINE:
+        case OPT_COMPARE:
+            if (!*optarg || strchr(optarg, '/')) {
+                fprintf(stderr, "FUnit: '%s' is not a baseline name\n",
+                        optarg);
+                return -1;
+            }
+            if (opt == OPT_SAVE_BASELINE)
+                opts->save_baseline = optarg;
+            else
+                opts->compare_baseline = optarg;
+            opts->bench = TRUE;
+            break;
+        case OPT_PERF:
+            opts->perf = TRUE;
+            break;
+        case OPT_MEMORY:
+            opts->memory = TRUE;
+            break;
+        case OPT_CPUS:
+            if (check_cpu_list(optarg, stderr))
+                return -1;
+            opts->bench_cpus = optarg;
+            break;
+        case OPT_NICE:
+            opts->bench_nice = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || opts->bench_nice < -20 ||
+                opts->bench_nice > 19) {
+                fprintf(stderr, "FUnit: --nice expects a nice value from -20 "
+                        "to 19, not '%s'\n", optarg);
+                return -1;
+            }
+            opts->set_bench_nice = TRUE;
+            break;
+        case OPT_STABLE:
+            opts->stable_cv = 2;
+            if (optarg) {
+                opts->stable_cv = strtod(optarg, &end);
+                if (*end == '%')
+                    end++;
+                if (end == optarg || *end != '\0' || opts->stable_cv <= 0) {
+                    fprintf(stderr, "FUnit: --repeat-until-stable expects a "
+                            "positive percentage, not '%s'\n", optarg);
+                    return -1;
+                }
+            }
+            opts->bench = TRUE;
+            break;
         case 'E':
             if (opts->stop_after_build) {
                 fputs("FUnit: overriding -c with -E\n", stderr);
@@ -196,6 +845,39 @@ static int parse_args(int argc, char **argv, struct Options *opts)
         case 'h':
             fputs(usage, stderr);
             return 0;
+        case 'j':
+            opts->n_threads = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || opts->n_threads < 1) {
+                fprintf(stderr, "FUnit: -j expects a positive number of "
+                        "threads, not '%s'\n", optarg);
+                return -1;
+            }
+            break;
+        case 'p':
+            opts->parallel = sysconf(_SC_NPROCESSORS_ONLN);
+            if (optarg) {
+                opts->parallel = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || opts->parallel < 1) {
+                    fprintf(stderr, "FUnit: --parallel expects a positive "
+                            "number of CPUs, not '%s'\n", optarg);
+                    return -1;
+                }
+            }
+            break;
+        case OPT_MAX_MEMORY:
+            opts->max_memory = fu_parse_size(optarg, &end);
+            if (end == optarg || *end != '\0' || opts->max_memory <= 0) {
+                fprintf(stderr, "FUnit: --max-memory expects a size like "
+                        "16G, not '%s'\n", optarg);
+                return -1;
+            }
+            break;
+        case 'l':
+            opts->list_tests = TRUE;
+            break;
+        case 'm':
+            opts->in_memory = TRUE;
+            break;
         case 'o':
             opts->outfile = optarg;
             break;
@@ -214,6 +896,12 @@ static int parse_args(int argc, char **argv, struct Options *opts)
         return -1;
     }
 
+    if (opts->in_memory && (opts->just_output_fortran || opts->outfile)) {
+        fprintf(stderr, "%s: -m cannot be combined with -E or -o, which "
+                "ask for the Fortran code in a file\n", argv[0]);
+        return -1;
+    }
+
     if (opts->outfile && optind + 1 < argc) {
         fprintf(stderr, "%s: only one input file can be given when "
                 "specifying the output file\n", argv[0]);
@@ -223,10 +911,247 @@ static int parse_args(int argc, char **argv, struct Options *opts)
     return 0;
 }
 
+/* Creates an empty scratch file for the test programs to append the raw
+ * samples of their benches to, putting its name in path.  Returns 0 on
+ * success, or -1 after reporting an error.
+ */
+static int make_samples_file(char *path, size_t path_size)
+{
+    const char *tmpdir = getenv("TMPDIR");
+    int fd;
+
+    if (!tmpdir || !*tmpdir)
+        tmpdir = "/tmp";
+    if (snprintf(path, path_size, "%s/funit-samples-XXXXXX", tmpdir)
+        >= (int)path_size) {
+        fprintf(stderr, "FUnit: the directory name '%s' is too long\n",
+                tmpdir);
+        return -1;
+    }
+    fd = mkstemp(path);
+    if (fd == -1) {
+        fprintf(stderr, "FUnit: could not create a temporary file in %s: "
+                "%s\n", tmpdir, strerror(errno));
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+static void remove_helpers(struct Helpers *h)
+{
+    if (!h->dir[0])
+        return;
+    unlink(h->perf_c);
+    unlink(h->memory_c);
+    rmdir(h->dir);
+    h->dir[0] = '\0';
+}
+
+static int write_helper(const char *path, const char *code)
+{
+    FILE *f = fopen(path, "w");
+
+    if (!f || fputs(code, f) == EOF || fclose(f)) {
+        fprintf(stderr, "FUnit: could not write %s: %s\n", path,
+                strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Writes the C helpers to a new temporary directory for the test programs
+ * to be built with.  Returns 0 on success, or -1 after reporting an error.
+ */
+static int write_helpers(struct Helpers *h)
+{
+    const char *tmpdir = getenv("TMPDIR");
+
+    if (!tmpdir || !*tmpdir)
+        tmpdir = "/tmp";
+    if (snprintf(h->dir, sizeof(h->dir), "%s/funit-helpers-XXXXXX", tmpdir)
+        >= (int)sizeof(h->dir)) {
+        fprintf(stderr, "FUnit: the directory name '%s' is too long\n",
+                tmpdir);
+        h->dir[0] = '\0';
+        return -1;
+    }
+    if (!mkdtemp(h->dir)) {
+        fprintf(stderr, "FUnit: could not create a temporary directory in "
+                "%s: %s\n", tmpdir, strerror(errno));
+        h->dir[0] = '\0';
+        return -1;
+    }
+    snprintf(h->perf_c, sizeof(h->perf_c), "%s/funit_perf.c", h->dir);
+    snprintf(h->memory_c, sizeof(h->memory_c), "%s/funit_memory.c", h->dir);
+    if (write_helper(h->perf_c, perf_helper_code) ||
+        write_helper(h->memory_c, memory_helper_code)) {
+        remove_helpers(h);
+        return -1;
+    }
+    return 0;
+}
+
+/* Points tf at the C helpers its test program needs, writing them if they
+ * haven't been yet.  Returns -1 if they can't be.
+ */
+static int add_helpers(struct TestFile *tf, struct Helpers *h)
+{
+    int memory = uses_memory_helper(tf);
+
+    if (!tf->perf && !memory)
+        return 0;
+    if (!h->dir[0] && write_helpers(h))
+        return -1;
+    if (tf->perf)
+        tf->perf_c = h->perf_c;
+    if (memory)
+        tf->memory_c = h->memory_c;
+    return 0;
+}
+
+static int add_to_buffer(void *data, const struct iovec *iov, int iovcnt)
+{
+    struct StringBuffer *sb = (struct StringBuffer *)data;
+
+    for (int i = 0; i < iovcnt; i++)
+        sb_add_nstr(sb, (const char *)iov[i].iov_base, iov[i].iov_len);
+    return 0;
+}
+
+/* Points tf at an object of the funit modules its test program uses, built
+ * with the module_build command in the cache directory, where the compiler
+ * leaves their .mod files too.  The object is named after the hash of the
+ * modules' code and the command, so it is built once for each, and later
+ * test programs just link it.  obj holds PATH_MAX + 1 chars.  Returns -1
+ * if it can't be built.
+ */
+static int add_modules(struct TestFile *tf, const struct Config *conf,
+                       char *obj)
+{
+    char name[64], src[128], path[PATH_MAX + 1];
+    struct TestFile build;
+    struct TestSet set;
+    struct Config build_conf;
+    struct StringBuffer sb;
+    struct Emitter out;
+    int ret = 0;
+
+    emit_init(&out);
+    emit_printf(&out, "! built with: %s\n", conf->module_build);
+    generate_modules(tf, &out);
+    sb_init(&sb, 128);
+    emit_consume(&out, add_to_buffer, &sb);
+    snprintf(name, sizeof(name), "funit-modules-%016llx",
+             (unsigned long long)fu_hash(sb.s, sb.len));
+    sb.len = 0;
+
+    snprintf(src, sizeof(src), "%s%s", name, conf->fortran_ext);
+    if (snprintf(path, sizeof(path), "%s/%s", conf->cache_dir, src)
+        >= (int)sizeof(path)) {
+        fprintf(stderr, "FUnit: the directory name '%s' is too long\n",
+                conf->cache_dir);
+        ret = -1;
+        goto done;
+    }
+    snprintf(obj, PATH_MAX + 1, "%s/%s.o", conf->cache_dir, name);
+    tf->modules_o = obj;
+    if (fu_file_exists(obj))
+        goto done;
+
+    if (mkdir(conf->cache_dir, 0777) && errno != EEXIST) {
+        fprintf(stderr, "FUnit: could not create cache directory %s: %s\n",
+                conf->cache_dir, strerror(errno));
+        ret = -1;
+        goto done;
+    }
+    if (emit_write_file(&out, path, stderr) < 0) {
+        ret = -1;
+        goto done;
+    }
+
+    // the command runs in the cache directory, on the names in it
+    snprintf(path, sizeof(path), "%s%s", name, conf->template_ext);
+    memset(&set, 0, sizeof(set));
+    set.name = name;
+    set.namelen = strlen(name);
+    memset(&build, 0, sizeof(build));
+    build.path = path;
+    build.exe = obj + strlen(conf->cache_dir) + 1;
+    build.src_f = src;
+    build.sets = &set;
+    build_conf = *conf;
+    build_conf.build_fragments = conf->module_build_fragments;
+
+    sb_add_str(&sb, "cd ");
+    add_shell_word(&sb, conf->cache_dir);
+    sb_add_str(&sb, " && ");
+    make_build_command(&sb, &build, &build_conf);
+    if (checked_system(sb.s)) {
+        fprintf(stderr, "FUnit: could not build the funit modules with "
+                "'%s'\n", sb.s);
+        unlink(obj);
+        ret = -1;
+    }
+ done:
+    sb_free(&sb);
+    emit_free(&out);
+    return ret;
+}
+
+static void baseline_path(char *buf, const struct Config *conf,
+                          const char *name)
+{
+    snprintf(buf, PATH_MAX + 1, "%s/%s.csv", conf->baseline_dir, name);
+}
+
+/* Compares the samples of this run with a baseline and saves them as one,
+ * as asked.  Returns -1 if a bench regressed or on error.
+ */
+static int finish_baselines(const struct Options *opts,
+                            const struct Config *conf)
+{
+    char path[PATH_MAX + 1];
+    int ret = 0;
+
+    if (opts->compare_baseline) {
+        struct BenchSamples *now, *base;
+
+        baseline_path(path, conf, opts->compare_baseline);
+        if (read_bench_samples(opts->bench_samples, &now, stderr))
+            return -1;
+        if (read_bench_samples(path, &base, stderr)) {
+            free_bench_samples(now);
+            return -1;
+        }
+        printf("\nCompared with baseline '%s' (threshold %g%%):\n",
+               opts->compare_baseline, conf->bench_threshold);
+        int regressed = compare_bench_samples(now, base,
+                                              conf->bench_threshold, stdout);
+        if (regressed) {
+            printf("%i bench%s regressed\n", regressed,
+                   regressed == 1 ? "" : "es");
+            ret = -1;
+        }
+        free_bench_samples(base);
+        free_bench_samples(now);
+    }
+
+    if (opts->save_baseline) {
+        baseline_path(path, conf, opts->save_baseline);
+        if (save_baseline(opts->bench_samples, path, stderr))
+            return -1;
+        printf("Saved baseline '%s' in %s\n", opts->save_baseline, path);
+    }
+
+    return ret;
+}
+
 int main(int argc, char **argv)
 {
     struct Config conf;
     struct Options opts;
+    int ret = 0;
 
     if (parse_args(argc, argv, &opts)) {
         return -1;
@@ -237,27 +1162,154 @@ int main(int argc, char **argv)
         return -1;
     }
 
-    while (optind < argc) {
-printf("generating code from %s to %s\n", argv[optind], opts.outfile);
+    if (opts.list_tests) {
+        while (optind < argc) {
+            if (list_test_file(argv[optind], &conf))
+                ret = -1;
+            optind++;
+        }
+        free_config(&conf);
+        return ret;
+    }
+
+    // each test program appends its benches' results to these
+    char samples_path[PATH_MAX + 1];
+    if (!opts.just_output_fortran && !opts.stop_after_build) {
+        if (opts.bench_csv)
+            unlink(opts.bench_csv);
+        if (opts.bench_json)
+            unlink(opts.bench_json);
+        if (opts.save_baseline || opts.compare_baseline) {
+            if (make_samples_file(samples_path, sizeof(samples_path))) {
+                free_config(&conf);
+                return -1;
+            }
+            opts.bench_samples = samples_path;
+        }
+    }
+    struct Helpers helpers;
+    helpers.dir[0] = '\0';
+
+    // generate code for all the files in the background
+    struct GenPool pool;
+    pool.n_jobs = argc - optind;
+    pool.jobs = (struct GenJob *)calloc(pool.n_jobs, sizeof(struct GenJob));
+    pool.next_job = 0;
+    pool.conf = &conf;
+    pool.in_memory = opts.in_memory;
+    pool.perf = opts.perf;
+    pool.memory = opts.memory;
+    // -E output is complete Fortran, with the modules in it
+    pool.shared_modules = conf.module_build && !opts.just_output_fortran;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.job_done, NULL);
+    for (size_t i = 0; i < pool.n_jobs; i++) {
+        pool.jobs[i].infile = argv[optind + i];
+        pool.jobs[i].outfile = opts.outfile;
+        pool.jobs[i].mem_fd = -1;
+    }
 
-        struct TestFile *tf = generate_code(argv[optind], opts.outfile, &conf);
+    long n_threads = opts.n_threads;
+    if (n_threads < 1)
+        n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    n_threads = MAX(1, MIN(n_threads, (long)pool.n_jobs));
+    pthread_t *threads = NEWA(pthread_t, n_threads);
+    for (long t = 0; t < n_threads; t++) {
+        if (pthread_create(&threads[t], NULL, generate_worker, &pool)) {
+            fputs("FUnit: could not start a code generation thread\n",
+                  stderr);
+            abort();
+        }
+    }
+
+    // benches get the machine to themselves, so all the code is generated
+    // before the first runs
+    if (opts.bench && !opts.just_output_fortran && !opts.stop_after_build) {
+        for (size_t i = 0; i < pool.n_jobs; i++)
+            wait_for_job(&pool, i);
+    }
+
+    // benches run one at a time even with -p
+    struct RunQueue runs;
+    memset(&runs, 0, sizeof(runs));
+    if (opts.parallel && !opts.bench) {
+        runs.runs = NEWA(struct TestRun, pool.n_jobs);
+        runs.cpus = opts.parallel;
+        runs.memory = opts.max_memory;
+        if (runs.memory <= 0)
+            runs.memory = (double)sysconf(_SC_PHYS_PAGES) *
+                sysconf(_SC_PAGESIZE);
+    }
+
+    // build and run each test as soon as its code is ready
+    for (size_t i = 0; i < pool.n_jobs; i++) {
+        struct GenJob *job = wait_for_job(&pool, i);
+printf("generating code from %s to %s\n", job->infile, opts.outfile);
+        report_diagnostics(job);
+
+        struct TestFile *tf = job->tf;
         if (tf) {
             if (opts.just_output_fortran) goto pass;
+            if (opts.bench && !has_benches(tf)) goto pass;
 printf("building test for %s\n", opts.outfile);
-            build_test(tf, &conf);
+            if (add_helpers(tf, &helpers)) {
+                ret = -1;
+                goto pass;
+            }
+            if (tf->shared_modules && add_modules(tf, &conf, job->modules_o)) {
+                ret = -1;
+                goto pass;
+            }
+            build_test(tf, &conf, job->mem_fd);
+            if (job->mem_fd != -1) { // keep it out of the test run
+                close(job->mem_fd);
+                job->mem_fd = -1;
+            }
 
             if (opts.stop_after_build) goto pass;
+            if (runs.runs) {
+                queue_run(&runs, tf, &opts);
+                goto pass;
+            }
+            int threads;
+            double memory;
+            file_needs(tf, &threads, &memory);
 printf("running test %s\n", tf->exe);
-            run_test(tf->exe);
+            if (opts.bench)
+                run_benches(tf->exe, threads, &opts);
+            else
+                run_test(tf->exe, threads, &opts);
 
  pass:
             close_testfile(tf);
-        } // XXX what does it mean if tf == NULL?
+        } else { // the diagnostics say why
+            ret = -1;
+        }
+    }
 
-        optind++;
+    if (runs.runs) {
+        while (runs.n_running > 0)
+            reap_runs(&runs, TRUE, &opts);
+        if (runs.failed)
+            ret = -1;
+        free(runs.runs);
     }
 
+    for (long t = 0; t < n_threads; t++)
+        pthread_join(threads[t], NULL);
+    free(threads);
+    pthread_cond_destroy(&pool.job_done);
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.jobs);
+
+    if (opts.bench_samples) {
+        if (finish_baselines(&opts, &conf))
+            ret = -1;
+        unlink(opts.bench_samples);
+    }
+    remove_helpers(&helpers);
+
     free_config(&conf);
 
-    return 0;
+    return ret;
 }
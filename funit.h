@@ -2,17 +2,26 @@
 #define FUNIT_H
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 struct Config {
     char *build;
     void *build_fragments;
+    char *module_build;            // compiles the funit modules, or NULL
+    void *module_build_fragments;
     char *fortran_ext;
     char *template_ext;
+    char *cache_dir;
+    char *baseline_dir;
+    double bench_threshold;  // percent
     size_t build_len;
+    size_t module_build_len;
     size_t fortran_ext_len;
     size_t template_ext_len;
+    size_t cache_dir_len;
+    size_t baseline_dir_len;
 };
 
 struct StringBuffer {
@@ -20,8 +29,29 @@ struct StringBuffer {
     size_t cap, len;
 };
 
+/* A piece of emitted output: len bytes at s, or at offset off in the
+ * Emitter's scratch buffer if s is NULL.
+ */
+struct EmitSpan {
+    const char *s;
+    size_t off, len;
+};
+
+/* Generated code as a list of spans, see emit.c.
+ */
+struct Emitter {
+    struct EmitSpan *spans;
+    size_t n, cap;
+    struct StringBuffer scratch;   // formatted text
+    size_t len;                    // total bytes emitted
+};
+
+struct iovec;
+typedef int emit_consumer(void *data, const struct iovec *iov, int iovcnt);
+
 struct ParseState {
     const char *path;
+    FILE *err;              // where parse errors are reported
     int fd;
     size_t bufsize;
 
@@ -60,6 +90,13 @@ enum MacroType {
     ASSERT_EQUAL_WITH,
     ASSERT_ARRAY_EQUAL,
     ASSERT_ARRAY_EQUAL_WITH,
+    ASSERT_CLOSE,
+    ASSERT_ARRAY_CLOSE,
+    ASSERT_ULP,
+    ASSERT_ARRAY_ULP,
+    ASSERT_TIME_BELOW,
+    ASSERT_FASTER_THAN,
+    ASSERT_MAX_ALLOCATIONS,
     FLUNK
 };
 
@@ -104,38 +141,107 @@ struct TestCase {
     struct TestCase *next;
     char *name;
     size_t namelen;
+    char *case_name;  // "c" of "test name(c) over table", or NULL
+    size_t case_namelen;
+    char *over;       // the table, run once for each of its elements
+    size_t overlen;
     int need_array_iterator;
     struct Code *code;
 };
 
+/* One of the versions of a bench's timed code compared by "compare".
+ */
+struct BenchVariant {
+    struct BenchVariant *next;
+    char *name;
+    size_t namelen;
+    struct Code *timed;
+};
+
+/* A benchmark denoted by the "bench" macro.  setup runs once, timed is run
+ * repeatedly in the timed region, and after runs once at the end.
+ */
+struct TestBench {
+    struct TestBench *next;
+    char *name;
+    size_t namelen;
+    char *bytes, *flops;  // Fortran expressions for the work done by an
+                          // iteration, or NULL
+    size_t bytes_len, flops_len;
+    char *sweep_name;     // an integer the bench is run for each value of,
+    size_t sweep_namelen; // or NULL
+    struct Code *sweep;   // the values, as ARG_CODE in order
+    struct Code *setup, *timed, *after;
+    struct BenchVariant *variants;  // timed in turn instead of timed, in
+    size_t n_variants;              // order, or NULL
+};
+
+/* How a set's exact comparisons (assert_equal, assert_array_equal and the
+ * _with assertions with zero tolerance) compare reals.
+ */
+enum ExactCompare {
+    EXACT_VALUE,      // with ==, so NaN /= NaN and 0.0 == -0.0
+    EXACT_NAN_EQUAL,  // with ==, except that any NaN equals any other
+    EXACT_BITWISE     // bit for bit, for reproducibility tests
+};
+
 /* A set of test cases denoted by the "set" macro.
  */
 struct TestSet {
     struct TestSet *next;
     struct TestDependency *deps;
     struct TestModule *mods;
-    struct Code *setup, *teardown;
+    struct Code *setup, *teardown;          // around each test
+    struct Code *setup_set, *teardown_set;  // once around all of them
     struct TestCase *tests;
+    struct TestBench *benches;
     struct Code *code;
-    size_t n_deps, n_mods, n_tests;
+    size_t n_deps, n_mods, n_tests, n_benches;
     char *name;
     size_t namelen;
-    double tolerance;
+    double tolerance;    // or NO_TOLERANCE if the set gives none
+    enum ExactCompare exact_compare;
+    int mismatch_stats;  // mismatches listed by failing array assertions,
+                         // or -1 to just report the first
+    int parallel_asserts;  // size from which array assertions use OpenMP,
+                           // or -1 to never
+    int threads;     // OpenMP threads its tests use, or 0 if not declared
+    double memory;   // bytes its tests need at most, or 0 if not declared
+};
+
+/* The raw samples of a bench run, in seconds per iteration.
+ */
+struct BenchSamples {
+    struct BenchSamples *next;
+    char *key;  // "set/bench", or "set/bench (n = 1000)" for a sweep
+    double *t;
+    size_t n;
 };
 
 struct TestFile {
     const char *path;
     const char *exe;
+    const char *src_f;  // if set, overrides {{SRC.F}} in the build command
+    int perf;           // read hardware counters in the test program
+    int memory;         // report each test's memory use
+    const char *perf_c; // if set, the counters' C helper, added to {{DEPS}}
+    const char *memory_c;  // likewise for the memory accounting helper
+    int shared_modules; // the funit modules are built once, not emitted
+    const char *modules_o;  // if set, their object, added to {{DEPS}}
     struct TestSet *sets;
     // private:
     struct ParseState ps;
 };
 
 #define DEFAULT_TOLERANCE (0.00001)
+#define NO_TOLERANCE (-1.0)
+#define DEFAULT_MISMATCHES_SHOWN 10
+#define DEFAULT_PARALLEL_MIN_SIZE 1000000
+#define DEFAULT_BENCH_THRESHOLD 5.0  // percent
 
-// The name of the current test set template file
-// XXX do I really want a global var for this?
-extern const char *test_set_file_name;
+// Bump whenever the parsed TestFile structures change shape so stale parse
+// cache images are ignored.
+#define FUNIT_CACHE_VERSION 18
 
 #ifndef FALSE
 #define FALSE (0)
@@ -162,11 +268,50 @@ int read_config(struct Config *conf);
 void free_config(struct Config *conf);
 
 // Parser interface
-struct TestFile *parse_test_file(const char *path);
+struct TestFile *parse_test_file(const char *path, FILE *err);
+int parse_opened_test_file(struct TestFile *tf);
+void discard_test_sets(struct TestFile *tf);
 void close_testfile(struct TestFile *tf);
+int has_benches(const struct TestFile *tf);
+int uses_memory_helper(const struct TestFile *tf);
+#define MACRO_BIT(type) (1u << (type))
+int uses_macros(const struct TestFile *tf, unsigned types);
+
+// Parse cache
+struct TestFile *parse_test_file_cached(const char *path,
+                                        const char *cache_dir, FILE *err);
+
+// Bench baselines
+int read_bench_samples(const char *path, struct BenchSamples **list,
+                       FILE *err);
+void free_bench_samples(struct BenchSamples *bs);
+int save_baseline(const char *samples_path, const char *baseline_path,
+                  FILE *err);
+int compare_bench_samples(struct BenchSamples *now, struct BenchSamples *base,
+                          double threshold, FILE *out);
+
+// Bench environment
+int check_cpu_list(const char *list, FILE *err);
+int enter_bench_env(const char *list, int set_nice, int nice, FILE *err);
+void leave_bench_env(void);
+int describe_bench_cpu(char *governor, size_t size, double *mhz);
 
 // Code generator
-int generate_code_file(struct TestSet *file, FILE *fout);
+int generate_code_file(const struct TestFile *tf, struct Emitter *out,
+                       FILE *err);
+void generate_modules(const struct TestFile *tf, struct Emitter *out);
+
+// Output buffering for the code generator
+void emit_init(struct Emitter *em);
+void emit_free(struct Emitter *em);
+void emit_span(struct Emitter *em, const char *s, size_t len);
+void emit_str(struct Emitter *em, const char *s);
+void emit_printf(struct Emitter *em, const char *format, ...);
+int emit_consume(struct Emitter *em, emit_consumer *consumer, void *data);
+int emit_writev(struct Emitter *em, int fd);
+int emit_write_file(struct Emitter *em, const char *path, FILE *err);
+int emit_memory_file(struct Emitter *em, const char *name, char *path,
+                     size_t path_size, FILE *err);
 
 // build rules
 void *parse_build_rule(char *build);
@@ -179,7 +324,10 @@ void free_build_fragments(void *p);
 char *fu_strndup(const char *str, size_t len);
 char *fu_strdup(const char *str);
 int fu_file_exists(const char *path);
+uint64_t fu_hash(const void *data, size_t len);
+int fu_write_all(int fd, const void *data, size_t len);
 char *fu_sub_file_ext(const char *path, const char *oldext, const char *newext);
+double fu_parse_size(const char *s, char **end);
 
 void sb_init(struct StringBuffer *sb, size_t length);
 void sb_free(struct StringBuffer *sb);
@@ -0,0 +1,2087 @@
+const char arrays_module_code[] = \
+  "! Array assertions, for the test programs that have them.  This is a\n" \
+  "! template: expand_kinds.rb writes out its comparisons for each kind.\n" \
+  "module funit_arrays\n" \
+  "  use, intrinsic :: iso_c_binding, only: c_loc, c_f_pointer\n" \
+  "  use, intrinsic :: iso_fortran_env, only: int8, int16, int32, int64, &\n" \
+  "       real32, real64\n" \
+  "  use funit\n" \
+  "  implicit none\n" \
+  "  save\n" \
+  "  private :: c_loc, c_f_pointer, int8, int16, int32, int64, real32, real64\n" \
+  "\n" \
+  "  ! The kinds the comparisons are written out for.\n" \
+  "\n" \
+  "  ! Pairs of kinds that can be compared: an array against one with a\n" \
+  "  ! literal's kind (default integer, default real or double precision), or\n" \
+  "  ! complexes of the other kind.  The fields are a's kind, b's kind and the\n" \
+  "  ! kind both are converted to, which holds the values of either.\n" \
+  "\n" \
+  "  ! What a message says about the mismatches between two arrays.\n" \
+  "  type funit_mismatch_stats\n" \
+  "     integer(int64) :: n = 0, count = 0, max_abs_i = 0, max_rel_i = 0\n" \
+  "     real(real64) :: max_abs = 0, max_rel = 0, sumsq = 0\n" \
+  "  end type funit_mismatch_stats\n" \
+  "\n" \
+  "  ! The array comparisons count their mismatches this many elements at a\n" \
+  "  ! time, each a vectorized loop, and split the chunks between threads.\n" \
+  "  integer(int64), parameter :: funit_chunk = 4096\n" \
+  "\n" \
+  "  ! Values of tol for funit_array_differ and funit_differs that ask for an\n" \
+  "  ! exact comparison of reals: by value, by value but with any NaN equal to\n" \
+  "  ! any other, or bit for bit.\n" \
+  "  real(real64), parameter :: funit_exact = -1, funit_exact_nan_equal = -2, &\n" \
+  "       funit_exact_bitwise = -3\n" \
+  "\n" \
+  "  ! Compares two arrays of any rank, with a tolerance unless tol < 0 (see\n" \
+  "  ! funit_exact; integers and the rest are always compared by value).  If\n" \
+  "  ! they differ, the result is true and message says where: either just the\n" \
+  "  ! first element that differs (nshow < 0), or how many do, the largest\n" \
+  "  ! absolute and relative errors and the rms error of numbers, and the first\n" \
+  "  ! nshow mismatches; passed is set to the opposite of the result.  Both\n" \
+  "  ! arrays must have the same type and kind, or kinds paired in a *_PAIRS\n" \
+  "  ! list, which are compared as copies converted to the wider kind.  They\n" \
+  "  ! are compared as flat views of contiguous storage, so a non-contiguous\n" \
+  "  ! actual argument is copied in.\n" \
+  "  ! a_lb and b_lb are the arrays' lower bounds, which assumed-rank dummies\n" \
+  "  ! don't keep, for the subscripts in the message.  Arrays of at least\n" \
+  "  ! funit_parallel_min_size elements are compared in parallel.\n" \
+  "  interface funit_array_differ\n" \
+  "     module procedure funit_array_differ_int8\n" \
+  "     module procedure funit_array_differ_int16\n" \
+  "     module procedure funit_array_differ_int32\n" \
+  "     module procedure funit_array_differ_int64\n" \
+  "     module procedure funit_array_differ_real32\n" \
+  "     module procedure funit_array_differ_real64\n" \
+  "     module procedure funit_array_differ_complex32\n" \
+  "     module procedure funit_array_differ_complex64\n" \
+  "     module procedure funit_array_differ_int8_int32\n" \
+  "     module procedure funit_array_differ_int16_int32\n" \
+  "     module procedure funit_array_differ_int64_int32\n" \
+  "     module procedure funit_array_differ_real32_int32\n" \
+  "     module procedure funit_array_differ_real32_real64\n" \
+  "     module procedure funit_array_differ_real64_int32\n" \
+  "     module procedure funit_array_differ_real64_real32\n" \
+  "     module procedure funit_array_differ_complex32_int32\n" \
+  "     module procedure funit_array_differ_complex32_real32\n" \
+  "     module procedure funit_array_differ_complex32_real64\n" \
+  "     module procedure funit_array_differ_complex32_complex64\n" \
+  "     module procedure funit_array_differ_complex64_int32\n" \
+  "     module procedure funit_array_differ_complex64_real32\n" \
+  "     module procedure funit_array_differ_complex64_real64\n" \
+  "     module procedure funit_array_differ_complex64_complex32\n" \
+  "     module procedure funit_array_differ_logical\n" \
+  "     module procedure funit_array_differ_character\n" \
+  "  end interface funit_array_differ\n" \
+  "\n" \
+  "  ! One element's comparison in funit_array_differ.\n" \
+  "  interface funit_differs\n" \
+  "     module procedure funit_differs_int8\n" \
+  "     module procedure funit_differs_int16\n" \
+  "     module procedure funit_differs_int32\n" \
+  "     module procedure funit_differs_int64\n" \
+  "     module procedure funit_differs_real32\n" \
+  "     module procedure funit_differs_real64\n" \
+  "     module procedure funit_differs_complex32\n" \
+  "     module procedure funit_differs_complex64\n" \
+  "     module procedure funit_differs_logical\n" \
+  "     module procedure funit_differs_character\n" \
+  "  end interface funit_differs\n" \
+  "\n" \
+  "  ! Whether funit_differs says any elements of two arrays differ, with the\n" \
+  "  ! choice of comparison made once, outside the loop.\n" \
+  "  interface funit_any_differ\n" \
+  "     module procedure funit_any_differ_int8\n" \
+  "     module procedure funit_any_differ_int16\n" \
+  "     module procedure funit_any_differ_int32\n" \
+  "     module procedure funit_any_differ_int64\n" \
+  "     module procedure funit_any_differ_real32\n" \
+  "     module procedure funit_any_differ_real64\n" \
+  "     module procedure funit_any_differ_complex32\n" \
+  "     module procedure funit_any_differ_complex64\n" \
+  "     module procedure funit_any_differ_logical\n" \
+  "     module procedure funit_any_differ_character\n" \
+  "  end interface funit_any_differ\n" \
+  "\n" \
+  "  ! An element's error abs(x - y) and the size abs(y) it is relative to, as\n" \
+  "  ! reals, without the overflow of integer arithmetic in x's kind.\n" \
+  "  interface funit_distance\n" \
+  "     module procedure funit_distance_int8\n" \
+  "     module procedure funit_distance_int16\n" \
+  "     module procedure funit_distance_int32\n" \
+  "     module procedure funit_distance_int64\n" \
+  "     module procedure funit_distance_real32\n" \
+  "     module procedure funit_distance_real64\n" \
+  "     module procedure funit_distance_complex32\n" \
+  "     module procedure funit_distance_complex64\n" \
+  "  end interface funit_distance\n" \
+  "\n" \
+  "  interface funit_magnitude\n" \
+  "     module procedure funit_magnitude_int8\n" \
+  "     module procedure funit_magnitude_int16\n" \
+  "     module procedure funit_magnitude_int32\n" \
+  "     module procedure funit_magnitude_int64\n" \
+  "     module procedure funit_magnitude_real32\n" \
+  "     module procedure funit_magnitude_real64\n" \
+  "     module procedure funit_magnitude_complex32\n" \
+  "     module procedure funit_magnitude_complex64\n" \
+  "  end interface funit_magnitude\n" \
+  "\n" \
+  "  ! One element's comparison in funit_array_not_close.\n" \
+  "  interface funit_not_close\n" \
+  "     module procedure funit_not_close_real32\n" \
+  "     module procedure funit_not_close_real64\n" \
+  "     module procedure funit_not_close_complex32\n" \
+  "     module procedure funit_not_close_complex64\n" \
+  "  end interface funit_not_close\n" \
+  "\n" \
+  "  ! Whether two reals or complexes of the same kind differ bit for bit.\n" \
+  "  interface funit_bits_differ\n" \
+  "     module procedure funit_bits_differ_real32\n" \
+  "     module procedure funit_bits_differ_real64\n" \
+  "     module procedure funit_bits_differ_complex32\n" \
+  "     module procedure funit_bits_differ_complex64\n" \
+  "  end interface funit_bits_differ\n" \
+  "\n" \
+  "  ! Like funit_array_differ for real or complex arrays, but with both a\n" \
+  "  ! relative and an absolute tolerance: elements match if\n" \
+  "  ! abs(a - b) <= atol + rtol * abs(b).  NaN never matches.\n" \
+  "  interface funit_array_not_close\n" \
+  "     module procedure funit_array_not_close_real32\n" \
+  "     module procedure funit_array_not_close_real64\n" \
+  "     module procedure funit_array_not_close_complex32\n" \
+  "     module procedure funit_array_not_close_complex64\n" \
+  "     module procedure funit_array_not_close_real32_int32\n" \
+  "     module procedure funit_array_not_close_real32_real64\n" \
+  "     module procedure funit_array_not_close_real64_int32\n" \
+  "     module procedure funit_array_not_close_real64_real32\n" \
+  "     module procedure funit_array_not_close_complex32_int32\n" \
+  "     module procedure funit_array_not_close_complex32_real32\n" \
+  "     module procedure funit_array_not_close_complex32_real64\n" \
+  "     module procedure funit_array_not_close_complex32_complex64\n" \
+  "     module procedure funit_array_not_close_complex64_int32\n" \
+  "     module procedure funit_array_not_close_complex64_real32\n" \
+  "     module procedure funit_array_not_close_complex64_real64\n" \
+  "     module procedure funit_array_not_close_complex64_complex32\n" \
+  "  end interface funit_array_not_close\n" \
+  "\n" \
+  "  ! Like funit_array_differ for real arrays, but elements match if they are\n" \
+  "  ! at most ulps apart (see funit_ulp_distance).  Ulps are a's, so b of\n" \
+  "  ! another kind is converted to a's rather than to the wider kind.\n" \
+  "  interface funit_array_not_within_ulps\n" \
+  "     module procedure funit_array_not_within_ulps_real32\n" \
+  "     module procedure funit_array_not_within_ulps_real64\n" \
+  "     module procedure funit_array_not_within_ulps_real32_int32\n" \
+  "     module procedure funit_array_not_within_ulps_real32_real64\n" \
+  "     module procedure funit_array_not_within_ulps_real64_int32\n" \
+  "     module procedure funit_array_not_within_ulps_real64_real32\n" \
+  "  end interface funit_array_not_within_ulps\n" \
+  "\n" \
+  "contains\n" \
+  "\n" \
+  "  ! \"(1,2,3)\"\n" \
+  "  function funit_int_list(v) result(s)\n" \
+  "    integer(int64), intent(in) :: v(:)\n" \
+  "    character(:), allocatable :: s\n" \
+  "    character(24) :: buf\n" \
+  "    integer :: d\n" \
+  "\n" \
+  "    s = \"(\"\n" \
+  "    do d = 1, size(v)\n" \
+  "       write (buf,'(I0)') v(d)\n" \
+  "       s = s // trim(buf)\n" \
+  "       if (d < size(v)) s = s // \",\"\n" \
+  "    end do\n" \
+  "    s = s // \")\"\n" \
+  "  end function funit_int_list\n" \
+  "\n" \
+  "  function funit_shape_string(shp) result(s)\n" \
+  "    integer, intent(in) :: shp(:)\n" \
+  "    character(:), allocatable :: s\n" \
+  "\n" \
+  "    s = funit_int_list(int(shp, int64))\n" \
+  "  end function funit_shape_string\n" \
+  "\n" \
+  "  ! The subscripts of the i-th element, in array element order, of an array\n" \
+  "  ! with the given shape and lower bounds, as a string.\n" \
+  "  function funit_index_string(i, shp, lb) result(s)\n" \
+  "    integer(int64), intent(in) :: i\n" \
+  "    integer, intent(in) :: shp(:), lb(:)\n" \
+  "    character(:), allocatable :: s\n" \
+  "    integer(int64) :: sub(size(shp)), rest\n" \
+  "    integer :: d\n" \
+  "\n" \
+  "    rest = i - 1\n" \
+  "    do d = 1, size(shp)\n" \
+  "       sub(d) = lb(d) + mod(rest, int(shp(d), int64))\n" \
+  "       rest = rest / shp(d)\n" \
+  "    end do\n" \
+  "    s = funit_int_list(sub)\n" \
+  "  end function funit_index_string\n" \
+  "\n" \
+  "  logical function funit_shapes_differ(a_shape, b_shape, a_name, b_name, &\n" \
+  "       message)\n" \
+  "    integer, intent(in) :: a_shape(:), b_shape(:)\n" \
+  "    character(*), intent(in) :: a_name, b_name\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "\n" \
+  "    funit_shapes_differ = size(a_shape) /= size(b_shape)\n" \
+  "    if (.not. funit_shapes_differ) &\n" \
+  "         funit_shapes_differ = any(a_shape /= b_shape)\n" \
+  "    if (funit_shapes_differ) then\n" \
+  "       write(message,*) \"'\" // a_name // \"' and '\" // b_name // &\n" \
+  "            \"' are not the same shape: \", funit_shape_string(a_shape), &\n" \
+  "            \" vs. \", funit_shape_string(b_shape)\n" \
+  "    end if\n" \
+  "  end function funit_shapes_differ\n" \
+  "\n" \
+  "  ! The largest absolute and relative errors, err and err / ref, of the\n" \
+  "  ! mismatches (where bad is true), where each first occurs, and the sum of\n" \
+  "  ! the squares of all the errors.\n" \
+  "  subroutine funit_stats_errors(st, bad, err, ref)\n" \
+  "    type(funit_mismatch_stats), intent(inout) :: st\n" \
+  "    logical, intent(in) :: bad(:)\n" \
+  "    real(real64), intent(in) :: err(:), ref(:)\n" \
+  "    real(real64) :: sumsq, max_abs, max_rel\n" \
+  "    integer(int64) :: i, abs_i, rel_i\n" \
+  "\n" \
+  "    sumsq = 0\n" \
+  "    max_abs = 0\n" \
+  "    max_rel = 0\n" \
+  "    !$omp parallel do reduction(+:sumsq) reduction(max:max_abs, max_rel) &\n" \
+  "    !$omp if (st%n >= funit_parallel_min_size)\n" \
+  "    do i = 1, st%n\n" \
+  "       sumsq = sumsq + err(i) * err(i)\n" \
+  "       if (bad(i)) then\n" \
+  "          max_abs = max(max_abs, err(i))\n" \
+  "          if (ref(i) > 0) max_rel = max(max_rel, err(i) / ref(i))\n" \
+  "       end if\n" \
+  "    end do\n" \
+  "    abs_i = st%n + 1\n" \
+  "    rel_i = st%n + 1\n" \
+  "    !$omp parallel do reduction(min:abs_i, rel_i) &\n" \
+  "    !$omp if (st%n >= funit_parallel_min_size)\n" \
+  "    do i = 1, st%n\n" \
+  "       if (bad(i)) then\n" \
+  "          if (err(i) == max_abs) abs_i = min(abs_i, i)\n" \
+  "          if (ref(i) > 0) then\n" \
+  "             if (err(i) / ref(i) == max_rel) rel_i = min(rel_i, i)\n" \
+  "          end if\n" \
+  "       end if\n" \
+  "    end do\n" \
+  "    st%sumsq = sumsq\n" \
+  "    st%max_abs = max_abs\n" \
+  "    st%max_rel = max_rel\n" \
+  "    st%max_abs_i = abs_i  ! n + 1 if every error is NaN\n" \
+  "    st%max_rel_i = rel_i\n" \
+  "    if (rel_i > st%n) st%max_rel_i = 0\n" \
+  "  end subroutine funit_stats_errors\n" \
+  "\n" \
+  "  ! \"a is not equal to b at 3 of 100 elements\", then the errors, if any,\n" \
+  "  ! on a line of their own.\n" \
+  "  subroutine funit_stats_message(st, shp, lb, what, message)\n" \
+  "    type(funit_mismatch_stats), intent(in) :: st\n" \
+  "    integer, intent(in) :: shp(:), lb(:)\n" \
+  "    character(*), intent(in) :: what\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    character(24) :: count_s, n_s, abs_s, rel_s, rms_s\n" \
+  "\n" \
+  "    write (count_s,'(I0)') st%count\n" \
+  "    write (n_s,'(I0)') st%n\n" \
+  "    message = \" \" // what // \" at \" // trim(count_s) // \" of \" // trim(n_s) // &\n" \
+  "         \" elements\"\n" \
+  "    if (st%max_abs_i > 0) then\n" \
+  "       write (abs_s,'(ES11.4)') st%max_abs\n" \
+  "       write (rel_s,'(ES11.4)') st%max_rel\n" \
+  "       write (rms_s,'(ES11.4)') sqrt(st%sumsq / max(st%n, 1_int64))\n" \
+  "       message = trim(message) // new_line('a') // \"    max abs error \" // &\n" \
+  "            trim(adjustl(abs_s)) // \" at \" // &\n" \
+  "            funit_index_string(st%max_abs_i, shp, lb)\n" \
+  "       if (st%max_rel_i > 0) then\n" \
+  "          message = trim(message) // \", max rel error \" // &\n" \
+  "               trim(adjustl(rel_s)) // \" at \" // &\n" \
+  "               funit_index_string(st%max_rel_i, shp, lb)\n" \
+  "       end if\n" \
+  "       message = trim(message) // \", rms error \" // trim(adjustl(rms_s))\n" \
+  "    end if\n" \
+  "  end subroutine funit_stats_message\n" \
+  "\n" \
+  "  ! The message for two arrays, flattened to a1 and b1, that differ where\n" \
+  "  ! bad is true: the first mismatch alone (nshow < 0), or how many there\n" \
+  "  ! are, the errors if the elements have them (err, relative to ref) and\n" \
+  "  ! the first nshow mismatches, or as many as fit, then how many more\n" \
+  "  ! there are.  This is all of an array comparison but the comparison\n" \
+  "  ! itself, which is done for each kind.  Arrays of at least\n" \
+  "  ! funit_parallel_min_size elements are scanned in parallel.\n" \
+  "  subroutine funit_mismatch_message(bad, a1, b1, nshow, shp, a_lb, b_lb, &\n" \
+  "       a_name, what, b_name, message, err, ref)\n" \
+  "    logical, intent(in) :: bad(:)\n" \
+  "    class(*), intent(in) :: a1(:), b1(:)\n" \
+  "    integer, intent(in) :: nshow, shp(:), a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real64), intent(in), optional :: err(:), ref(:)\n" \
+  "    type(funit_mismatch_stats) :: st\n" \
+  "    character(:), allocatable :: line\n" \
+  "    character(24) :: more_s\n" \
+  "    integer(int64) :: n, i, first, nbad\n" \
+  "\n" \
+  "    n = size(bad, kind=int64)\n" \
+  "    ! the first mismatch is the lowest index that differs, even in parallel\n" \
+  "    first = n + 1\n" \
+  "    !$omp parallel do reduction(min:first) if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n\n" \
+  "       if (bad(i)) first = min(first, i)\n" \
+  "    end do\n" \
+  "    if (nshow < 0) then\n" \
+  "       message = \" \" // a_name // funit_index_string(first, shp, a_lb) // &\n" \
+  "            \" \" // what // \" \" // b_name // &\n" \
+  "            funit_index_string(first, shp, b_lb) // \": \" // &\n" \
+  "            funit_value_string(a1(first)) // \" vs \" // &\n" \
+  "            funit_value_string(b1(first))\n" \
+  "       return\n" \
+  "    end if\n" \
+  "\n" \
+  "    nbad = 0\n" \
+  "    !$omp parallel do reduction(+:nbad) if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n\n" \
+  "       if (bad(i)) nbad = nbad + 1\n" \
+  "    end do\n" \
+  "    st%n = n\n" \
+  "    st%count = nbad\n" \
+  "    if (present(err)) then\n" \
+  "       call funit_stats_errors(st, bad, err, ref)\n" \
+  "       if (st%max_abs_i > n) st%max_abs_i = first\n" \
+  "    end if\n" \
+  "    call funit_stats_message(st, shp, a_lb, a_name // \" \" // what // &\n" \
+  "         \" \" // b_name, message)\n" \
+  "    ! a line for each mismatch shown, leaving room to say how many weren't\n" \
+  "    nbad = 0\n" \
+  "    do i = first, n\n" \
+  "       if (nbad >= nshow) exit\n" \
+  "       if (bad(i)) then\n" \
+  "          line = new_line('a') // \"    \" // a_name // &\n" \
+  "               funit_index_string(i, shp, a_lb) // \": \" // &\n" \
+  "               funit_value_string(a1(i)) // \" vs \" // &\n" \
+  "               funit_value_string(b1(i))\n" \
+  "          if (len_trim(message) + len(line) + 32 > len(message)) exit\n" \
+  "          message = trim(message) // line\n" \
+  "          nbad = nbad + 1\n" \
+  "       end if\n" \
+  "    end do\n" \
+  "    if (nshow > 0 .and. nbad < st%count) then\n" \
+  "       write (more_s,'(I0)') st%count - nbad\n" \
+  "       message = trim(message) // new_line('a') // \"    ... (\" // &\n" \
+  "            trim(more_s) // \" more)\"\n" \
+  "    end if\n" \
+  "  end subroutine funit_mismatch_message\n" \
+  "\n" \
+  "  ! x and y differ by more than tol, or if tol < 0, at all, compared as tol\n" \
+  "  ! says (see funit_exact).  Under a tolerance a NaN differs from everything.\n" \
+  "  ! Logicals and characters are always compared exactly.\n" \
+  "  elemental logical function funit_differs_int8(x, y, tol) result(differs)\n" \
+  "    integer(int8), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differs = funit_distance(x, y) > tol\n" \
+  "    else\n" \
+  "       differs = x /= y\n" \
+  "    end if\n" \
+  "  end function funit_differs_int8\n" \
+  "\n" \
+  "  elemental logical function funit_differs_int16(x, y, tol) result(differs)\n" \
+  "    integer(int16), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differs = funit_distance(x, y) > tol\n" \
+  "    else\n" \
+  "       differs = x /= y\n" \
+  "    end if\n" \
+  "  end function funit_differs_int16\n" \
+  "\n" \
+  "  elemental logical function funit_differs_int32(x, y, tol) result(differs)\n" \
+  "    integer(int32), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differs = funit_distance(x, y) > tol\n" \
+  "    else\n" \
+  "       differs = x /= y\n" \
+  "    end if\n" \
+  "  end function funit_differs_int32\n" \
+  "\n" \
+  "  elemental logical function funit_differs_int64(x, y, tol) result(differs)\n" \
+  "    integer(int64), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differs = funit_distance(x, y) > tol\n" \
+  "    else\n" \
+  "       differs = x /= y\n" \
+  "    end if\n" \
+  "  end function funit_differs_int64\n" \
+  "\n" \
+  "  elemental logical function funit_differs_real32(x, y, tol) result(differs)\n" \
+  "    real(real32), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differs = .not. (abs(x - y) <= tol)\n" \
+  "    else if (tol == funit_exact_bitwise) then\n" \
+  "       differs = funit_bits_differ(x, y)\n" \
+  "    else if (tol == funit_exact_nan_equal) then\n" \
+  "       differs = x /= y .and. (x == x .or. y == y)\n" \
+  "    else\n" \
+  "       differs = x /= y\n" \
+  "    end if\n" \
+  "  end function funit_differs_real32\n" \
+  "\n" \
+  "  elemental logical function funit_differs_real64(x, y, tol) result(differs)\n" \
+  "    real(real64), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differs = .not. (abs(x - y) <= tol)\n" \
+  "    else if (tol == funit_exact_bitwise) then\n" \
+  "       differs = funit_bits_differ(x, y)\n" \
+  "    else if (tol == funit_exact_nan_equal) then\n" \
+  "       differs = x /= y .and. (x == x .or. y == y)\n" \
+  "    else\n" \
+  "       differs = x /= y\n" \
+  "    end if\n" \
+  "  end function funit_differs_real64\n" \
+  "\n" \
+  "  elemental logical function funit_differs_complex32(x, y, tol) result(differs)\n" \
+  "    complex(real32), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differs = .not. (abs(x - y) <= tol)\n" \
+  "    else if (tol == funit_exact_bitwise) then\n" \
+  "       differs = funit_bits_differ(x, y)\n" \
+  "    else if (tol == funit_exact_nan_equal) then\n" \
+  "       differs = x /= y .and. (x == x .or. y == y)\n" \
+  "    else\n" \
+  "       differs = x /= y\n" \
+  "    end if\n" \
+  "  end function funit_differs_complex32\n" \
+  "\n" \
+  "  elemental logical function funit_differs_complex64(x, y, tol) result(differs)\n" \
+  "    complex(real64), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differs = .not. (abs(x - y) <= tol)\n" \
+  "    else if (tol == funit_exact_bitwise) then\n" \
+  "       differs = funit_bits_differ(x, y)\n" \
+  "    else if (tol == funit_exact_nan_equal) then\n" \
+  "       differs = x /= y .and. (x == x .or. y == y)\n" \
+  "    else\n" \
+  "       differs = x /= y\n" \
+  "    end if\n" \
+  "  end function funit_differs_complex64\n" \
+  "\n" \
+  "  elemental logical function funit_differs_logical(x, y, tol) result(differs)\n" \
+  "    logical, intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: tol ! does not apply\n" \
+  "\n" \
+  "    differs = x .neqv. y\n" \
+  "  end function funit_differs_logical\n" \
+  "\n" \
+  "  elemental logical function funit_differs_character(x, y, tol) result(differs)\n" \
+  "    character(*), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: tol ! does not apply\n" \
+  "\n" \
+  "    differs = x /= y\n" \
+  "  end function funit_differs_character\n" \
+  "\n" \
+  "  logical function funit_any_differ_int8(a, b, tol) result(differ)\n" \
+  "    integer(int8), contiguous, intent(in) :: a(:), b(:)\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differ = any(funit_distance(a, b) > tol)\n" \
+  "    else\n" \
+  "       differ = any(a /= b)\n" \
+  "    end if\n" \
+  "  end function funit_any_differ_int8\n" \
+  "\n" \
+  "  logical function funit_any_differ_int16(a, b, tol) result(differ)\n" \
+  "    integer(int16), contiguous, intent(in) :: a(:), b(:)\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differ = any(funit_distance(a, b) > tol)\n" \
+  "    else\n" \
+  "       differ = any(a /= b)\n" \
+  "    end if\n" \
+  "  end function funit_any_differ_int16\n" \
+  "\n" \
+  "  logical function funit_any_differ_int32(a, b, tol) result(differ)\n" \
+  "    integer(int32), contiguous, intent(in) :: a(:), b(:)\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differ = any(funit_distance(a, b) > tol)\n" \
+  "    else\n" \
+  "       differ = any(a /= b)\n" \
+  "    end if\n" \
+  "  end function funit_any_differ_int32\n" \
+  "\n" \
+  "  logical function funit_any_differ_int64(a, b, tol) result(differ)\n" \
+  "    integer(int64), contiguous, intent(in) :: a(:), b(:)\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    if (tol >= 0) then\n" \
+  "       differ = any(funit_distance(a, b) > tol)\n" \
+  "    else\n" \
+  "       differ = any(a /= b)\n" \
+  "    end if\n" \
+  "  end function funit_any_differ_int64\n" \
+  "\n" \
+  "  logical function funit_any_differ_real32(a, b, tol) result(differ)\n" \
+  "    real(real32), contiguous, intent(in) :: a(:), b(:)\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    ! count() has no early exit to stop the loop vectorizing\n" \
+  "    if (tol >= 0) then\n" \
+  "       differ = count(.not. (abs(a - b) <= tol)) > 0\n" \
+  "    else if (tol == funit_exact_bitwise) then\n" \
+  "       differ = count(funit_bits_differ(a, b)) > 0\n" \
+  "    else if (tol == funit_exact_nan_equal) then\n" \
+  "       differ = count(a /= b .and. (a == a .or. b == b)) > 0\n" \
+  "    else\n" \
+  "       differ = count(a /= b) > 0\n" \
+  "    end if\n" \
+  "  end function funit_any_differ_real32\n" \
+  "\n" \
+  "  logical function funit_any_differ_real64(a, b, tol) result(differ)\n" \
+  "    real(real64), contiguous, intent(in) :: a(:), b(:)\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    ! count() has no early exit to stop the loop vectorizing\n" \
+  "    if (tol >= 0) then\n" \
+  "       differ = count(.not. (abs(a - b) <= tol)) > 0\n" \
+  "    else if (tol == funit_exact_bitwise) then\n" \
+  "       differ = count(funit_bits_differ(a, b)) > 0\n" \
+  "    else if (tol == funit_exact_nan_equal) then\n" \
+  "       differ = count(a /= b .and. (a == a .or. b == b)) > 0\n" \
+  "    else\n" \
+  "       differ = count(a /= b) > 0\n" \
+  "    end if\n" \
+  "  end function funit_any_differ_real64\n" \
+  "\n" \
+  "  logical function funit_any_differ_complex32(a, b, tol) result(differ)\n" \
+  "    complex(real32), contiguous, intent(in) :: a(:), b(:)\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    ! count() has no early exit to stop the loop vectorizing\n" \
+  "    if (tol >= 0) then\n" \
+  "       differ = count(.not. (abs(a - b) <= tol)) > 0\n" \
+  "    else if (tol == funit_exact_bitwise) then\n" \
+  "       differ = count(funit_bits_differ(a, b)) > 0\n" \
+  "    else if (tol == funit_exact_nan_equal) then\n" \
+  "       differ = count(a /= b .and. (a == a .or. b == b)) > 0\n" \
+  "    else\n" \
+  "       differ = count(a /= b) > 0\n" \
+  "    end if\n" \
+  "  end function funit_any_differ_complex32\n" \
+  "\n" \
+  "  logical function funit_any_differ_complex64(a, b, tol) result(differ)\n" \
+  "    complex(real64), contiguous, intent(in) :: a(:), b(:)\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "\n" \
+  "    ! count() has no early exit to stop the loop vectorizing\n" \
+  "    if (tol >= 0) then\n" \
+  "       differ = count(.not. (abs(a - b) <= tol)) > 0\n" \
+  "    else if (tol == funit_exact_bitwise) then\n" \
+  "       differ = count(funit_bits_differ(a, b)) > 0\n" \
+  "    else if (tol == funit_exact_nan_equal) then\n" \
+  "       differ = count(a /= b .and. (a == a .or. b == b)) > 0\n" \
+  "    else\n" \
+  "       differ = count(a /= b) > 0\n" \
+  "    end if\n" \
+  "  end function funit_any_differ_complex64\n" \
+  "\n" \
+  "  logical function funit_any_differ_logical(a, b, tol) result(differ)\n" \
+  "    logical, contiguous, intent(in) :: a(:), b(:)\n" \
+  "    real(real64), intent(in) :: tol ! does not apply\n" \
+  "\n" \
+  "    differ = any(a .neqv. b)\n" \
+  "  end function funit_any_differ_logical\n" \
+  "\n" \
+  "  logical function funit_any_differ_character(a, b, tol) result(differ)\n" \
+  "    character(*), contiguous, intent(in) :: a(:), b(:)\n" \
+  "    real(real64), intent(in) :: tol ! does not apply\n" \
+  "\n" \
+  "    differ = any(a /= b)\n" \
+  "  end function funit_any_differ_character\n" \
+  "\n" \
+  "  ! Subtracting integers of opposite signs can overflow, so their distance\n" \
+  "  ! is taken in reals, which are exact below 2**53.\n" \
+  "  elemental real(real64) function funit_distance_int8(x, y) result(d)\n" \
+  "    integer(int8), intent(in) :: x, y\n" \
+  "\n" \
+  "    if ((x < 0) .eqv. (y < 0)) then\n" \
+  "       d = real(abs(x - y), real64)\n" \
+  "    else\n" \
+  "       d = abs(real(x, real64) - real(y, real64))\n" \
+  "    end if\n" \
+  "  end function funit_distance_int8\n" \
+  "\n" \
+  "  elemental real(real64) function funit_magnitude_int8(x) result(m)\n" \
+  "    integer(int8), intent(in) :: x\n" \
+  "\n" \
+  "    m = abs(real(x, real64))\n" \
+  "  end function funit_magnitude_int8\n" \
+  "\n" \
+  "  elemental real(real64) function funit_distance_int16(x, y) result(d)\n" \
+  "    integer(int16), intent(in) :: x, y\n" \
+  "\n" \
+  "    if ((x < 0) .eqv. (y < 0)) then\n" \
+  "       d = real(abs(x - y), real64)\n" \
+  "    else\n" \
+  "       d = abs(real(x, real64) - real(y, real64))\n" \
+  "    end if\n" \
+  "  end function funit_distance_int16\n" \
+  "\n" \
+  "  elemental real(real64) function funit_magnitude_int16(x) result(m)\n" \
+  "    integer(int16), intent(in) :: x\n" \
+  "\n" \
+  "    m = abs(real(x, real64))\n" \
+  "  end function funit_magnitude_int16\n" \
+  "\n" \
+  "  elemental real(real64) function funit_distance_int32(x, y) result(d)\n" \
+  "    integer(int32), intent(in) :: x, y\n" \
+  "\n" \
+  "    if ((x < 0) .eqv. (y < 0)) then\n" \
+  "       d = real(abs(x - y), real64)\n" \
+  "    else\n" \
+  "       d = abs(real(x, real64) - real(y, real64))\n" \
+  "    end if\n" \
+  "  end function funit_distance_int32\n" \
+  "\n" \
+  "  elemental real(real64) function funit_magnitude_int32(x) result(m)\n" \
+  "    integer(int32), intent(in) :: x\n" \
+  "\n" \
+  "    m = abs(real(x, real64))\n" \
+  "  end function funit_magnitude_int32\n" \
+  "\n" \
+  "  elemental real(real64) function funit_distance_int64(x, y) result(d)\n" \
+  "    integer(int64), intent(in) :: x, y\n" \
+  "\n" \
+  "    if ((x < 0) .eqv. (y < 0)) then\n" \
+  "       d = real(abs(x - y), real64)\n" \
+  "    else\n" \
+  "       d = abs(real(x, real64) - real(y, real64))\n" \
+  "    end if\n" \
+  "  end function funit_distance_int64\n" \
+  "\n" \
+  "  elemental real(real64) function funit_magnitude_int64(x) result(m)\n" \
+  "    integer(int64), intent(in) :: x\n" \
+  "\n" \
+  "    m = abs(real(x, real64))\n" \
+  "  end function funit_magnitude_int64\n" \
+  "\n" \
+  "  elemental real(real64) function funit_distance_real32(x, y) result(d)\n" \
+  "    real(real32), intent(in) :: x, y\n" \
+  "\n" \
+  "    d = real(abs(x - y), real64)\n" \
+  "  end function funit_distance_real32\n" \
+  "\n" \
+  "  elemental real(real64) function funit_magnitude_real32(x) result(m)\n" \
+  "    real(real32), intent(in) :: x\n" \
+  "\n" \
+  "    m = real(abs(x), real64)\n" \
+  "  end function funit_magnitude_real32\n" \
+  "\n" \
+  "  elemental real(real64) function funit_distance_real64(x, y) result(d)\n" \
+  "    real(real64), intent(in) :: x, y\n" \
+  "\n" \
+  "    d = real(abs(x - y), real64)\n" \
+  "  end function funit_distance_real64\n" \
+  "\n" \
+  "  elemental real(real64) function funit_magnitude_real64(x) result(m)\n" \
+  "    real(real64), intent(in) :: x\n" \
+  "\n" \
+  "    m = real(abs(x), real64)\n" \
+  "  end function funit_magnitude_real64\n" \
+  "\n" \
+  "  elemental real(real64) function funit_distance_complex32(x, y) result(d)\n" \
+  "    complex(real32), intent(in) :: x, y\n" \
+  "\n" \
+  "    d = real(abs(x - y), real64)\n" \
+  "  end function funit_distance_complex32\n" \
+  "\n" \
+  "  elemental real(real64) function funit_magnitude_complex32(x) result(m)\n" \
+  "    complex(real32), intent(in) :: x\n" \
+  "\n" \
+  "    m = real(abs(x), real64)\n" \
+  "  end function funit_magnitude_complex32\n" \
+  "\n" \
+  "  elemental real(real64) function funit_distance_complex64(x, y) result(d)\n" \
+  "    complex(real64), intent(in) :: x, y\n" \
+  "\n" \
+  "    d = real(abs(x - y), real64)\n" \
+  "  end function funit_distance_complex64\n" \
+  "\n" \
+  "  elemental real(real64) function funit_magnitude_complex64(x) result(m)\n" \
+  "    complex(real64), intent(in) :: x\n" \
+  "\n" \
+  "    m = real(abs(x), real64)\n" \
+  "  end function funit_magnitude_complex64\n" \
+  "\n" \
+  "  ! x is not within atol + rtol * abs(y) of y, or either is NaN.\n" \
+  "  elemental logical function funit_not_close_real32(x, y, rtol, atol) &\n" \
+  "       result(differs)\n" \
+  "    real(real32), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "\n" \
+  "    differs = .not. (abs(x - y) <= atol + rtol * abs(y))\n" \
+  "  end function funit_not_close_real32\n" \
+  "\n" \
+  "  elemental logical function funit_not_close_real64(x, y, rtol, atol) &\n" \
+  "       result(differs)\n" \
+  "    real(real64), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "\n" \
+  "    differs = .not. (abs(x - y) <= atol + rtol * abs(y))\n" \
+  "  end function funit_not_close_real64\n" \
+  "\n" \
+  "  elemental logical function funit_not_close_complex32(x, y, rtol, atol) &\n" \
+  "       result(differs)\n" \
+  "    complex(real32), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "\n" \
+  "    differs = .not. (abs(x - y) <= atol + rtol * abs(y))\n" \
+  "  end function funit_not_close_complex32\n" \
+  "\n" \
+  "  elemental logical function funit_not_close_complex64(x, y, rtol, atol) &\n" \
+  "       result(differs)\n" \
+  "    complex(real64), intent(in) :: x, y\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "\n" \
+  "    differs = .not. (abs(x - y) <= atol + rtol * abs(y))\n" \
+  "  end function funit_not_close_complex64\n" \
+  "\n" \
+  "\n" \
+  "  elemental logical function funit_bits_differ_real32(x, y) result(differ)\n" \
+  "    real(real32), intent(in) :: x, y\n" \
+  "\n" \
+  "    differ = transfer(x, 0_int32) /= transfer(y, 0_int32)\n" \
+  "  end function funit_bits_differ_real32\n" \
+  "\n" \
+  "  elemental logical function funit_bits_differ_real64(x, y) result(differ)\n" \
+  "    real(real64), intent(in) :: x, y\n" \
+  "\n" \
+  "    differ = transfer(x, 0_int64) /= transfer(y, 0_int64)\n" \
+  "  end function funit_bits_differ_real64\n" \
+  "\n" \
+  "  elemental logical function funit_bits_differ_complex32(x, y) result(differ)\n" \
+  "    complex(real32), intent(in) :: x, y\n" \
+  "\n" \
+  "    differ = transfer(x, 0_int64) /= transfer(y, 0_int64)\n" \
+  "  end function funit_bits_differ_complex32\n" \
+  "\n" \
+  "  elemental logical function funit_bits_differ_complex64(x, y) result(differ)\n" \
+  "    complex(real64), intent(in) :: x, y\n" \
+  "\n" \
+  "    differ = transfer(real(x), 0_int64) /= transfer(real(y), 0_int64) &\n" \
+  "         .or. transfer(aimag(x), 0_int64) /= transfer(aimag(y), 0_int64)\n" \
+  "  end function funit_bits_differ_complex64\n" \
+  "\n" \
+  "  logical function funit_array_differ_int8(a, b, tol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    integer(int8), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    integer(int8), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. funit_any_differ(a1(i:j), b1(i:j), tol)\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_differs(a1, b1, tol), &\n" \
+  "         a1, b1, nshow, a_shape, a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_differ_int8\n" \
+  "\n" \
+  "  logical function funit_array_differ_int16(a, b, tol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    integer(int16), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    integer(int16), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. funit_any_differ(a1(i:j), b1(i:j), tol)\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_differs(a1, b1, tol), &\n" \
+  "         a1, b1, nshow, a_shape, a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_differ_int16\n" \
+  "\n" \
+  "  logical function funit_array_differ_int32(a, b, tol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    integer(int32), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. funit_any_differ(a1(i:j), b1(i:j), tol)\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_differs(a1, b1, tol), &\n" \
+  "         a1, b1, nshow, a_shape, a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_differ_int32\n" \
+  "\n" \
+  "  logical function funit_array_differ_int64(a, b, tol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    integer(int64), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    integer(int64), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. funit_any_differ(a1(i:j), b1(i:j), tol)\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_differs(a1, b1, tol), &\n" \
+  "         a1, b1, nshow, a_shape, a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_differ_int64\n" \
+  "\n" \
+  "  logical function funit_array_differ_real32(a, b, tol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    real(real32), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. funit_any_differ(a1(i:j), b1(i:j), tol)\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_differs(a1, b1, tol), &\n" \
+  "         a1, b1, nshow, a_shape, a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_differ_real32\n" \
+  "\n" \
+  "  logical function funit_array_differ_real64(a, b, tol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    real(real64), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. funit_any_differ(a1(i:j), b1(i:j), tol)\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_differs(a1, b1, tol), &\n" \
+  "         a1, b1, nshow, a_shape, a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_differ_real64\n" \
+  "\n" \
+  "  logical function funit_array_differ_complex32(a, b, tol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    complex(real32), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. funit_any_differ(a1(i:j), b1(i:j), tol)\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_differs(a1, b1, tol), &\n" \
+  "         a1, b1, nshow, a_shape, a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_differ_complex32\n" \
+  "\n" \
+  "  logical function funit_array_differ_complex64(a, b, tol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    complex(real64), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. funit_any_differ(a1(i:j), b1(i:j), tol)\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_differs(a1, b1, tol), &\n" \
+  "         a1, b1, nshow, a_shape, a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_differ_complex64\n" \
+  "\n" \
+  "  logical function funit_array_differ_int8_int32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    integer(int8), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer(int8), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    integer(int32), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_int32(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_int8_int32\n" \
+  "\n" \
+  "  logical function funit_array_differ_int16_int32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    integer(int16), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer(int16), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    integer(int32), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_int32(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_int16_int32\n" \
+  "\n" \
+  "  logical function funit_array_differ_int64_int32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    integer(int64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer(int64), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    integer(int64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_int64(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_int64_int32\n" \
+  "\n" \
+  "  logical function funit_array_differ_real32_int32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real32), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    real(real32), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_real32(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_real32_int32\n" \
+  "\n" \
+  "  logical function funit_array_differ_real32_real64(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real32), pointer, contiguous :: a1(:)\n" \
+  "    real(real64), pointer, contiguous :: b1(:)\n" \
+  "    real(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_real64(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_real32_real64\n" \
+  "\n" \
+  "  logical function funit_array_differ_real64_int32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real64), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    real(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_real64(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_real64_int32\n" \
+  "\n" \
+  "  logical function funit_array_differ_real64_real32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real64), pointer, contiguous :: a1(:)\n" \
+  "    real(real32), pointer, contiguous :: b1(:)\n" \
+  "    real(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_real64(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_real64_real32\n" \
+  "\n" \
+  "  logical function funit_array_differ_complex32_int32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real32), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    complex(real32), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_complex32(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_complex32_int32\n" \
+  "\n" \
+  "  logical function funit_array_differ_complex32_real32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real32), pointer, contiguous :: a1(:)\n" \
+  "    real(real32), pointer, contiguous :: b1(:)\n" \
+  "    complex(real32), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_complex32(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_complex32_real32\n" \
+  "\n" \
+  "  logical function funit_array_differ_complex32_real64(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real32), pointer, contiguous :: a1(:)\n" \
+  "    real(real64), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_complex64(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_complex32_real64\n" \
+  "\n" \
+  "  logical function funit_array_differ_complex32_complex64(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real32), pointer, contiguous :: a1(:)\n" \
+  "    complex(real64), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_complex64(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_complex32_complex64\n" \
+  "\n" \
+  "  logical function funit_array_differ_complex64_int32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real64), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_complex64(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_complex64_int32\n" \
+  "\n" \
+  "  logical function funit_array_differ_complex64_real32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real64), pointer, contiguous :: a1(:)\n" \
+  "    real(real32), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_complex64(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_complex64_real32\n" \
+  "\n" \
+  "  logical function funit_array_differ_complex64_real64(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real64), pointer, contiguous :: a1(:)\n" \
+  "    real(real64), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_complex64(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_complex64_real64\n" \
+  "\n" \
+  "  logical function funit_array_differ_complex64_complex32(a, b, tol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: tol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real64), pointer, contiguous :: a1(:)\n" \
+  "    complex(real32), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_differ_complex64(a_c, b_c, tol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_differ_complex64_complex32\n" \
+  "\n" \
+  "  logical function funit_array_differ_logical(a, b, tol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    logical, dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: tol ! tol does not apply; always exact\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    logical, pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. funit_any_differ(a1(i:j), b1(i:j), tol)\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_differs(a1, b1, tol), &\n" \
+  "         a1, b1, nshow, shape(a), a_lb, b_lb, a_name, what, b_name, message)\n" \
+  "  end function funit_array_differ_logical\n" \
+  "\n" \
+  "  logical function funit_array_differ_character(a, b, tol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    character(*), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: tol ! tol does not apply; always exact\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    character(len(a)), pointer, contiguous :: a1(:)\n" \
+  "    character(len(b)), pointer, contiguous :: b1(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. funit_any_differ(a1(i:j), b1(i:j), tol)\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_differs(a1, b1, tol), &\n" \
+  "         a1, b1, nshow, shape(a), a_lb, b_lb, a_name, what, b_name, message)\n" \
+  "  end function funit_array_differ_character\n" \
+  "\n" \
+  "  logical function funit_array_not_close_real32(a, b, rtol, atol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    real(real32), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. &\n" \
+  "            count(funit_not_close(a1(i:j), b1(i:j), rtol, atol)) > 0\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message( &\n" \
+  "         funit_not_close(a1, b1, rtol, atol), a1, b1, nshow, a_shape, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_not_close_real32\n" \
+  "\n" \
+  "  logical function funit_array_not_close_real64(a, b, rtol, atol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    real(real64), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. &\n" \
+  "            count(funit_not_close(a1(i:j), b1(i:j), rtol, atol)) > 0\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message( &\n" \
+  "         funit_not_close(a1, b1, rtol, atol), a1, b1, nshow, a_shape, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_not_close_real64\n" \
+  "\n" \
+  "  logical function funit_array_not_close_complex32(a, b, rtol, atol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    complex(real32), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. &\n" \
+  "            count(funit_not_close(a1(i:j), b1(i:j), rtol, atol)) > 0\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message( &\n" \
+  "         funit_not_close(a1, b1, rtol, atol), a1, b1, nshow, a_shape, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_not_close_complex32\n" \
+  "\n" \
+  "  logical function funit_array_not_close_complex64(a, b, rtol, atol, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    complex(real64), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. &\n" \
+  "            count(funit_not_close(a1(i:j), b1(i:j), rtol, atol)) > 0\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message( &\n" \
+  "         funit_not_close(a1, b1, rtol, atol), a1, b1, nshow, a_shape, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_not_close_complex64\n" \
+  "\n" \
+  "  logical function funit_array_not_close_real32_int32(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real32), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    real(real32), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_real32(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_real32_int32\n" \
+  "\n" \
+  "  logical function funit_array_not_close_real32_real64(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real32), pointer, contiguous :: a1(:)\n" \
+  "    real(real64), pointer, contiguous :: b1(:)\n" \
+  "    real(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_real64(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_real32_real64\n" \
+  "\n" \
+  "  logical function funit_array_not_close_real64_int32(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real64), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    real(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_real64(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_real64_int32\n" \
+  "\n" \
+  "  logical function funit_array_not_close_real64_real32(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real64), pointer, contiguous :: a1(:)\n" \
+  "    real(real32), pointer, contiguous :: b1(:)\n" \
+  "    real(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_real64(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_real64_real32\n" \
+  "\n" \
+  "  logical function funit_array_not_close_complex32_int32(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real32), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    complex(real32), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_complex32(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_complex32_int32\n" \
+  "\n" \
+  "  logical function funit_array_not_close_complex32_real32(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real32), pointer, contiguous :: a1(:)\n" \
+  "    real(real32), pointer, contiguous :: b1(:)\n" \
+  "    complex(real32), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_complex32(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_complex32_real32\n" \
+  "\n" \
+  "  logical function funit_array_not_close_complex32_real64(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real32), pointer, contiguous :: a1(:)\n" \
+  "    real(real64), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_complex64(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_complex32_real64\n" \
+  "\n" \
+  "  logical function funit_array_not_close_complex32_complex64(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real32), pointer, contiguous :: a1(:)\n" \
+  "    complex(real64), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_complex64(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_complex32_complex64\n" \
+  "\n" \
+  "  logical function funit_array_not_close_complex64_int32(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real64), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_complex64(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_complex64_int32\n" \
+  "\n" \
+  "  logical function funit_array_not_close_complex64_real32(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real64), pointer, contiguous :: a1(:)\n" \
+  "    real(real32), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_complex64(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_complex64_real32\n" \
+  "\n" \
+  "  logical function funit_array_not_close_complex64_real64(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real64), pointer, contiguous :: a1(:)\n" \
+  "    real(real64), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_complex64(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_complex64_real64\n" \
+  "\n" \
+  "  logical function funit_array_not_close_complex64_complex32(a, b, rtol, atol, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    complex(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    complex(real32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    real(real64), intent(in) :: rtol, atol\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    complex(real64), pointer, contiguous :: a1(:)\n" \
+  "    complex(real32), pointer, contiguous :: b1(:)\n" \
+  "    complex(real64), allocatable :: a_c(:), b_c(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    a_c = a1\n" \
+  "    b_c = b1\n" \
+  "    differ = funit_array_not_close_complex64(a_c, b_c, rtol, atol, nshow, &\n" \
+  "         a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_close_complex64_complex32\n" \
+  "\n" \
+  "  logical function funit_array_not_within_ulps_real32(a, b, ulps, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    integer(int64), intent(in) :: ulps\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    real(real32), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. &\n" \
+  "            count(funit_ulp_distance(a1(i:j), b1(i:j)) > ulps) > 0\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_ulp_distance(a1, b1) > ulps, &\n" \
+  "         a1, b1, nshow, a_shape, a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_not_within_ulps_real32\n" \
+  "\n" \
+  "  logical function funit_array_not_within_ulps_real64(a, b, ulps, nshow, &\n" \
+  "       a_lb, b_lb, a_name, what, b_name, passed, message, shp) &\n" \
+  "       result(differ)\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: a, b\n" \
+  "    integer(int64), intent(in) :: ulps\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    integer, intent(in), optional :: shp(:)  ! a's, if a and b are flattened\n" \
+  "    real(real64), pointer, contiguous :: a1(:), b1(:)\n" \
+  "    integer, allocatable :: a_shape(:)\n" \
+  "    integer(int64) :: n, i, j\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    a_shape = shape(a)\n" \
+  "    if (present(shp)) a_shape = shp\n" \
+  "\n" \
+  "    n = size(a, kind=int64)\n" \
+  "    call c_f_pointer(c_loc(a), a1, [n])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [n])\n" \
+  "    !$omp parallel do private(j) reduction(.or.:differ) &\n" \
+  "    !$omp if (n >= funit_parallel_min_size)\n" \
+  "    do i = 1, n, funit_chunk\n" \
+  "       j = min(n, i + funit_chunk - 1)\n" \
+  "       differ = differ .or. &\n" \
+  "            count(funit_ulp_distance(a1(i:j), b1(i:j)) > ulps) > 0\n" \
+  "    end do\n" \
+  "    passed = .not. differ\n" \
+  "    if (differ) call funit_mismatch_message(funit_ulp_distance(a1, b1) > ulps, &\n" \
+  "         a1, b1, nshow, a_shape, a_lb, b_lb, a_name, what, b_name, message, &\n" \
+  "         funit_distance(a1, b1), funit_magnitude(b1))\n" \
+  "  end function funit_array_not_within_ulps_real64\n" \
+  "\n" \
+  "  logical function funit_array_not_within_ulps_real32_int32(a, b, ulps, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    integer(int64), intent(in) :: ulps\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real32), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    differ = funit_array_not_within_ulps_real32(a1, real(b1, real32), ulps, &\n" \
+  "         nshow, a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_within_ulps_real32_int32\n" \
+  "\n" \
+  "  logical function funit_array_not_within_ulps_real32_real64(a, b, ulps, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    integer(int64), intent(in) :: ulps\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real32), pointer, contiguous :: a1(:)\n" \
+  "    real(real64), pointer, contiguous :: b1(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    differ = funit_array_not_within_ulps_real32(a1, real(b1, real32), ulps, &\n" \
+  "         nshow, a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_within_ulps_real32_real64\n" \
+  "\n" \
+  "  logical function funit_array_not_within_ulps_real64_int32(a, b, ulps, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    integer(int32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    integer(int64), intent(in) :: ulps\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real64), pointer, contiguous :: a1(:)\n" \
+  "    integer(int32), pointer, contiguous :: b1(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    differ = funit_array_not_within_ulps_real64(a1, real(b1, real64), ulps, &\n" \
+  "         nshow, a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_within_ulps_real64_int32\n" \
+  "\n" \
+  "  logical function funit_array_not_within_ulps_real64_real32(a, b, ulps, &\n" \
+  "       nshow, a_lb, b_lb, a_name, what, b_name, passed, message) result(differ)\n" \
+  "    real(real64), dimension(..), contiguous, target, intent(in) :: a\n" \
+  "    real(real32), dimension(..), contiguous, target, intent(in) :: b\n" \
+  "    integer(int64), intent(in) :: ulps\n" \
+  "    integer, intent(in) :: nshow, a_lb(:), b_lb(:)\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real64), pointer, contiguous :: a1(:)\n" \
+  "    real(real32), pointer, contiguous :: b1(:)\n" \
+  "\n" \
+  "    passed = .false.\n" \
+  "    differ = funit_shapes_differ(shape(a), shape(b), a_name, b_name, message)\n" \
+  "    if (differ) return\n" \
+  "    call c_f_pointer(c_loc(a), a1, [size(a, kind=int64)])\n" \
+  "    call c_f_pointer(c_loc(b), b1, [size(b, kind=int64)])\n" \
+  "    differ = funit_array_not_within_ulps_real64(a1, real(b1, real64), ulps, &\n" \
+  "         nshow, a_lb, b_lb, a_name, what, b_name, passed, message, shape(a))\n" \
+  "  end function funit_array_not_within_ulps_real64_real32\n" \
+  "\n" \
+  "end module funit_arrays\n" \
+;
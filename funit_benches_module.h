@@ -0,0 +1,668 @@
+const char benches_module_code[] = \
+  "! Benchmarks and timing assertions, for the test programs that have them.\n" \
+  "module funit_benches\n" \
+  "  use, intrinsic :: iso_fortran_env, only: int64, real64\n" \
+  "  use funit\n" \
+  "  implicit none\n" \
+  "  save\n" \
+  "  private :: int64, real64\n" \
+  "\n" \
+  "  ! A bench's timed code runs in batches: while warming up, for at least\n" \
+  "  ! funit_bench_warmup seconds, the batch size doubles until a batch takes\n" \
+  "  ! funit_bench_min_time seconds, then funit_bench_samples batches of that\n" \
+  "  ! size are timed.\n" \
+  "  real(real64) :: funit_bench_warmup = 0.1_real64, &\n" \
+  "       funit_bench_min_time = 0.01_real64\n" \
+  "  integer :: funit_bench_samples = 20\n" \
+  "\n" \
+  "  ! With --bench-stable PERCENT, a bench whose samples' coefficient of\n" \
+  "  ! variation is above PERCENT takes funit_bench_samples more, up to\n" \
+  "  ! funit_bench_max_rounds times as many, until it isn't.\n" \
+  "  real(real64) :: funit_bench_stable_cv = 0\n" \
+  "  integer :: funit_bench_max_rounds = 10\n" \
+  "\n" \
+  "  ! The frequency governor and speed in MHz of the CPU the benches run on,\n" \
+  "  ! if given by --bench-governor NAME and --bench-mhz MHZ, for the results.\n" \
+  "  character(:), allocatable :: funit_bench_governor\n" \
+  "  real(real64) :: funit_bench_mhz = 0\n" \
+  "\n" \
+  "  ! Files each bench's results are appended to as a row, if given by\n" \
+  "  ! --bench-csv FILE and --bench-json FILE (JSON Lines, an object a line),\n" \
+  "  ! and its raw samples, for funit to save or compare with a baseline, by\n" \
+  "  ! --bench-samples FILE.\n" \
+  "  character(:), allocatable :: funit_bench_csv, funit_bench_json, &\n" \
+  "       funit_bench_raw\n" \
+  "\n" \
+  "  ! The bench being run.  Clock times are in system_clock counts.  A bench\n" \
+  "  ! comparing variants of its timed code has a funit_variant_state, with a\n" \
+  "  ! name, for each; others have one, without.\n" \
+  "  type funit_variant_state\n" \
+  "     character(:), allocatable :: name\n" \
+  "     integer :: nsamples = 0\n" \
+  "     integer(int64) :: iters = 1\n" \
+  "     logical :: calibrated = .false.\n" \
+  "     real(real64), allocatable :: samples(:)\n" \
+  "     ! with hardware counters, their totals over the samples' iterations\n" \
+  "     integer(int64) :: counts(4) = 0, counted_iters = 0\n" \
+  "  end type funit_variant_state\n" \
+  "  type funit_bench_state\n" \
+  "     character(:), allocatable :: name\n" \
+  "     integer :: phase = 0, variant = 1\n" \
+  "     integer(int64) :: rate = 1, start = 0, warmup_end = 0\n" \
+  "     integer(int64) :: start_counts(4) = 0\n" \
+  "     real(real64) :: bytes = -1, flops = -1  ! per iteration, if given\n" \
+  "     character(:), allocatable :: sweep_name  ! if a sweep\n" \
+  "     integer :: sweep_value = 0\n" \
+  "     type(funit_variant_state), allocatable :: variants(:)\n" \
+  "  end type funit_bench_state\n" \
+  "  type(funit_bench_state), private :: funit_bench\n" \
+  "  integer, parameter, private :: funit_bench_warming = 1, &\n" \
+  "       funit_bench_sampling = 2\n" \
+  "\n" \
+  "  ! A timing assertion's statements (variants), each run in batches: the\n" \
+  "  ! batch size doubles until a batch takes funit_bench_min_time seconds,\n" \
+  "  ! then funit_time_rounds batches of each are timed in turn, keeping the\n" \
+  "  ! best time a run.  The best time is the one least hurt by noise, which\n" \
+  "  ! only ever adds time.\n" \
+  "  integer :: funit_time_rounds = 5\n" \
+  "  type funit_timing\n" \
+  "     integer :: nvariants = 1, variant = 0\n" \
+  "     integer(int64) :: iters(2) = 1, rate = 1, start = 0\n" \
+  "     logical :: calibrated(2) = .false.\n" \
+  "     integer :: rounds(2) = 0\n" \
+  "     real(real64) :: best(2) = huge(1.0_real64)\n" \
+  "  end type funit_timing\n" \
+  "\n" \
+  "contains\n" \
+  "\n" \
+  "  ! Reads the test program's options: --bench, and --bench-csv FILE,\n" \
+  "  ! --bench-json FILE, --bench-samples FILE and --bench-stable PERCENT,\n" \
+  "  ! which imply it, and --bench-governor NAME and --bench-mhz MHZ.\n" \
+  "  subroutine funit_read_options\n" \
+  "    character(:), allocatable :: arg\n" \
+  "    integer :: i, stat\n" \
+  "\n" \
+  "    i = 1\n" \
+  "    do while (i <= command_argument_count())\n" \
+  "       arg = funit_argument(i)\n" \
+  "       select case (arg)\n" \
+  "       case (\"--bench\")\n" \
+  "          funit_bench_mode = .true.\n" \
+  "       case (\"--bench-csv\")\n" \
+  "          i = i + 1\n" \
+  "          funit_bench_csv = funit_argument(i)\n" \
+  "          funit_bench_mode = .true.\n" \
+  "       case (\"--bench-json\")\n" \
+  "          i = i + 1\n" \
+  "          funit_bench_json = funit_argument(i)\n" \
+  "          funit_bench_mode = .true.\n" \
+  "       case (\"--bench-samples\")\n" \
+  "          i = i + 1\n" \
+  "          funit_bench_raw = funit_argument(i)\n" \
+  "          funit_bench_mode = .true.\n" \
+  "       case (\"--bench-stable\")\n" \
+  "          i = i + 1\n" \
+  "          arg = funit_argument(i)\n" \
+  "          read (arg,*,iostat=stat) funit_bench_stable_cv\n" \
+  "          if (stat /= 0) funit_bench_stable_cv = 0\n" \
+  "          funit_bench_mode = .true.\n" \
+  "       case (\"--bench-governor\")\n" \
+  "          i = i + 1\n" \
+  "          funit_bench_governor = funit_argument(i)\n" \
+  "       case (\"--bench-mhz\")\n" \
+  "          i = i + 1\n" \
+  "          arg = funit_argument(i)\n" \
+  "          read (arg,*,iostat=stat) funit_bench_mhz\n" \
+  "          if (stat /= 0) funit_bench_mhz = 0\n" \
+  "       end select\n" \
+  "       i = i + 1\n" \
+  "    end do\n" \
+  "  end subroutine funit_read_options\n" \
+  "\n" \
+  "  function funit_argument(i) result(arg)\n" \
+  "    integer, intent(in) :: i\n" \
+  "    character(:), allocatable :: arg\n" \
+  "    integer :: n\n" \
+  "\n" \
+  "    call get_command_argument(i, length=n)\n" \
+  "    allocate (character(n) :: arg)\n" \
+  "    call get_command_argument(i, arg)\n" \
+  "  end function funit_argument\n" \
+  "\n" \
+  "  ! bytes and flops are the memory traffic and floating point operations of\n" \
+  "  ! one iteration, for reporting throughput.  A bench with a sweep is run\n" \
+  "  ! for each value of sweep_name in turn.  A bench comparing variants of\n" \
+  "  ! its timed code names each with funit_bench_variant.\n" \
+  "  subroutine funit_bench_begin(name, sweep_name, sweep_value, bytes, flops, &\n" \
+  "       variants)\n" \
+  "    character(*), intent(in) :: name\n" \
+  "    character(*), intent(in), optional :: sweep_name\n" \
+  "    integer, intent(in), optional :: sweep_value\n" \
+  "    real(real64), intent(in), optional :: bytes, flops\n" \
+  "    integer, intent(in), optional :: variants\n" \
+  "    integer :: v\n" \
+  "\n" \
+  "    bench_count = bench_count + 1\n" \
+  "    funit_bench%name = name\n" \
+  "    if (allocated(funit_bench%sweep_name)) deallocate (funit_bench%sweep_name)\n" \
+  "    if (present(sweep_name)) then\n" \
+  "       funit_bench%sweep_name = sweep_name\n" \
+  "       funit_bench%sweep_value = sweep_value\n" \
+  "    end if\n" \
+  "    funit_bench%bytes = -1\n" \
+  "    funit_bench%flops = -1\n" \
+  "    if (present(bytes)) funit_bench%bytes = bytes\n" \
+  "    if (present(flops)) funit_bench%flops = flops\n" \
+  "    funit_bench%phase = 0\n" \
+  "    funit_bench%variant = 1\n" \
+  "    if (allocated(funit_bench%variants)) deallocate (funit_bench%variants)\n" \
+  "    v = 1\n" \
+  "    if (present(variants)) v = variants\n" \
+  "    allocate (funit_bench%variants(v))\n" \
+  "    do v = 1, size(funit_bench%variants)\n" \
+  "       allocate (funit_bench%variants(v)%samples(max(funit_bench_samples, 1)))\n" \
+  "    end do\n" \
+  "    call system_clock(count_rate=funit_bench%rate)\n" \
+  "  end subroutine funit_bench_begin\n" \
+  "\n" \
+  "  subroutine funit_bench_variant(v, name)\n" \
+  "    integer, intent(in) :: v\n" \
+  "    character(*), intent(in) :: name\n" \
+  "\n" \
+  "    funit_bench%variants(v)%name = name\n" \
+  "  end subroutine funit_bench_variant\n" \
+  "\n" \
+  "  ! Called before each batch of a bench's timed code and once after the\n" \
+  "  ! last: records the time of the batch just run, then returns whether there\n" \
+  "  ! is another, setting n to its number of iterations and variant to the\n" \
+  "  ! variant it runs.  Variants take turns, batch by batch, so drift in the\n" \
+  "  ! machine's speed affects them alike; while warming up, each doubles its\n" \
+  "  ! batch size on its turns until a batch takes funit_bench_min_time.  A\n" \
+  "  ! timed region that takes no time at all (say the compiler removed it)\n" \
+  "  ! stops doubling once the batch size would overflow.\n" \
+  "  logical function funit_bench_next(n, variant) result(more)\n" \
+  "    integer(int64), intent(out) :: n\n" \
+  "    integer, intent(out), optional :: variant\n" \
+  "    integer(int64) :: now, counts(funit_perf_events)\n" \
+  "    real(real64) :: elapsed\n" \
+  "    integer :: v\n" \
+  "\n" \
+  "    call system_clock(now)\n" \
+  "    if (associated(funit_perf_reader)) call funit_perf_reader(counts)\n" \
+  "    elapsed = real(now - funit_bench%start, real64) / funit_bench%rate\n" \
+  "    v = funit_bench%variant\n" \
+  "    associate (b => funit_bench%variants(v))\n" \
+  "      select case (funit_bench%phase)\n" \
+  "      case (0) ! before the first batch\n" \
+  "         funit_bench%phase = funit_bench_warming\n" \
+  "         funit_bench%warmup_end = now + &\n" \
+  "              int(funit_bench_warmup * funit_bench%rate, int64)\n" \
+  "      case (funit_bench_warming)\n" \
+  "         if (.not. b%calibrated) then\n" \
+  "            if (elapsed < funit_bench_min_time .and. &\n" \
+  "                 b%iters <= ishft(huge(n), -1)) then\n" \
+  "               b%iters = 2 * b%iters\n" \
+  "            else\n" \
+  "               b%calibrated = .true.\n" \
+  "            end if\n" \
+  "         end if\n" \
+  "         if (b%calibrated) then\n" \
+  "            v = mod(v, size(funit_bench%variants)) + 1\n" \
+  "            if (v == 1 .and. all(funit_bench%variants%calibrated) .and. &\n" \
+  "                 now >= funit_bench%warmup_end) &\n" \
+  "                 funit_bench%phase = funit_bench_sampling\n" \
+  "         end if\n" \
+  "      case default\n" \
+  "         b%nsamples = b%nsamples + 1\n" \
+  "         b%samples(b%nsamples) = elapsed / b%iters\n" \
+  "         if (associated(funit_perf_reader)) then\n" \
+  "            b%counts = merge(b%counts + counts - funit_bench%start_counts, &\n" \
+  "                 -1_int64, b%counts >= 0 .and. counts >= 0 .and. &\n" \
+  "                 funit_bench%start_counts >= 0)\n" \
+  "            b%counted_iters = b%counted_iters + b%iters\n" \
+  "         end if\n" \
+  "         v = mod(v, size(funit_bench%variants)) + 1\n" \
+  "      end select\n" \
+  "    end associate\n" \
+  "\n" \
+  "    funit_bench%variant = v\n" \
+  "    more = any(funit_bench%variants%nsamples < &\n" \
+  "         size(funit_bench%variants(1)%samples))\n" \
+  "    if (.not. more .and. funit_bench_stable_cv > 0) more = funit_bench_more()\n" \
+  "    n = funit_bench%variants(v)%iters\n" \
+  "    if (present(variant)) variant = v\n" \
+  "    if (associated(funit_perf_reader)) &\n" \
+  "         call funit_perf_reader(funit_bench%start_counts)\n" \
+  "    call system_clock(funit_bench%start)\n" \
+  "  end function funit_bench_next\n" \
+  "\n" \
+  "  ! With --bench-stable, makes room for another round of samples of each\n" \
+  "  ! variant, and returns true, if any variant's samples vary too much and\n" \
+  "  ! there are rounds left.\n" \
+  "  logical function funit_bench_more() result(more)\n" \
+  "    real(real64), allocatable :: samples(:)\n" \
+  "    integer :: v\n" \
+  "\n" \
+  "    more = size(funit_bench%variants(1)%samples) < &\n" \
+  "         funit_bench_max_rounds * max(funit_bench_samples, 1) .and. &\n" \
+  "         any([(funit_cv(funit_bench%variants(v)%samples) > &\n" \
+  "         funit_bench_stable_cv / 100, v = 1, size(funit_bench%variants))])\n" \
+  "    if (.not. more) return\n" \
+  "    do v = 1, size(funit_bench%variants)\n" \
+  "       associate (b => funit_bench%variants(v))\n" \
+  "         allocate (samples(size(b%samples) + max(funit_bench_samples, 1)))\n" \
+  "         samples(1:size(b%samples)) = b%samples\n" \
+  "         call move_alloc(samples, b%samples)\n" \
+  "       end associate\n" \
+  "    end do\n" \
+  "  end function funit_bench_more\n" \
+  "\n" \
+  "  ! The coefficient of variation of t: its standard deviation over its\n" \
+  "  ! mean.\n" \
+  "  pure real(real64) function funit_cv(t)\n" \
+  "    real(real64), intent(in) :: t(:)\n" \
+  "    real(real64) :: mean\n" \
+  "\n" \
+  "    funit_cv = 0\n" \
+  "    mean = sum(t) / size(t)\n" \
+  "    if (size(t) > 1 .and. mean > 0) &\n" \
+  "         funit_cv = sqrt(sum((t - mean)**2) / (size(t) - 1)) / mean\n" \
+  "  end function funit_cv\n" \
+  "\n" \
+  "  ! Reports the time per iteration over the bench's samples, and the\n" \
+  "  ! throughput at the median time, for each variant; then how each variant\n" \
+  "  ! after the first compares with it.\n" \
+  "  subroutine funit_bench_end\n" \
+  "    integer :: v, width\n" \
+  "\n" \
+  "    if (allocated(funit_bench%sweep_name)) then\n" \
+  "       write (*,'(\"  bench \",A,\" (\",A,\" = \",I0,\")\")') funit_bench%name, &\n" \
+  "            funit_bench%sweep_name, funit_bench%sweep_value\n" \
+  "    else\n" \
+  "       write (*,'(\"  bench \",A)') funit_bench%name\n" \
+  "    end if\n" \
+  "\n" \
+  "    width = 0\n" \
+  "    do v = 1, size(funit_bench%variants)\n" \
+  "       if (allocated(funit_bench%variants(v)%name)) &\n" \
+  "            width = max(width, len(funit_bench%variants(v)%name) + 2)\n" \
+  "    end do\n" \
+  "    do v = 1, size(funit_bench%variants)\n" \
+  "       call funit_bench_report(funit_bench%variants(v), width)\n" \
+  "    end do\n" \
+  "    do v = 2, size(funit_bench%variants)\n" \
+  "       call funit_bench_speedup(funit_bench%variants(1), &\n" \
+  "            funit_bench%variants(v))\n" \
+  "    end do\n" \
+  "  end subroutine funit_bench_end\n" \
+  "\n" \
+  "  ! Reports one variant of the bench just run, its name (if it has one)\n" \
+  "  ! padded to width, and writes it to the results files, as bench/variant.\n" \
+  "  subroutine funit_bench_report(b, width)\n" \
+  "    type(funit_variant_state), intent(in) :: b\n" \
+  "    integer, intent(in) :: width\n" \
+  "    real(real64) :: t(b%nsamples), mean, median, sd\n" \
+  "    real(real64) :: counts(funit_perf_events)\n" \
+  "    character(len=width) :: label\n" \
+  "    character(:), allocatable :: name\n" \
+  "    integer :: n\n" \
+  "\n" \
+  "    n = b%nsamples\n" \
+  "    t = b%samples(1:n)\n" \
+  "    call funit_sort(t)\n" \
+  "    mean = sum(t) / n\n" \
+  "    median = funit_median(t)\n" \
+  "    sd = 0\n" \
+  "    if (n > 1) sd = sqrt(sum((t - mean)**2) / (n - 1))\n" \
+  "\n" \
+  "    label = \"\"\n" \
+  "    name = funit_bench%name\n" \
+  "    if (allocated(b%name)) then\n" \
+  "       label = b%name\n" \
+  "       name = name // \"/\" // b%name\n" \
+  "    end if\n" \
+  "    write (*,'(4X,A,\"min \",A,\"  median \",A,\"  mean \",A,\"  stddev \",A, &\n" \
+  "         & \"  (\",I0,\" x \",I0,\")\")') label, funit_time_string(t(1)), &\n" \
+  "         funit_time_string(median), funit_time_string(mean), &\n" \
+  "         funit_time_string(sd), n, b%iters\n" \
+  "    if (funit_bench_stable_cv > 0 .and. mean > 0) then\n" \
+  "       if (sd / mean > funit_bench_stable_cv / 100) &\n" \
+  "            write (*,'(4X,A,\"not stable: varies by \",A,\"%, not under \",A, &\n" \
+  "            & \"%\")') repeat(\" \", width), funit_rate_string(100 * sd / mean), &\n" \
+  "            funit_rate_string(funit_bench_stable_cv)\n" \
+  "    end if\n" \
+  "\n" \
+  "    ! \"24.000 GB/s  2.000 GFLOP/s  0.083 flop/byte\"\n" \
+  "    if (funit_bench%bytes >= 0 .or. funit_bench%flops >= 0) then\n" \
+  "       write (*,'(2X,A)',advance='no') repeat(\" \", width)\n" \
+  "       if (funit_bench%bytes >= 0) write (*,'(2X,A,\" GB/s\")',advance='no') &\n" \
+  "            funit_rate_string(funit_bench%bytes / median / 1e9_real64)\n" \
+  "       if (funit_bench%flops >= 0) &\n" \
+  "            write (*,'(2X,A,\" GFLOP/s\")',advance='no') &\n" \
+  "            funit_rate_string(funit_bench%flops / median / 1e9_real64)\n" \
+  "       if (funit_bench%bytes > 0 .and. funit_bench%flops >= 0) &\n" \
+  "            write (*,'(2X,A,\" flop/byte\")',advance='no') &\n" \
+  "            funit_rate_string(funit_bench%flops / funit_bench%bytes)\n" \
+  "       write (*,'()')\n" \
+  "    end if\n" \
+  "\n" \
+  "    ! hardware counters per iteration\n" \
+  "    counts = -1\n" \
+  "    if (b%counted_iters > 0) then\n" \
+  "       counts = merge(b%counts / real(b%counted_iters, real64), -1.0_real64, &\n" \
+  "            b%counts >= 0)\n" \
+  "       call funit_perf_report(counts, 2 + width, \"/iter\")\n" \
+  "    end if\n" \
+  "\n" \
+  "    if (allocated(funit_bench_csv)) call funit_bench_row(funit_bench_csv, &\n" \
+  "         .true., name, b%iters, t, median, mean, sd, counts)\n" \
+  "    if (allocated(funit_bench_json)) call funit_bench_row(funit_bench_json, &\n" \
+  "         .false., name, b%iters, t, median, mean, sd, counts)\n" \
+  "    if (allocated(funit_bench_raw)) &\n" \
+  "         call funit_bench_samples_row(name, b%samples(1:n))\n" \
+  "  end subroutine funit_bench_report\n" \
+  "\n" \
+  "  ! Reports how much faster variant b ran than variant a: the geometric\n" \
+  "  ! mean of the ratios of their times in each turn, which cancels drift\n" \
+  "  ! slower than a turn, with a 95% confidence interval by Student's t on the\n" \
+  "  ! logs of the ratios.  The difference is significant if the interval\n" \
+  "  ! leaves out 1.\n" \
+  "  subroutine funit_bench_speedup(a, b)\n" \
+  "    type(funit_variant_state), intent(in) :: a, b\n" \
+  "    real(real64) :: d(min(a%nsamples, b%nsamples)), mean, half\n" \
+  "    character(:), allocatable :: verdict\n" \
+  "    integer :: n\n" \
+  "\n" \
+  "    n = size(d)\n" \
+  "    if (n == 0) return\n" \
+  "    d = log(max(a%samples(1:n), tiny(mean)) / max(b%samples(1:n), tiny(mean)))\n" \
+  "    mean = sum(d) / n\n" \
+  "    if (n < 2) then\n" \
+  "       write (*,'(4X,A,\" is \",A,\" times as fast as \",A)') b%name, &\n" \
+  "            funit_rate_string(exp(mean)), a%name\n" \
+  "       return\n" \
+  "    end if\n" \
+  "    half = funit_t95(n - 1) * sqrt(sum((d - mean)**2) / (n - 1) / n)\n" \
+  "    if (mean - half > 0) then\n" \
+  "       verdict = \"faster\"\n" \
+  "    else if (mean + half < 0) then\n" \
+  "       verdict = \"slower\"\n" \
+  "    else\n" \
+  "       verdict = \"no significant difference\"\n" \
+  "    end if\n" \
+  "    write (*,'(4X,A,\" is \",A,\" times as fast as \",A,\" (95% CI \",A,\" to \", &\n" \
+  "         & A,\"): \",A)') b%name, funit_rate_string(exp(mean)), a%name, &\n" \
+  "         funit_rate_string(exp(mean - half)), &\n" \
+  "         funit_rate_string(exp(mean + half)), verdict\n" \
+  "  end subroutine funit_bench_speedup\n" \
+  "\n" \
+  "  ! The 97.5th percentile of Student's t distribution with df degrees of\n" \
+  "  ! freedom, for two-sided 95% confidence intervals: from a table for small\n" \
+  "  ! df, and by its Cornish-Fisher expansion (good to 1e-3) beyond.\n" \
+  "  pure real(real64) function funit_t95(df)\n" \
+  "    integer, intent(in) :: df\n" \
+  "    real(real64), parameter :: table(10) = [12.706_real64, 4.303_real64, &\n" \
+  "         3.182_real64, 2.776_real64, 2.571_real64, 2.447_real64, &\n" \
+  "         2.365_real64, 2.306_real64, 2.262_real64, 2.228_real64]\n" \
+  "    real(real64), parameter :: z = 1.959964_real64\n" \
+  "\n" \
+  "    if (df <= size(table)) then\n" \
+  "       funit_t95 = table(max(df, 1))\n" \
+  "    else\n" \
+  "       funit_t95 = z + (z**3 + z) / (4 * df) + &\n" \
+  "            (5 * z**5 + 16 * z**3 + 3 * z) / (96 * real(df, real64)**2)\n" \
+  "    end if\n" \
+  "  end function funit_t95\n" \
+  "\n" \
+  "  ! Appends the raw samples of a bench just run to funit_bench_raw:\n" \
+  "  ! \"set\",\"bench\",\"param\",value,t1,t2,... in seconds per iteration.\n" \
+  "  subroutine funit_bench_samples_row(name, samples)\n" \
+  "    character(*), intent(in) :: name\n" \
+  "    real(real64), intent(in) :: samples(:)\n" \
+  "    integer :: u\n" \
+  "\n" \
+  "    open (newunit=u, file=funit_bench_raw, position=\"append\", action=\"write\")\n" \
+  "    write (u,'(A,\",\",A)',advance='no') funit_quote(funit_set_name, .true.), &\n" \
+  "         funit_quote(name, .true.)\n" \
+  "    if (allocated(funit_bench%sweep_name)) then\n" \
+  "       write (u,'(\",\",A,\",\",I0)',advance='no') &\n" \
+  "            funit_quote(funit_bench%sweep_name, .true.), funit_bench%sweep_value\n" \
+  "    else\n" \
+  "       write (u,'(\",,\")',advance='no')\n" \
+  "    end if\n" \
+  "    write (u,'(*(\",\",ES23.16E3))') samples\n" \
+  "    close (u)\n" \
+  "  end subroutine funit_bench_samples_row\n" \
+  "\n" \
+  "  ! Appends the results of a bench just run to file as a CSV row (with a\n" \
+  "  ! header if the file is new) or a JSON object.  Times are in seconds per\n" \
+  "  ! iteration, t sorted, and counts are of the funit_perf_events per\n" \
+  "  ! iteration, -1 if not counted; fields that don't apply are left empty or\n" \
+  "  ! out.\n" \
+  "  subroutine funit_bench_row(file, csv, name, iters, t, median, mean, sd, &\n" \
+  "       counts)\n" \
+  "    character(*), intent(in) :: file, name\n" \
+  "    logical, intent(in) :: csv\n" \
+  "    integer(int64), intent(in) :: iters\n" \
+  "    real(real64), intent(in) :: t(:), median, mean, sd\n" \
+  "    real(real64), intent(in) :: counts(funit_perf_events)\n" \
+  "    character(len=13), parameter :: names(21) = [character(13) :: \"set\", &\n" \
+  "         \"bench\", \"param\", \"value\", \"samples\", \"iterations\", \"min\", \"median\", &\n" \
+  "         \"mean\", \"stddev\", \"bytes\", \"flops\", \"gb_per_s\", \"gflop_per_s\", &\n" \
+  "         \"ipc\", \"cycles\", \"instructions\", \"cache_misses\", \"branch_misses\", &\n" \
+  "         \"governor\", \"cpu_mhz\"]\n" \
+  "    character(len=1024) :: values(size(names))\n" \
+  "    integer :: u, i, file_size\n" \
+  "    logical :: rates\n" \
+  "\n" \
+  "    rates = median > 0\n" \
+  "    values = \"\"\n" \
+  "    values(1) = funit_quote(funit_set_name, csv)\n" \
+  "    values(2) = funit_quote(name, csv)\n" \
+  "    if (allocated(funit_bench%sweep_name)) then\n" \
+  "       values(3) = funit_quote(funit_bench%sweep_name, csv)\n" \
+  "       write (values(4),'(I0)') funit_bench%sweep_value\n" \
+  "    end if\n" \
+  "    write (values(5),'(I0)') size(t)\n" \
+  "    write (values(6),'(I0)') iters\n" \
+  "    values(7) = funit_real_string(t(1))\n" \
+  "    values(8) = funit_real_string(median)\n" \
+  "    values(9) = funit_real_string(mean)\n" \
+  "    values(10) = funit_real_string(sd)\n" \
+  "    if (funit_bench%bytes >= 0) then\n" \
+  "       values(11) = funit_real_string(funit_bench%bytes)\n" \
+  "       if (rates) values(13) = &\n" \
+  "            funit_real_string(funit_bench%bytes / median / 1e9_real64)\n" \
+  "    end if\n" \
+  "    if (funit_bench%flops >= 0) then\n" \
+  "       values(12) = funit_real_string(funit_bench%flops)\n" \
+  "       if (rates) values(14) = &\n" \
+  "            funit_real_string(funit_bench%flops / median / 1e9_real64)\n" \
+  "    end if\n" \
+  "    if (counts(1) > 0 .and. counts(2) >= 0) &\n" \
+  "         values(15) = funit_real_string(counts(2) / counts(1))\n" \
+  "    do i = 1, funit_perf_events\n" \
+  "       if (counts(i) >= 0) values(15 + i) = funit_real_string(counts(i))\n" \
+  "    end do\n" \
+  "    if (allocated(funit_bench_governor)) &\n" \
+  "         values(20) = funit_quote(funit_bench_governor, csv)\n" \
+  "    if (funit_bench_mhz > 0) values(21) = funit_real_string(funit_bench_mhz)\n" \
+  "\n" \
+  "    open (newunit=u, file=file, position=\"append\", action=\"write\")\n" \
+  "    if (csv) then\n" \
+  "       inquire (unit=u, size=file_size)\n" \
+  "       if (file_size <= 0) write (u,'(*(A,:,\",\"))') (trim(names(i)), &\n" \
+  "            i = 1, size(names))\n" \
+  "       write (u,'(*(A,:,\",\"))') (trim(values(i)), i = 1, size(values))\n" \
+  "    else\n" \
+  "       write (u,'(\"{\")',advance='no')\n" \
+  "       do i = 1, size(names)\n" \
+  "          if (values(i) == \"\") cycle\n" \
+  "          if (i > 1) write (u,'(\", \")',advance='no')\n" \
+  "          write (u,'(A,\": \",A)',advance='no') &\n" \
+  "               funit_quote(trim(names(i)), csv), trim(values(i))\n" \
+  "       end do\n" \
+  "       write (u,'(\"}\")')\n" \
+  "    end if\n" \
+  "    close (u)\n" \
+  "  end subroutine funit_bench_row\n" \
+  "\n" \
+  "  ! s as a quoted CSV or JSON string.  A quote is escaped by doubling it in\n" \
+  "  ! CSV, and it and a backslash by a backslash in JSON.\n" \
+  "  function funit_quote(s, csv) result(q)\n" \
+  "    character(*), intent(in) :: s\n" \
+  "    logical, intent(in) :: csv\n" \
+  "    character(:), allocatable :: q\n" \
+  "    character, parameter :: backslash = achar(92)\n" \
+  "    integer :: i\n" \
+  "\n" \
+  "    q = '\"'\n" \
+  "    do i = 1, len(s)\n" \
+  "       if (csv) then\n" \
+  "          if (s(i:i) == '\"') q = q // '\"'\n" \
+  "       else if (s(i:i) == '\"' .or. s(i:i) == backslash) then\n" \
+  "          q = q // backslash\n" \
+  "       end if\n" \
+  "       q = q // s(i:i)\n" \
+  "    end do\n" \
+  "    q = q // '\"'\n" \
+  "  end function funit_quote\n" \
+  "\n" \
+  "  ! \"2.423900E-06\"\n" \
+  "  function funit_real_string(x) result(s)\n" \
+  "    real(real64), intent(in) :: x\n" \
+  "    character(:), allocatable :: s\n" \
+  "    character(len=32) :: buf\n" \
+  "\n" \
+  "    write (buf,'(ES14.6)') x\n" \
+  "    s = trim(adjustl(buf))\n" \
+  "  end function funit_real_string\n" \
+  "\n" \
+  "  subroutine funit_timing_begin(t, nvariants)\n" \
+  "    type(funit_timing), intent(out) :: t\n" \
+  "    integer, intent(in) :: nvariants\n" \
+  "\n" \
+  "    t%nvariants = nvariants\n" \
+  "    call system_clock(count_rate=t%rate)\n" \
+  "  end subroutine funit_timing_begin\n" \
+  "\n" \
+  "  ! Called before each batch of a timing assertion and once after the last,\n" \
+  "  ! like funit_bench_next: records the batch just run, then returns whether\n" \
+  "  ! there is another and sets n to its size and t%variant to what it runs.\n" \
+  "  logical function funit_timing_next(t, n) result(more)\n" \
+  "    type(funit_timing), intent(inout) :: t\n" \
+  "    integer(int64), intent(out) :: n\n" \
+  "    integer(int64) :: now\n" \
+  "    real(real64) :: elapsed\n" \
+  "    integer :: v\n" \
+  "\n" \
+  "    call system_clock(now)\n" \
+  "    v = t%variant\n" \
+  "    if (v == 0) then ! before the first batch\n" \
+  "       t%variant = 1\n" \
+  "    else\n" \
+  "       elapsed = real(now - t%start, real64) / t%rate\n" \
+  "       if (t%calibrated(v)) then\n" \
+  "          t%rounds(v) = t%rounds(v) + 1\n" \
+  "          t%best(v) = min(t%best(v), elapsed / t%iters(v))\n" \
+  "       else if (elapsed < funit_bench_min_time .and. &\n" \
+  "            t%iters(v) <= ishft(huge(n), -1)) then\n" \
+  "          t%iters(v) = 2 * t%iters(v)\n" \
+  "       else\n" \
+  "          t%calibrated(v) = .true.\n" \
+  "       end if\n" \
+  "       ! each variant is calibrated in turn, then they take turns\n" \
+  "       if (t%calibrated(v)) t%variant = mod(v, t%nvariants) + 1\n" \
+  "    end if\n" \
+  "\n" \
+  "    more = any(t%rounds(1:t%nvariants) < max(funit_time_rounds, 1))\n" \
+  "    n = t%iters(t%variant)\n" \
+  "    call system_clock(t%start)\n" \
+  "  end function funit_timing_next\n" \
+  "\n" \
+  "  ! Checks a timing of one statement against a limit in seconds a run.  If\n" \
+  "  ! it is too slow, message becomes \"'name' took TIME a run (best of N), not\n" \
+  "  ! under LIMIT\".\n" \
+  "  logical function funit_time_fails(t, limit, name, passed, message)\n" \
+  "    type(funit_timing), intent(in) :: t\n" \
+  "    real(real64), intent(in) :: limit\n" \
+  "    character(*), intent(in) :: name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "\n" \
+  "    funit_time_fails = .not. (t%best(1) < limit)\n" \
+  "    passed = .not. funit_time_fails\n" \
+  "    if (funit_time_fails) then\n" \
+  "       write (message,'(\" ''\",A,\"'' took \",A,\" a run (best of \",I0, &\n" \
+  "            & \"), not under \",A)') name, trim(adjustl(funit_time_string( &\n" \
+  "            t%best(1)))), t%rounds(1), trim(adjustl(funit_time_string(limit)))\n" \
+  "    end if\n" \
+  "  end function funit_time_fails\n" \
+  "\n" \
+  "  ! Checks a timing of two statements, new and old, for new being at least\n" \
+  "  ! ratio times as fast.  If not, message becomes \"'new' is only X times as\n" \
+  "  ! fast as 'old' (TIME vs. TIME a run, best of N), not RATIO\".\n" \
+  "  logical function funit_slower_fails(t, ratio, new_name, old_name, passed, &\n" \
+  "       message)\n" \
+  "    type(funit_timing), intent(in) :: t\n" \
+  "    real(real64), intent(in) :: ratio\n" \
+  "    character(*), intent(in) :: new_name, old_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "    real(real64) :: speedup\n" \
+  "\n" \
+  "    speedup = t%best(2) / max(t%best(1), tiny(speedup))\n" \
+  "    funit_slower_fails = .not. (speedup >= ratio)\n" \
+  "    passed = .not. funit_slower_fails\n" \
+  "    if (funit_slower_fails) then\n" \
+  "       write (message,'(\" ''\",A,\"'' is only \",A,\" times as fast as ''\",A, &\n" \
+  "            & \"'' (\",A,\" vs. \",A,\" a run, best of \",I0,\"), not \",A)') &\n" \
+  "            new_name, funit_rate_string(speedup), old_name, &\n" \
+  "            trim(adjustl(funit_time_string(t%best(1)))), &\n" \
+  "            trim(adjustl(funit_time_string(t%best(2)))), t%rounds(1), &\n" \
+  "            funit_rate_string(ratio)\n" \
+  "    end if\n" \
+  "  end function funit_slower_fails\n" \
+  "\n" \
+  "  ! Sorts a few values into ascending order.\n" \
+  "  pure subroutine funit_sort(v)\n" \
+  "    real(real64), intent(inout) :: v(:)\n" \
+  "    real(real64) :: x\n" \
+  "    integer :: i, j\n" \
+  "\n" \
+  "    do i = 2, size(v)\n" \
+  "       x = v(i)\n" \
+  "       j = i - 1\n" \
+  "       do while (j >= 1)\n" \
+  "          if (v(j) <= x) exit\n" \
+  "          v(j + 1) = v(j)\n" \
+  "          j = j - 1\n" \
+  "       end do\n" \
+  "       v(j + 1) = x\n" \
+  "    end do\n" \
+  "  end subroutine funit_sort\n" \
+  "\n" \
+  "  ! The median of sorted values.\n" \
+  "  pure real(real64) function funit_median(v)\n" \
+  "    real(real64), intent(in) :: v(:)\n" \
+  "\n" \
+  "    funit_median = (v((size(v) + 1) / 2) + v(size(v) / 2 + 1)) / 2\n" \
+  "  end function funit_median\n" \
+  "\n" \
+  "  ! \"  1.234 us\": seconds in a fixed width, scaled to a readable unit.\n" \
+  "  function funit_time_string(t) result(s)\n" \
+  "    real(real64), intent(in) :: t\n" \
+  "    character(len=10) :: s\n" \
+  "\n" \
+  "    if (t >= 1) then\n" \
+  "       write (s,'(F7.3,1X,A2)') t, \"s \"\n" \
+  "    else if (t >= 1e-3_real64) then\n" \
+  "       write (s,'(F7.3,1X,A2)') t * 1e3_real64, \"ms\"\n" \
+  "    else if (t >= 1e-6_real64) then\n" \
+  "       write (s,'(F7.3,1X,A2)') t * 1e6_real64, \"us\"\n" \
+  "    else\n" \
+  "       write (s,'(F7.3,1X,A2)') t * 1e9_real64, \"ns\"\n" \
+  "    end if\n" \
+  "  end function funit_time_string\n" \
+  "end module funit_benches\n" \
+;
@@ -1,11 +1,69 @@
 const char module_code[] = \
   "module funit\n" \
+  "  use, intrinsic :: iso_fortran_env, only: int8, int16, int32, int64, &\n" \
+  "       real32, real64\n" \
   "  implicit none\n" \
   "  save\n" \
+  "  private :: int8, int16, int32, int64, real32, real64\n" \
   "\n" \
   "  integer :: set_count, pass_count, fail_count\n" \
   "  real :: cpu_start, cpu_finish\n" \
   "\n" \
+  "  ! Arrays at least this big are compared with OpenMP parallel loops, if the\n" \
+  "  ! test is compiled with OpenMP; set by sets with parallel_asserts.\n" \
+  "  integer(int64) :: funit_parallel_min_size = huge(0_int64)\n" \
+  "\n" \
+  "  ! Benchmarks only run when the test program is given --bench, which sets\n" \
+  "  ! funit_bench_mode; module funit_benches runs them.\n" \
+  "  logical :: funit_bench_mode = .false.\n" \
+  "  integer :: bench_count = 0\n" \
+  "\n" \
+  "  ! The name of the set being run.\n" \
+  "  character(:), allocatable :: funit_set_name\n" \
+  "\n" \
+  "  ! Hardware performance counters, when the test program is built by funit\n" \
+  "  ! --perf and the system has them: funit_perf_init, in module funit_perf,\n" \
+  "  ! points funit_perf_reader at a procedure giving the counts so far of the\n" \
+  "  ! funit_perf_events, -1 for any not being counted.  Each test's counts are\n" \
+  "  ! reported after it, and each bench's per iteration of its samples.\n" \
+  "  integer, parameter :: funit_perf_events = 4\n" \
+  "  character(len=13), parameter :: funit_perf_names(funit_perf_events) = &\n" \
+  "       [character(13) :: \"cycles\", \"instructions\", \"cache misses\", &\n" \
+  "       \"branch misses\"]\n" \
+  "  abstract interface\n" \
+  "     subroutine funit_perf_counts(counts)\n" \
+  "       import :: int64\n" \
+  "       integer(int64), intent(out) :: counts(4)\n" \
+  "     end subroutine funit_perf_counts\n" \
+  "  end interface\n" \
+  "  procedure(funit_perf_counts), pointer :: funit_perf_reader => null()\n" \
+  "  integer(int64), private :: funit_test_counts(4) = -1\n" \
+  "  logical, private :: funit_counting_test = .false.\n" \
+  "\n" \
+  "  ! Memory accounting, when the test program is built with funit's memory\n" \
+  "  ! helper: funit_memory_init, in module funit_memory, points\n" \
+  "  ! funit_memory_reader at a procedure giving the peak memory use in bytes\n" \
+  "  ! (first starting a new peak, if asked and funit_peak_resets) and the\n" \
+  "  ! number of allocations and bytes allocated so far, -1 for any it can't.\n" \
+  "  ! With funit --memory, each test's use is reported after it.\n" \
+  "  abstract interface\n" \
+  "     subroutine funit_memory_counts(counts, reset_peak)\n" \
+  "       import :: int64\n" \
+  "       integer(int64), intent(out) :: counts(3)\n" \
+  "       logical, intent(in) :: reset_peak\n" \
+  "     end subroutine funit_memory_counts\n" \
+  "  end interface\n" \
+  "  procedure(funit_memory_counts), pointer :: funit_memory_reader => null()\n" \
+  "  logical :: funit_peak_resets = .false.\n" \
+  "  integer(int64), private :: funit_test_memory(3) = -1\n" \
+  "  logical, private :: funit_measuring_test = .false.\n" \
+  "\n" \
+  "  ! How many representable numbers apart two reals of the same kind are.\n" \
+  "  interface funit_ulp_distance\n" \
+  "     module procedure funit_ulp_distance_real32\n" \
+  "     module procedure funit_ulp_distance_real64\n" \
+  "  end interface funit_ulp_distance\n" \
+  "\n" \
   "contains\n" \
   "  ! others: assert_true, assert_false, assert_equal, assert_not_equal, flunk\n" \
   "\n" \
@@ -21,6 +79,7 @@ const char module_code[] = \
   "    character(*),intent(in) :: set_name\n" \
   "\n" \
   "    set_count = set_count + 1\n" \
+  "    funit_set_name = set_name\n" \
   "\n" \
   "    print *, \"Running \", set_name\n" \
   "  end subroutine start_set\n" \
@@ -31,8 +90,13 @@ const char module_code[] = \
   "    logical,intent(in) :: passed\n" \
   "    character(*),intent(in) :: message, test_name\n" \
   "    integer,intent(in) :: max_name_width\n" \
-  "    character(len=max_name_width) :: wide_name\n" \
+  "    character(len=max(max_name_width, len(test_name))) :: wide_name\n" \
+  "    integer(int64) :: counts(funit_perf_events)\n" \
+  "\n" \
+  "    integer(int64) :: memory(3)\n" \
   "\n" \
+  "    if (funit_counting_test) call funit_perf_reader(counts)\n" \
+  "    if (funit_measuring_test) call funit_memory_reader(memory, .false.)\n" \
   "    wide_name = adjustl(test_name)\n" \
   "    if (passed) then\n" \
   "       pass_count = pass_count + 1\n" \
@@ -44,12 +108,286 @@ const char module_code[] = \
   "            char(27), char(27)\n" \
   "       print *, trim(message)\n" \
   "    end if\n" \
+  "    if (funit_counting_test) then\n" \
+  "       funit_counting_test = .false.\n" \
+  "       call funit_perf_report(funit_count_diff(counts, funit_test_counts), &\n" \
+  "            2, \"\")\n" \
+  "    end if\n" \
+  "    if (funit_measuring_test) then\n" \
+  "       funit_measuring_test = .false.\n" \
+  "       call funit_memory_report(memory, funit_test_memory)\n" \
+  "    end if\n" \
   "  end subroutine pass_fail\n" \
   "\n" \
+  "  ! The name a case of a test over a table is reported by, its test's name\n" \
+  "  ! and its number in the table: \"to_fahrenheit(2)\".\n" \
+  "  function funit_case_name(test_name, i) result(name)\n" \
+  "    character(*), intent(in) :: test_name\n" \
+  "    integer, intent(in) :: i\n" \
+  "    character(:), allocatable :: name\n" \
+  "    character(16) :: number\n" \
+  "\n" \
+  "    write (number, '(I0)') i\n" \
+  "    name = test_name // \"(\" // trim(number) // \")\"\n" \
+  "  end function funit_case_name\n" \
+  "\n" \
+  "  ! The width of the widest of a test's case names, for cases lb to ub.\n" \
+  "  integer function funit_case_width(test_name, lb, ub) result(width)\n" \
+  "    character(*), intent(in) :: test_name\n" \
+  "    integer, intent(in) :: lb, ub\n" \
+  "\n" \
+  "    width = max(len(funit_case_name(test_name, lb)), &\n" \
+  "         len(funit_case_name(test_name, ub)))\n" \
+  "  end function funit_case_width\n" \
+  "\n" \
+  "  ! Starts measuring the memory use of the test about to run, if the test\n" \
+  "  ! program can.\n" \
+  "  subroutine funit_memory_begin\n" \
+  "    if (.not. associated(funit_memory_reader)) return\n" \
+  "    call funit_memory_reader(funit_test_memory, .true.)\n" \
+  "    funit_measuring_test = .true.\n" \
+  "  end subroutine funit_memory_begin\n" \
+  "\n" \
+  "  ! Reports a test's memory use from the counts before and after it:\n" \
+  "  ! \"    peak RSS 1.500 GiB  allocations 12 (3.250 MiB)\".  Without a fresh\n" \
+  "  ! peak for each test, the peak is the program's so far.\n" \
+  "  subroutine funit_memory_report(after, before)\n" \
+  "    integer(int64), intent(in) :: after(3), before(3)\n" \
+  "\n" \
+  "    write (*,'(2X)',advance='no')\n" \
+  "    if (after(1) >= 0) then\n" \
+  "       if (funit_peak_resets) then\n" \
+  "          write (*,'(2X,\"peak RSS \",A)',advance='no') &\n" \
+  "               funit_bytes_string(real(after(1), real64))\n" \
+  "       else\n" \
+  "          write (*,'(2X,\"peak RSS so far \",A)',advance='no') &\n" \
+  "               funit_bytes_string(real(after(1), real64))\n" \
+  "       end if\n" \
+  "    end if\n" \
+  "    if (after(2) >= 0 .and. before(2) >= 0) &\n" \
+  "         write (*,'(2X,\"allocations \",I0,\" (\",A,\")\")',advance='no') &\n" \
+  "         after(2) - before(2), &\n" \
+  "         funit_bytes_string(real(after(3) - before(3), real64))\n" \
+  "    write (*,'()')\n" \
+  "  end subroutine funit_memory_report\n" \
+  "\n" \
+  "  ! assert_max_allocations(stmt, limit) runs stmt between these two, which\n" \
+  "  ! fails unless stmt made at most limit heap allocations.\n" \
+  "  subroutine funit_allocations_begin(counts)\n" \
+  "    integer(int64), intent(out) :: counts(3)\n" \
+  "\n" \
+  "    counts = -1\n" \
+  "    if (associated(funit_memory_reader)) &\n" \
+  "         call funit_memory_reader(counts, .false.)\n" \
+  "  end subroutine funit_allocations_begin\n" \
+  "\n" \
+  "  logical function funit_allocations_fail(before, limit, name, passed, &\n" \
+  "       message) result(failed)\n" \
+  "    integer(int64), intent(in) :: before(3)\n" \
+  "    integer, intent(in) :: limit\n" \
+  "    character(*), intent(in) :: name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(out) :: message\n" \
+  "    integer(int64) :: after(3)\n" \
+  "\n" \
+  "    call funit_allocations_begin(after)\n" \
+  "    if (before(2) < 0 .or. after(2) < 0) then\n" \
+  "       failed = .true.\n" \
+  "       message = \" can't count the allocations of '\" // name // &\n" \
+  "            \"' on this system\"\n" \
+  "    else\n" \
+  "       failed = after(2) - before(2) > limit\n" \
+  "       if (failed) write (message,'(\" ''\",A,\"'' made \",I0, &\n" \
+  "            & \" allocations (\",A,\"), not at most \",I0)') name, &\n" \
+  "            after(2) - before(2), &\n" \
+  "            funit_bytes_string(real(after(3) - before(3), real64)), limit\n" \
+  "    end if\n" \
+  "    passed = .not. failed\n" \
+  "  end function funit_allocations_fail\n" \
+  "\n" \
+  "  ! Starts counting for the test about to run, if there are counters.\n" \
+  "  subroutine funit_perf_begin\n" \
+  "    if (.not. associated(funit_perf_reader)) return\n" \
+  "    call funit_perf_reader(funit_test_counts)\n" \
+  "    funit_counting_test = .true.\n" \
+  "  end subroutine funit_perf_begin\n" \
+  "\n" \
+  "  ! The counts between start and now, as reals, -1 where either is missing.\n" \
+  "  pure function funit_count_diff(now, start) result(d)\n" \
+  "    integer(int64), intent(in) :: now(:), start(:)\n" \
+  "    real(real64) :: d(size(now))\n" \
+  "\n" \
+  "    d = merge(real(now - start, real64), -1.0_real64, &\n" \
+  "         now >= 0 .and. start >= 0)\n" \
+  "  end function funit_count_diff\n" \
+  "\n" \
+  "  ! Reports counts of the funit_perf_events (each followed by per), and the\n" \
+  "  ! instructions per cycle, on a line indented by indent, leaving out any\n" \
+  "  ! not counted: \"  IPC 2.310  cycles 1.234k  instructions 2.851k ...\".\n" \
+  "  subroutine funit_perf_report(counts, indent, per)\n" \
+  "    real(real64), intent(in) :: counts(funit_perf_events)\n" \
+  "    integer, intent(in) :: indent\n" \
+  "    character(*), intent(in) :: per\n" \
+  "    integer :: i\n" \
+  "\n" \
+  "    if (all(counts < 0)) return\n" \
+  "    write (*,'(A)',advance='no') repeat(\" \", indent)\n" \
+  "    if (counts(1) > 0 .and. counts(2) >= 0) write (*,'(2X,\"IPC \",A)', &\n" \
+  "         advance='no') funit_rate_string(counts(2) / counts(1))\n" \
+  "    do i = 1, funit_perf_events\n" \
+  "       if (counts(i) >= 0) write (*,'(2X,A,1X,A,A)',advance='no') &\n" \
+  "            trim(funit_perf_names(i)), funit_count_string(counts(i)), per\n" \
+  "    end do\n" \
+  "    write (*,'()')\n" \
+  "  end subroutine funit_perf_report\n" \
+  "\n" \
+  "  ! The value of a scalar of any intrinsic type, for messages.\n" \
+  "  function funit_value_string(v) result(s)\n" \
+  "    class(*), intent(in) :: v\n" \
+  "    character(:), allocatable :: s\n" \
+  "    character(64) :: buf\n" \
+  "\n" \
+  "    select type (v)\n" \
+  "    type is (integer(int8))\n" \
+  "       write (buf,*) v\n" \
+  "    type is (integer(int16))\n" \
+  "       write (buf,*) v\n" \
+  "    type is (integer(int32))\n" \
+  "       write (buf,*) v\n" \
+  "    type is (integer(int64))\n" \
+  "       write (buf,*) v\n" \
+  "    type is (real(real32))\n" \
+  "       write (buf,*) v\n" \
+  "    type is (real(real64))\n" \
+  "       write (buf,*) v\n" \
+  "    type is (complex(real32))\n" \
+  "       write (buf,*) v\n" \
+  "    type is (complex(real64))\n" \
+  "       write (buf,*) v\n" \
+  "    type is (logical)\n" \
+  "       write (buf,*) v\n" \
+  "    type is (character(*))\n" \
+  "       s = v\n" \
+  "       return\n" \
+  "    class default\n" \
+  "       buf = \"?\"\n" \
+  "    end select\n" \
+  "    s = trim(adjustl(buf))\n" \
+  "  end function funit_value_string\n" \
+  "\n" \
+  "  ! Checks the result of a scalar comparison done in the test code, where\n" \
+  "  ! the operands may be of any (mixed) type.  If failed is true, message\n" \
+  "  ! becomes \"'a' (value of a) WHAT 'b'\".\n" \
+  "  logical function funit_fails(failed, a, a_name, what, b_name, passed, &\n" \
+  "       message)\n" \
+  "    logical, intent(in) :: failed\n" \
+  "    class(*), intent(in) :: a\n" \
+  "    character(*), intent(in) :: a_name, what, b_name\n" \
+  "    logical, intent(out) :: passed\n" \
+  "    character(*), intent(inout) :: message\n" \
+  "\n" \
+  "    funit_fails = failed\n" \
+  "    passed = .not. failed\n" \
+  "    if (failed) then\n" \
+  "       message = \" '\" // a_name // \"' (\" // funit_value_string(a) // \") \" // &\n" \
+  "            what // \" '\" // b_name // \"'\"\n" \
+  "    end if\n" \
+  "  end function funit_fails\n" \
+  "\n" \
+  "  ! Bitwise comparison of two scalars of any type, as transfer(x, [\"x\"]).\n" \
+  "  logical function funit_bytes_differ(a, b)\n" \
+  "    character, intent(in) :: a(:), b(:)\n" \
+  "\n" \
+  "    funit_bytes_differ = size(a) /= size(b)\n" \
+  "    if (.not. funit_bytes_differ) funit_bytes_differ = any(a /= b)\n" \
+  "  end function funit_bytes_differ\n" \
+  "\n" \
+  "  ! The bit patterns of two reals of the same sign are as far apart as the\n" \
+  "  ! reals are in representable numbers; across zero, the distance is the sum\n" \
+  "  ! of each one's distance from it.  +0 and -0 are 0 apart, and a NaN is\n" \
+  "  ! huge() from everything.  Written with merge() rather than branches so\n" \
+  "  ! that whole-array uses vectorize.\n" \
+  "  elemental integer(int64) function funit_ulp_distance_real32(x, y) result(d)\n" \
+  "    real(real32), intent(in) :: x, y\n" \
+  "    integer(int64), parameter :: mag = huge(0_int32)\n" \
+  "    integer(int64) :: ix, iy\n" \
+  "\n" \
+  "    ix = transfer(x, 0_int32)\n" \
+  "    iy = transfer(y, 0_int32)\n" \
+  "    d = merge(abs(ix - iy), iand(ix, mag) + iand(iy, mag), &\n" \
+  "         (ix < 0) .eqv. (iy < 0))\n" \
+  "    d = merge(huge(d), d, x /= x .or. y /= y)\n" \
+  "  end function funit_ulp_distance_real32\n" \
+  "\n" \
+  "  elemental integer(int64) function funit_ulp_distance_real64(x, y) result(d)\n" \
+  "    real(real64), intent(in) :: x, y\n" \
+  "    integer(int64) :: ix, iy\n" \
+  "\n" \
+  "    ix = transfer(x, 0_int64)\n" \
+  "    iy = transfer(y, 0_int64)\n" \
+  "    ! the sum of the magnitudes can overflow, so it saturates at huge()\n" \
+  "    d = merge(abs(ix - iy), &\n" \
+  "         min(iand(ix, huge(ix)), huge(d) - iand(iy, huge(iy))) + &\n" \
+  "         iand(iy, huge(iy)), (ix < 0) .eqv. (iy < 0))\n" \
+  "    d = merge(huge(d), d, x /= x .or. y /= y)\n" \
+  "  end function funit_ulp_distance_real64\n" \
+  "\n" \
+  "  ! A count in thousands, millions or billions if it is that big, e.g.\n" \
+  "  ! \"0.500\", \"12.250\" or \"1.234M\".\n" \
+  "  function funit_count_string(x) result(s)\n" \
+  "    real(real64), intent(in) :: x\n" \
+  "    character(:), allocatable :: s\n" \
+  "    character, parameter :: prefixes(3) = [\"k\", \"M\", \"G\"]\n" \
+  "    integer :: p\n" \
+  "\n" \
+  "    p = 0\n" \
+  "    do while (p < size(prefixes) .and. x >= 1000.0_real64**(p + 1))\n" \
+  "       p = p + 1\n" \
+  "    end do\n" \
+  "    if (p == 0) then\n" \
+  "       s = funit_rate_string(x)\n" \
+  "    else\n" \
+  "       s = funit_rate_string(x / 1000.0_real64**p) // prefixes(p)\n" \
+  "    end if\n" \
+  "  end function funit_count_string\n" \
+  "\n" \
+  "  ! A number of bytes in binary units, e.g. \"512 B\" or \"1.500 GiB\".\n" \
+  "  function funit_bytes_string(x) result(s)\n" \
+  "    real(real64), intent(in) :: x\n" \
+  "    character(:), allocatable :: s\n" \
+  "    character(len=3), parameter :: units(4) = [\"KiB\", \"MiB\", \"GiB\", \"TiB\"]\n" \
+  "    character(len=24) :: buf\n" \
+  "    integer :: p\n" \
+  "\n" \
+  "    p = 0\n" \
+  "    do while (p < size(units) .and. x >= 1024.0_real64**(p + 1))\n" \
+  "       p = p + 1\n" \
+  "    end do\n" \
+  "    if (p == 0) then\n" \
+  "       write (buf,'(I0,\" B\")') nint(x, int64)\n" \
+  "       s = trim(buf)\n" \
+  "    else\n" \
+  "       s = funit_rate_string(x / 1024.0_real64**p) // \" \" // units(p)\n" \
+  "    end if\n" \
+  "  end function funit_bytes_string\n" \
+  "\n" \
+  "  ! A rate without needless padding, e.g. \"0.083\" or \"1234.500\".  An\n" \
+  "  ! iteration too fast to time gives \"Infinity\".\n" \
+  "  function funit_rate_string(r) result(s)\n" \
+  "    real(real64), intent(in) :: r\n" \
+  "    character(:), allocatable :: s\n" \
+  "    character(len=32) :: buf\n" \
+  "\n" \
+  "    write (buf,'(F0.3)') r\n" \
+  "    s = trim(buf)\n" \
+  "    if (s(1:1) == \".\") s = \"0\" // s\n" \
+  "  end function funit_rate_string\n" \
+  "\n" \
   "  subroutine clear_stats\n" \
   "    set_count = 0\n" \
   "    pass_count = 0\n" \
   "    fail_count = 0\n" \
+  "    bench_count = 0\n" \
   "    call cpu_time(cpu_start);\n" \
   "  end subroutine clear_stats\n" \
   "\n" \
@@ -63,6 +401,12 @@ const char module_code[] = \
   "    call cpu_time(cpu_finish)\n" \
   "    print '(\"Finished in \",F4.2,\" seconds\")', cpu_finish - cpu_start\n" \
   "\n" \
+  "    ! \"2 benches in 1 sets\"\n" \
+  "    if (funit_bench_mode) then\n" \
+  "       write (*,'(I0,\" benches in \",I0,\" sets\")') bench_count, set_count\n" \
+  "       return\n" \
+  "    end if\n" \
+  "\n" \
   "    ! \"3 tests in 1 set, 1 failure\"\n" \
   "    write (test_count_s,*) (pass_count + fail_count)\n" \
   "    write (set_count_s,*) set_count\n" \
@@ -80,5 +424,4 @@ const char module_code[] = \
   "    write (*,'(A,\"[39m\")') char(27)\n" \
   "  end subroutine report_stats\n" \
   "end module funit\n" \
-  "\n" \
 ;
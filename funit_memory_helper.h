@@ -0,0 +1,107 @@
+const char memory_helper_code[] = \
+  "/* memory_helper.c - memory accounting for test programs.\n" \
+  " *\n" \
+  " * funit builds this into test programs that report their tests' memory use\n" \
+  " * (funit --memory) or check it (assert_max_allocations), whose funit_memory\n" \
+  " * module calls it through bind(C).  With glibc it counts the program's heap\n" \
+  " * allocations, Fortran allocate and compiler temporaries included, by\n" \
+  " * defining malloc, calloc and realloc in the program itself, in front of the\n" \
+  " * C library's.  The peak memory use comes from the kernel.  Nothing here\n" \
+  " * allocates, so reading the counts doesn't change them.\n" \
+  " */\n" \
+  "#define _GNU_SOURCE\n" \
+  "#include <sys/resource.h>\n" \
+  "#include <sys/time.h>\n" \
+  "\n" \
+  "#include <fcntl.h>\n" \
+  "#include <stdint.h>\n" \
+  "#include <stdlib.h>\n" \
+  "#include <string.h>\n" \
+  "#include <unistd.h>\n" \
+  "\n" \
+  "static int64_t mem_allocs, mem_bytes;\n" \
+  "\n" \
+  "#ifdef __GLIBC__\n" \
+  "extern void *__libc_malloc(size_t size);\n" \
+  "extern void *__libc_calloc(size_t n, size_t size);\n" \
+  "extern void *__libc_realloc(void *p, size_t size);\n" \
+  "\n" \
+  "static void count_allocation(size_t size)\n" \
+  "{\n" \
+  "    __atomic_add_fetch(&mem_allocs, 1, __ATOMIC_RELAXED);\n" \
+  "    __atomic_add_fetch(&mem_bytes, (int64_t)size, __ATOMIC_RELAXED);\n" \
+  "}\n" \
+  "\n" \
+  "void *malloc(size_t size)\n" \
+  "{\n" \
+  "    count_allocation(size);\n" \
+  "    return __libc_malloc(size);\n" \
+  "}\n" \
+  "\n" \
+  "void *calloc(size_t n, size_t size)\n" \
+  "{\n" \
+  "    count_allocation(n * size);\n" \
+  "    return __libc_calloc(n, size);\n" \
+  "}\n" \
+  "\n" \
+  "void *realloc(void *p, size_t size)\n" \
+  "{\n" \
+  "    count_allocation(size);\n" \
+  "    return __libc_realloc(p, size);\n" \
+  "}\n" \
+  "#endif\n" \
+  "\n" \
+  "/* Starts a new peak of memory use at the current use.  Returns -1 if the\n" \
+  " * system can't.\n" \
+  " */\n" \
+  "int funit_mem_reset_peak(void)\n" \
+  "{\n" \
+  "    int fd = open(\"/proc/self/clear_refs\", O_WRONLY);\n" \
+  "    int ok;\n" \
+  "\n" \
+  "    if (fd < 0)\n" \
+  "        return -1;\n" \
+  "    ok = write(fd, \"5\", 1) == 1;\n" \
+  "    close(fd);\n" \
+  "    return ok ? 0 : -1;\n" \
+  "}\n" \
+  "\n" \
+  "// the peak resident set size in bytes, or -1 if unknown\n" \
+  "static int64_t peak_rss(void)\n" \
+  "{\n" \
+  "    char buf[4096];\n" \
+  "    int fd = open(\"/proc/self/status\", O_RDONLY);\n" \
+  "    struct rusage ru;\n" \
+  "\n" \
+  "    if (fd >= 0) {\n" \
+  "        ssize_t n = read(fd, buf, sizeof(buf) - 1);\n" \
+  "        close(fd);\n" \
+  "        if (n > 0) {\n" \
+  "            buf[n] = '\\0';\n" \
+  "            char *hwm = strstr(buf, \"VmHWM:\");\n" \
+  "            if (hwm)\n" \
+  "                return strtoll(hwm + 6, NULL, 10) * 1024; // in kB\n" \
+  "        }\n" \
+  "    }\n" \
+  "    if (getrusage(RUSAGE_SELF, &ru) == 0) // can't be reset\n" \
+  "        return (int64_t)ru.ru_maxrss * 1024;\n" \
+  "    return -1;\n" \
+  "}\n" \
+  "\n" \
+  "/* Puts the peak memory use in bytes, first starting a new peak if\n" \
+  " * reset_peak, and the number of allocations and bytes allocated so far in\n" \
+  " * counts; -1 for what can't be had.\n" \
+  " */\n" \
+  "void funit_mem_counts(int64_t *counts, int reset_peak)\n" \
+  "{\n" \
+  "    if (reset_peak)\n" \
+  "        funit_mem_reset_peak();\n" \
+  "    counts[0] = peak_rss();\n" \
+  "#ifdef __GLIBC__\n" \
+  "    counts[1] = __atomic_load_n(&mem_allocs, __ATOMIC_RELAXED);\n" \
+  "    counts[2] = __atomic_load_n(&mem_bytes, __ATOMIC_RELAXED);\n" \
+  "#else\n" \
+  "    counts[1] = counts[2] = -1;\n" \
+  "#endif\n" \
+  "}\n" \
+;
@@ -0,0 +1,39 @@
+const char memory_module_code[] = \
+  "! The test program's side of funit's memory accounting: has the funit\n" \
+  "! module read the peak memory use and allocation counts of\n" \
+  "! memory_helper.c, which funit builds into the program.\n" \
+  "module funit_memory\n" \
+  "  use, intrinsic :: iso_c_binding, only: c_int, c_int64_t\n" \
+  "  use funit\n" \
+  "  implicit none\n" \
+  "  private\n" \
+  "  public :: funit_memory_init\n" \
+  "\n" \
+  "  interface\n" \
+  "     integer(c_int) function funit_mem_reset_peak() bind(C)\n" \
+  "       import :: c_int\n" \
+  "     end function funit_mem_reset_peak\n" \
+  "\n" \
+  "     subroutine funit_mem_counts(counts, reset_peak) bind(C)\n" \
+  "       import :: c_int, c_int64_t\n" \
+  "       integer(c_int64_t), intent(out) :: counts(*)\n" \
+  "       integer(c_int), value :: reset_peak\n" \
+  "     end subroutine funit_mem_counts\n" \
+  "  end interface\n" \
+  "\n" \
+  "contains\n" \
+  "\n" \
+  "  subroutine funit_memory_init\n" \
+  "    funit_memory_reader => funit_memory_counts_so_far\n" \
+  "    funit_peak_resets = funit_mem_reset_peak() == 0\n" \
+  "  end subroutine funit_memory_init\n" \
+  "\n" \
+  "  subroutine funit_memory_counts_so_far(counts, reset_peak)\n" \
+  "    integer(c_int64_t), intent(out) :: counts(3)\n" \
+  "    logical, intent(in) :: reset_peak\n" \
+  "\n" \
+  "    call funit_mem_counts(counts, merge(1_c_int, 0_c_int, reset_peak))\n" \
+  "  end subroutine funit_memory_counts_so_far\n" \
+  "\n" \
+  "end module funit_memory\n" \
+;
@@ -0,0 +1,93 @@
+const char perf_helper_code[] = \
+  "/* perf_helper.c - hardware performance counters for test programs.\n" \
+  " *\n" \
+  " * funit --perf builds this into each test program, whose funit_perf module\n" \
+  " * calls it through bind(C).  It counts the program's cycles, instructions,\n" \
+  " * cache misses and branch misses in user space with perf_event_open(2),\n" \
+  " * including threads started later, like OpenMP's.  It uses only the C\n" \
+  " * library, so it builds with any C compiler the Fortran compiler can drive.\n" \
+  " */\n" \
+  "#define _GNU_SOURCE\n" \
+  "#include <errno.h>\n" \
+  "#include <stdint.h>\n" \
+  "#include <stdio.h>\n" \
+  "#include <string.h>\n" \
+  "#include <unistd.h>\n" \
+  "\n" \
+  "#ifdef __linux__\n" \
+  "#include <linux/perf_event.h>\n" \
+  "#include <sys/syscall.h>\n" \
+  "#endif\n" \
+  "\n" \
+  "// in the order the funit module reports them\n" \
+  "#define FUNIT_PERF_EVENTS 4\n" \
+  "\n" \
+  "static int perf_fds[FUNIT_PERF_EVENTS] = {-1, -1, -1, -1};\n" \
+  "\n" \
+  "/* Starts the counters.  Returns how many could be opened; if none, note\n" \
+  " * (note_size chars) says why.\n" \
+  " */\n" \
+  "int funit_perf_open(char *note, int note_size)\n" \
+  "{\n" \
+  "#ifdef __linux__\n" \
+  "    static const uint64_t events[FUNIT_PERF_EVENTS] = {\n" \
+  "        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,\n" \
+  "        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES\n" \
+  "    };\n" \
+  "    int n_open = 0, first_errno = 0;\n" \
+  "\n" \
+  "    for (int i = 0; i < FUNIT_PERF_EVENTS; i++) {\n" \
+  "        struct perf_event_attr attr;\n" \
+  "\n" \
+  "        memset(&attr, 0, sizeof(attr));\n" \
+  "        attr.size = sizeof(attr);\n" \
+  "        attr.type = PERF_TYPE_HARDWARE;\n" \
+  "        attr.config = events[i];\n" \
+  "        attr.inherit = 1;\n" \
+  "        attr.exclude_kernel = 1;\n" \
+  "        attr.exclude_hv = 1;\n" \
+  "        // to scale the counts up when the counters are shared out\n" \
+  "        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |\n" \
+  "                           PERF_FORMAT_TOTAL_TIME_RUNNING;\n" \
+  "        perf_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);\n" \
+  "        if (perf_fds[i] >= 0)\n" \
+  "            n_open++;\n" \
+  "        else if (!first_errno)\n" \
+  "            first_errno = errno;\n" \
+  "    }\n" \
+  "\n" \
+  "    if (n_open == 0) {\n" \
+  "        const char *hint = \"\";\n" \
+  "        if (first_errno == EACCES || first_errno == EPERM)\n" \
+  "            hint = \" (see /proc/sys/kernel/perf_event_paranoid)\";\n" \
+  "        else if (first_errno == ENOENT || first_errno == EOPNOTSUPP)\n" \
+  "            hint = \" (no hardware events, as in many virtual machines)\";\n" \
+  "        snprintf(note, note_size, \"perf_event_open: %s%s\",\n" \
+  "                 strerror(first_errno), hint);\n" \
+  "    }\n" \
+  "    return n_open;\n" \
+  "#else\n" \
+  "    snprintf(note, note_size, \"not supported on this system\");\n" \
+  "    return 0;\n" \
+  "#endif\n" \
+  "}\n" \
+  "\n" \
+  "/* Puts each counter's count so far in counts, or -1 for one that isn't\n" \
+  " * counting.\n" \
+  " */\n" \
+  "void funit_perf_read(int64_t *counts)\n" \
+  "{\n" \
+  "    for (int i = 0; i < FUNIT_PERF_EVENTS; i++) {\n" \
+  "        uint64_t v[3]; // value, time enabled, time running\n" \
+  "\n" \
+  "        counts[i] = -1;\n" \
+  "        if (perf_fds[i] < 0 || read(perf_fds[i], v, sizeof(v)) != sizeof(v)\n" \
+  "            || v[2] == 0)\n" \
+  "            continue;\n" \
+  "        if (v[2] < v[1]) // only counted part of the time\n" \
+  "            counts[i] = (int64_t)((double)v[0] * v[1] / v[2]);\n" \
+  "        else\n" \
+  "            counts[i] = (int64_t)v[0];\n" \
+  "    }\n" \
+  "}\n" \
+;
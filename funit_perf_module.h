@@ -0,0 +1,48 @@
+const char perf_module_code[] = \
+  "! The test program's side of funit --perf: starts the hardware performance\n" \
+  "! counters of perf_helper.c, which funit builds into the program, and lets\n" \
+  "! the funit module read them.\n" \
+  "module funit_perf\n" \
+  "  use, intrinsic :: iso_c_binding, only: c_char, c_int, c_int64_t, &\n" \
+  "       c_null_char\n" \
+  "  use funit\n" \
+  "  implicit none\n" \
+  "  private\n" \
+  "  public :: funit_perf_init\n" \
+  "\n" \
+  "  interface\n" \
+  "     integer(c_int) function funit_perf_open(note, note_size) bind(C)\n" \
+  "       import :: c_char, c_int\n" \
+  "       character(kind=c_char), intent(out) :: note(*)\n" \
+  "       integer(c_int), value :: note_size\n" \
+  "     end function funit_perf_open\n" \
+  "\n" \
+  "     subroutine funit_perf_read(counts) bind(C)\n" \
+  "       import :: c_int64_t\n" \
+  "       integer(c_int64_t), intent(out) :: counts(*)\n" \
+  "     end subroutine funit_perf_read\n" \
+  "  end interface\n" \
+  "\n" \
+  "contains\n" \
+  "\n" \
+  "  ! Starts the counters, or says why there are none.\n" \
+  "  subroutine funit_perf_init\n" \
+  "    character(kind=c_char, len=256) :: note\n" \
+  "\n" \
+  "    note = c_null_char\n" \
+  "    if (funit_perf_open(note, len(note)) > 0) then\n" \
+  "       funit_perf_reader => funit_perf_counts_so_far\n" \
+  "    else\n" \
+  "       print *, \"Hardware counters unavailable: \", &\n" \
+  "            note(1:index(note, c_null_char) - 1)\n" \
+  "    end if\n" \
+  "  end subroutine funit_perf_init\n" \
+  "\n" \
+  "  subroutine funit_perf_counts_so_far(counts)\n" \
+  "    integer(c_int64_t), intent(out) :: counts(4)\n" \
+  "\n" \
+  "    call funit_perf_read(counts)\n" \
+  "  end subroutine funit_perf_counts_so_far\n" \
+  "\n" \
+  "end module funit_perf\n" \
+;
@@ -1,16 +1,36 @@
 /* generate_code.c - generate test code from .fun template
  */
 #include "funit.h"
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
 
-// for module_code string variable
+// for module_code, arrays_module_code, benches_module_code,
+// perf_module_code and memory_module_code string variables
 #include "funit_fortran_module.h"
+#include "funit_arrays_module.h"
+#include "funit_benches_module.h"
+#include "funit_memory_module.h"
+#include "funit_perf_module.h"
 
-// XXX no more globals!
-static FILE *fout;
-const char *test_set_file_name;
-
-static int check_assert_args2(const char *macro_name, struct Code *macro,
-                              struct Code *args, int min_args, int max_args)
+/* Code generator state for one test file.  Nothing is shared between
+ * generators, so several files can be generated concurrently.
+ */
+struct CodeGen {
+    struct Emitter *out;    // generated Fortran goes here
+    FILE *err;              // diagnostics go here
+    const char *file_name;  // the template file being generated from
+    const struct TestSet *set;  // the set being generated
+    int perf;               // read hardware counters around each test
+    int memory;             // measure each test's memory use
+    const char *fail_exit;  // how a failed assertion leaves its test
+    int arrays;             // needs module funit_arrays
+    int benches;            // needs module funit_benches
+};
+
+static int check_assert_args2(struct CodeGen *g, const char *macro_name,
+                              struct Code *macro, struct Code *args,
+                              int min_args, int max_args)
 {
     long lineno;
     int n;
@@ -18,8 +38,8 @@ static int check_assert_args2(const char *macro_name, struct Code *macro,
     assert(min_args > 0 && min_args <= max_args);
 
     if (!args) {
-        fprintf(stderr, "near %s:%li: no arguments to %s()\n",
-                test_set_file_name, macro->lineno, macro_name);
+        fprintf(g->err, "near %s:%li: no arguments to %s()\n",
+                g->file_name, macro->lineno, macro_name);
         return -1;
     }
     n = 0;
@@ -35,25 +55,27 @@ static int check_assert_args2(const char *macro_name, struct Code *macro,
     return n;
  badargs:
     if (min_args == max_args) {
-        fprintf(stderr, "near %s:%li: expected %i argument%s to %s()\n",
-                test_set_file_name, lineno, max_args,
+        fprintf(g->err, "near %s:%li: expected %i argument%s to %s()\n",
+                g->file_name, lineno, max_args,
                 (max_args > 1) ? "s" : "", macro_name);
     } else {
         assert(min_args + 1 == max_args);
-        fprintf(stderr, "near %s:%li: expected %i or %i arguments to %s()\n",
-                test_set_file_name, lineno, min_args, max_args, macro_name);
+        fprintf(g->err, "near %s:%li: expected %i or %i arguments to %s()\n",
+                g->file_name, lineno, min_args, max_args, macro_name);
     }
     return -1;
 }
 
-static int check_assert_args(const char *macro_name, struct Code *macro,
-                              struct Code *args, int n_expected)
+static int check_assert_args(struct CodeGen *g, const char *macro_name,
+                             struct Code *macro, struct Code *args,
+                             int n_expected)
 {
-    return check_assert_args2(macro_name, macro, args, n_expected, n_expected);
+    return check_assert_args2(g, macro_name, macro, args,
+                              n_expected, n_expected);
 }
 
 // plain printing
-#define PRINT_CODE(arg) fwrite((arg)->u.c.str, (arg)->u.c.len, 1, fout)
+#define PRINT_CODE(arg) emit_span(g->out, (arg)->u.c.str, (arg)->u.c.len)
 
 static char *find_line_continuation(char *s, char *end, int in_string)
 {
@@ -94,10 +116,57 @@ static char *find_line_continuation(char *s, char *end, int in_string)
     }
 }
 
-/* Prints the macro argument between s and end to the fout stream, handling
- * newlines by inserting a leading '&' if one is not already present.
+/* Prints x as a double precision Fortran literal, with the fewest digits
+ * that read back as exactly x.
+ */
+static void print_real64(struct CodeGen *g, double x)
+{
+    char buf[32], *e;
+    int prec;
+
+    for (prec = 1; prec < 17; prec++) {
+        snprintf(buf, sizeof(buf), "%.*e", prec - 1, x);
+        if (strtod(buf, NULL) == x)
+            break;
+    }
+    snprintf(buf, sizeof(buf), "%.*g", prec, x);
+    e = strchr(buf, 'e');
+    if (e) {
+        // 1e-08 -> 1d-8, 1e+02 -> 1d2
+        char *digits = e + 1, *d;
+        if (*digits == '-')
+            digits++;
+        for (d = digits; *d == '+' || (*d == '0' && d[1]); d++)
+            ;
+        memmove(digits, d, strlen(d) + 1);
+        *e = 'd';
+        emit_printf(g->out, "%s", buf);
+    } else {
+        emit_printf(g->out, "%sd0", buf);
+    }
+}
+
+/* Prints len bytes at s for use inside a double-quoted Fortran string,
+ * doubling any double quotes.
  */
-static void print_macro_arg(struct Code *arg)
+static void print_in_string(struct CodeGen *g, const char *s, size_t len)
+{
+    const char *quote;
+
+    while ((quote = memchr(s, '"', len)) != NULL) {
+        emit_span(g->out, s, quote + 1 - s);
+        emit_str(g->out, "\"");
+        len -= quote + 1 - s;
+        s = quote + 1;
+    }
+    emit_span(g->out, s, len);
+}
+
+/* Prints the macro argument between s and end to the output, for use inside
+ * a double-quoted string, handling newlines by inserting a leading '&' if
+ * one is not already present.
+ */
+static void print_macro_arg(struct CodeGen *g, struct Code *arg)
 {
     char *s, *start, *end, *amp, string_delim;
     int in_string = 0;
@@ -136,7 +205,7 @@ static void print_macro_arg(struct Code *arg)
             // line continuation
             assert(amp != NULL);
             // print prior arg-part
-            fwrite(start, amp - start, 1, fout);
+            print_in_string(g, start, amp - start);
             // scan for next arg-part
             start = find_line_continuation(s, end, in_string);
             s = start - 1;
@@ -148,7 +217,102 @@ static void print_macro_arg(struct Code *arg)
         s++;
     }
     // print remaining
-    fwrite(start, end - start, 1, fout);
+    print_in_string(g, start, end - start);
+}
+
+/* Parses a tolerance written as a real literal, such as 0.01, 1e-6, 1.5d-3 or
+ * 1e-6_dp, into *tol.  Returns -1 if arg is anything else.
+ */
+static int parse_tolerance(struct Code *arg, double *tol)
+{
+    char buf[64], *s = arg->u.c.str, *end = s + arg->u.c.len, *p;
+    size_t n = 0;
+
+    while (end > s && isspace((unsigned char)end[-1]))
+        end--;
+    // the kind doesn't matter: the literal is read at full precision
+    for (p = s; p < end && *p != '_'; p++) {
+        if (n == sizeof(buf) - 1 || !strchr("0123456789.+-eEdD", *p))
+            return -1;
+        buf[n++] = (*p == 'd' || *p == 'D') ? 'e' : *p;
+    }
+    buf[n] = '\0';
+    if (n == 0)
+        return -1;
+    *tol = strtod(buf, &p);
+    return (*p == '\0') ? 0 : -1;
+}
+
+/* Parses the tolerance argument of a macro, which must be a literal
+ * >= 0, reporting an error if it is not.
+ */
+static int check_tolerance(struct CodeGen *g, struct Code *arg, double *tol)
+{
+    if (parse_tolerance(arg, tol)) {
+        fprintf(g->err, "near %s:%li: expected a real literal as the "
+                "tolerance\n", g->file_name, arg->lineno);
+        return -1;
+    }
+    if (*tol < 0.0) {
+        fprintf(g->err, "near %s:%li: parsed a tolerance < 0.0; you need to "
+                "fix that\n", g->file_name, arg->lineno);
+        return -1;
+    }
+    return 0;
+}
+
+/* Prints a real argument as a double precision value: at full precision if
+ * it is a literal, converted with real() if it is an expression.
+ */
+static void print_real_arg(struct CodeGen *g, struct Code *arg)
+{
+    double x;
+
+    if (parse_tolerance(arg, &x) == 0) {
+        print_real64(g, x);
+    } else {
+        emit_str(g->out, "real(");
+        PRINT_CODE(arg);
+        emit_str(g->out, ", kind(1d0))");
+    }
+}
+
+/* Prints a tolerance argument like print_real_arg(), checking it first if
+ * it is a literal.
+ */
+static int print_tolerance(struct CodeGen *g, struct Code *arg)
+{
+    double tol;
+
+    if (parse_tolerance(arg, &tol) == 0 && check_tolerance(g, arg, &tol))
+        return -1;
+    print_real_arg(g, arg);
+    return 0;
+}
+
+/* If arg is "NAME = value", with NAME in any case, points value at just the
+ * value and returns TRUE.
+ */
+static int keyword_arg(struct Code *arg, const char *name, struct Code *value)
+{
+    size_t n = strlen(name);
+    char *s = arg->u.c.str, *end = s + arg->u.c.len;
+
+    if (arg->u.c.len <= n || strncasecmp(s, name, n))
+        return FALSE;
+    s += n;
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+    if (s == end || *s != '=' || (s + 1 < end && s[1] == '='))
+        return FALSE;
+    s++;
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+    *value = *arg;
+    value->u.c.str = s;
+    value->u.c.len = end - s;
+    value->next = NULL;
+    return TRUE;
 }
 
 /* assert_true(expr) becomes:
@@ -159,23 +323,23 @@ static void print_macro_arg(struct Code *arg)
  *       return
  *     end if
  */
-static int generate_assert_true(struct Code *macro)
+static int generate_assert_true(struct CodeGen *g, struct Code *macro)
 {
     struct Code *arg = macro->u.m.args;
 
-    if (check_assert_args("assert_true", macro, arg, 1) != 1)
+    if (check_assert_args(g, "assert_true", macro, arg, 1) != 1)
         return -1;
 
-    fputs("! assert_true()\n", fout);
-    fputs("    if (.not. (", fout);
+    emit_str(g->out, "! assert_true()\n");
+    emit_str(g->out, "    if (.not. (");
     PRINT_CODE(arg);
-    fputs(")) then\n", fout);
-    fputs("      write(funit_message_,*) \"'", fout);
-    print_macro_arg(arg);
-    fputs("' is false\"\n", fout);
-    fputs("      funit_passed_ = .false.\n", fout);
-    fputs("      return\n", fout);
-    fputs("    end if", fout);
+    emit_str(g->out, ")) then\n");
+    emit_str(g->out, "      write(funit_message_,*) \"'");
+    print_macro_arg(g, arg);
+    emit_str(g->out, "' is false\"\n");
+    emit_str(g->out, "      funit_passed_ = .false.\n");
+    emit_printf(g->out, "      %s\n", g->fail_exit);
+    emit_str(g->out, "    end if");
 
     return 0;
 }
@@ -188,315 +352,759 @@ static int generate_assert_true(struct Code *macro)
  *       return
  *     end if
  */
-static int generate_assert_false(struct Code *macro)
+static int generate_assert_false(struct CodeGen *g, struct Code *macro)
 {
     struct Code *arg = macro->u.m.args;
 
-    if (check_assert_args("assert_false", macro, arg, 1) != 1)
+    if (check_assert_args(g, "assert_false", macro, arg, 1) != 1)
         return -1;
 
-    fputs("! assert_false()\n", fout);
-    fputs("    if (", fout);
+    emit_str(g->out, "! assert_false()\n");
+    emit_str(g->out, "    if (");
     PRINT_CODE(arg);
-    fputs(") then\n", fout);
-    fputs("      write(funit_message_,*) \"'", fout);
-    print_macro_arg(arg);
-    fputs("' is true\"\n", fout);
-    fputs("      funit_passed_ = .false.\n", fout);
-    fputs("      return\n", fout);
-    fputs("    end if", fout);
+    emit_str(g->out, ") then\n");
+    emit_str(g->out, "      write(funit_message_,*) \"'");
+    print_macro_arg(g, arg);
+    emit_str(g->out, "' is true\"\n");
+    emit_str(g->out, "      funit_passed_ = .false.\n");
+    emit_printf(g->out, "      %s\n", g->fail_exit);
+    emit_str(g->out, "    end if");
 
     return 0;
 }
 
+/* Binds the arguments to funit_a_ and funit_b_ so they are evaluated only
+ * once, however often the generated code refers to them.  A variable is
+ * aliased rather than copied.
+ */
+static void print_associate(struct CodeGen *g, struct Code *a, struct Code *b)
+{
+    emit_str(g->out, "    associate (funit_a_ => ");
+    PRINT_CODE(a);
+    emit_str(g->out, ", funit_b_ => ");
+    PRINT_CODE(b);
+    emit_str(g->out, ")\n");
+}
+
+/* Prints the end of a scalar comparison lowered to funit_fails(), which
+ * reports the value of a if the comparison failed:
+ *
+ *     -a-, "-a-", "WHAT", "-b-", funit_passed_, funit_message_)) return
+ *
+ * print_fails_a() prints up to the opening quote of WHAT and print_fails_b()
+ * from its closing quote, for callers that build WHAT themselves.
+ */
+static void print_fails_a(struct CodeGen *g, struct Code *a)
+{
+    PRINT_CODE(a);
+    emit_str(g->out, ", &\n      \"");
+    print_macro_arg(g, a);
+    emit_str(g->out, "\", \"");
+}
+
+static void print_fails_b(struct CodeGen *g, struct Code *b)
+{
+    emit_str(g->out, "\", \"");
+    print_macro_arg(g, b);
+    emit_printf(g->out, "\", funit_passed_, funit_message_)) %s",
+                g->fail_exit);
+}
+
+static void print_fails_args(struct CodeGen *g, struct Code *a, struct Code *b,
+                             const char *what)
+{
+    print_fails_a(g, a);
+    emit_printf(g->out, "%s", what); // copied: what may be on the stack
+    print_fails_b(g, b);
+}
+
+/* Prints the test that a and b differ, compared exactly as the set's
+ * exact_compare asks, and returns how to say that they do:
+ *
+ *     (a) /= (b)                                          value
+ *     funit_a_ /= funit_b_ .and. (funit_a_ == funit_a_ .or. &
+ *       funit_b_ == funit_b_)                              nan_equal
+ *     funit_bytes_differ(transfer(a, ["x"]), transfer(b, ["x"]))  bitwise
+ *
+ * Only the bitwise test needs a and b of the same type and kind.
+ */
+static const char *print_exact_differ(struct CodeGen *g, struct Code *a,
+                                      struct Code *b)
+{
+    switch (g->set->exact_compare) {
+    case EXACT_BITWISE:
+        emit_str(g->out, "funit_bytes_differ(transfer(");
+        PRINT_CODE(a);
+        emit_str(g->out, ", [\"x\"]), transfer(");
+        PRINT_CODE(b);
+        emit_str(g->out, ", [\"x\"]))");
+        return "is not bitwise equal to";
+    case EXACT_NAN_EQUAL:
+        // a and b are bound once by print_assert_equal()
+        emit_str(g->out, "funit_a_ /= funit_b_ .and. (funit_a_ == funit_a_ "
+                 ".or. funit_b_ == funit_b_)");
+        return "is not equal to";
+    default:
+        emit_str(g->out, "(");
+        PRINT_CODE(a);
+        emit_str(g->out, ") /= (");
+        PRINT_CODE(b);
+        emit_str(g->out, ")");
+        return "is not equal to";
+    }
+}
+
+static void print_assert_equal(struct CodeGen *g, struct Code *a,
+                               struct Code *b)
+{
+    const char *what;
+
+    if (g->set->exact_compare != EXACT_NAN_EQUAL) {
+        emit_str(g->out, "    if (funit_fails(");
+        what = print_exact_differ(g, a, b);
+        emit_str(g->out, ", ");
+        print_fails_args(g, a, b, what);
+        return;
+    }
+
+    // the NaN test refers to a and b three times each, so they are bound
+    // once
+    print_associate(g, a, b);
+    emit_str(g->out, "      if (funit_fails(");
+    what = print_exact_differ(g, a, b);
+    emit_str(g->out, ", funit_a_, &\n        \"");
+    print_macro_arg(g, a);
+    emit_printf(g->out, "\", \"%s", what);
+    print_fails_b(g, b);
+    emit_str(g->out, "\n    end associate");
+}
+
 /* assert_equal(a,b) becomes:
  *
- *     if ((a) /= (b)) then
- *       write(_message,*) "-a- is not equal to -b-"
- *       funit_passed_ = .false.
- *       return
- *     end if
+ *     if (funit_fails((a) /= (b), a, &
+ *       "-a-", "is not equal to", "-b-", funit_passed_, funit_message_)) return
+ *
+ * or another test of a and b (see print_exact_differ()).  The comparison
+ * stays in the test code so a and b may be of different types or kinds.
  */
-static int generate_assert_equal(struct Code *macro)
+static int generate_assert_equal(struct CodeGen *g, struct Code *macro)
 {
-    struct Code *a = macro->u.m.args, *b;
+    struct Code *a = macro->u.m.args;
 
-    if (check_assert_args("assert_equal", macro, a, 2) != 2)
+    if (check_assert_args(g, "assert_equal", macro, a, 2) != 2)
         return -1;
-    b = a->next;
 
-    fputs("! assert_equal()\n", fout);
-    fputs("    if ((", fout);
-    PRINT_CODE(a);
-    fputs(") /= (", fout);
-    PRINT_CODE(b);
-    fputs(")) then\n", fout);
-    fputs("      write(funit_message_,*) \"'",fout);
-    print_macro_arg(a);
-    fputs("' (\", ", fout);
-    PRINT_CODE(a);
-    fputs(", &\n\") is not equal to '", fout);
-    print_macro_arg(b);
-    fputs("'\"\n", fout);
-    fputs("      funit_passed_ = .false.\n", fout);
-    fputs("      return\n", fout);
-    fputs("    end if", fout);
+    emit_str(g->out, "! assert_equal()\n");
+    print_assert_equal(g, a, a->next);
 
     return 0;
 }
 
 /* assert_not_equal(a,b) becomes:
  *
- *     if ((a) == (b)) then
- *       write(_message,*) "-a- is equal to -b-"
- *       funit_passed_ = .false.
- *       return
- *     end if
+ *     if (funit_fails((a) == (b), a, &
+ *       "-a-", "is equal to", "-b-", funit_passed_, funit_message_)) return
  */
-static int generate_assert_not_equal(struct Code *macro)
+static int generate_assert_not_equal(struct CodeGen *g, struct Code *macro)
 {
     struct Code *a = macro->u.m.args, *b;
 
-    if (check_assert_args("assert_not_equal", macro, a, 2) != 2)
+    if (check_assert_args(g, "assert_not_equal", macro, a, 2) != 2)
         return -1;
     b = a->next;
 
-    fputs("! assert_not_equal()\n", fout);
-    fputs("    if ((", fout);
+    emit_str(g->out, "! assert_not_equal()\n");
+    emit_str(g->out, "    if (funit_fails((");
     PRINT_CODE(a);
-    fputs(") == (", fout);
+    emit_str(g->out, ") == (");
     PRINT_CODE(b);
-    fputs(")) then\n", fout);
-    fputs("      write(funit_message_,*) \"'",fout);
-    print_macro_arg(a);
-    fputs("' (\", ", fout);
-    PRINT_CODE(a);
-    fputs(", &\n\") is equal to '", fout);
-    print_macro_arg(b);
-    fputs("'\"\n", fout);
-    fputs("      funit_passed_ = .false.\n", fout);
-    fputs("      return\n", fout);
-    fputs("    end if", fout);
+    emit_str(g->out, "), ");
+    print_fails_args(g, a, b, "is equal to");
 
     return 0;
 }
 
+/* Finds the tolerance of a _with assertion: its third argument if it has
+ * one, or else the set's tolerance.
+ */
+static int with_tolerance(struct CodeGen *g, const char *macro_name,
+                          struct Code *macro, int num_args, double *tol)
+{
+    if (num_args == 3)
+        return check_tolerance(g, macro->u.m.args->next->next, tol);
+    if (g->set->tolerance == NO_TOLERANCE) {
+        fprintf(g->err, "near %s:%li: %s() has no tolerance argument, and "
+                "set %.*s has no tolerance\n", g->file_name, macro->lineno,
+                macro_name, (int)g->set->namelen, g->set->name);
+        return -1;
+    }
+    *tol = g->set->tolerance;
+    return 0;
+}
+
 /* assert_equal_with(a,b[,tol]) becomes:
  *
- *     if (abs((a) - (b)) > TOLERANCE) then
- *       write(_message,*) "-a- is not within", TOLERANCE, "of -b-"
- *       funit_passed_ = .false.
- *       return
- *     end if
+ *     if (funit_fails(.not. (abs((a) - (b)) <= TOLERANCE), a, &
+ *       "-a-", "is not within TOLERANCE of", "-b-", funit_passed_, &
+ *       funit_message_)) return
+ *
+ * which a NaN fails, or with a zero TOLERANCE, the same as assert_equal(a,b).
  */
-static int generate_assert_equal_with(struct Code *macro, double tolerance)
+static int generate_assert_equal_with(struct CodeGen *g, struct Code *macro)
 {
     struct Code *a = macro->u.m.args, *b;
-    double this_tolerance;
+    double tolerance;
     int num_args;
+    char what[64];
 
-    num_args = check_assert_args2("assert_equal_with", macro, a, 2, 3);
-    if (num_args < 2) {
+    num_args = check_assert_args2(g, "assert_equal_with", macro, a, 2, 3);
+    if (num_args < 2)
+        return -1;
+    if (with_tolerance(g, "assert_equal_with", macro, num_args, &tolerance))
         return -1;
-    }
     b = a->next;
-    if (num_args == 2) {
-        if (tolerance < 0.0) {
-            fprintf(stderr, "near %s:%li: missing a tolerance argument or "
-                    "a set-level default tolerance\n",
-                    test_set_file_name, macro->lineno);
-            return -1;
-        }
-        this_tolerance = tolerance;
-    } else if (num_args == 3) {
-        this_tolerance = strtod(b->next->u.c.str, NULL);
-        if (this_tolerance < 0.0) {
-            fprintf(stderr, "near %s:%li: in assert_array_equal(): parsed "
-                    "a tolerance < 0.0; you need to fix that\n",
-                    test_set_file_name, macro->lineno);
-            return -1;
-        }
-    } else {
-        abort();
-    }
 
-    // XXX generate different code if tolerance = 0
-    fprintf(fout, "! assert_equal_with(%s)\n", (num_args == 3) ? "tol" : "");
-    fputs("    if (abs((", fout);
+    emit_printf(g->out, "! assert_equal_with(%s)\n", (num_args == 3) ? "tol" : "");
+    if (tolerance == 0.0) {
+        print_assert_equal(g, a, b);
+        return 0;
+    }
+    emit_str(g->out, "    if (funit_fails(.not. (abs((");
     PRINT_CODE(a);
-    fputs(") - (", fout);
+    emit_str(g->out, ") - (");
     PRINT_CODE(b);
-    fprintf(fout, ")) > %g) then\n", this_tolerance);
-    fputs("      write(funit_message_,*) \"'",fout);
-    print_macro_arg(a);
-    fputs("' (\", ", fout);
-    PRINT_CODE(a);
-    fprintf(fout, ", &\n\") is not within %g of '", this_tolerance);
-    print_macro_arg(b);
-    fputs("'\"\n", fout);
-    fputs("      funit_passed_ = .false.\n", fout);
-    fputs("      return\n", fout);
-    fputs("    end if", fout);
+    emit_str(g->out, ")) <= ");
+    print_real64(g, tolerance);
+    emit_str(g->out, "), ");
+    snprintf(what, sizeof(what), "is not within %g of", tolerance);
+    print_fails_args(g, a, b, what);
 
     return 0;
 }
 
-static void print_array_size_check(struct Code *a, struct Code *b)
+/* Like print_fails_a() and print_fails_b(), for the calls into the funit
+ * module that compare the arrays bound by print_associate() and
+ * describe any mismatches: just the first, or statistics on all of them if
+ * the set asks for mismatch_stats.  The caller prints the arguments specific
+ * to PROC in between:
+ *
+ *       if (PROC(funit_a_, funit_b_, ..., SHOWN, &
+ *         lbound(funit_a_), lbound(funit_b_), "-a-", "WHAT", "-b-", &
+ *         funit_passed_, funit_message_)) return
+ *     end associate
+ */
+static void print_array_call(struct CodeGen *g, const char *proc)
+{
+    emit_printf(g->out, "      if (%s(funit_a_, funit_b_, ", proc);
+}
+
+static void print_array_a(struct CodeGen *g, struct Code *a)
 {
-    fputs("    if (size(", fout);
-    PRINT_CODE(a);
-    fputs(") /= size(", fout);
-    PRINT_CODE(b);
-    fputs(")) then\n", fout);
-    fputs("      write(funit_message_,*) \"'",fout);
-    print_macro_arg(a);
-    fputs("' and '", fout);
-    print_macro_arg(b);
-    fputs("' &\n        &are not the same length:\", size(", fout);
-    PRINT_CODE(a);
-    fputs("), \"vs.\", size(", fout);
-    PRINT_CODE(b);
-    fputs(")\n", fout);
-    fputs("      funit_passed_ = .false.\n", fout);
-    fputs("      return\n", fout);
-    fputs("    end if\n", fout);
+    emit_printf(g->out, ", %i, &\n        lbound(funit_a_), lbound(funit_b_), "
+                "\"", g->set->mismatch_stats);
+    print_macro_arg(g, a);
+    emit_str(g->out, "\", \"");
+}
+
+static void print_array_b(struct CodeGen *g, struct Code *b)
+{
+    emit_str(g->out, "\", \"");
+    print_macro_arg(g, b);
+    emit_printf(g->out, "\", &\n        funit_passed_, funit_message_)) %s\n",
+                g->fail_exit);
+    emit_str(g->out, "    end associate");
+}
+
+/* Prints the call to funit_array_differ(), comparing exactly as the set's
+ * exact_compare asks if tolerance < 0.
+ */
+static void print_array_differ(struct CodeGen *g, struct Code *a,
+                               struct Code *b, double tolerance)
+{
+    print_array_call(g, "funit_array_differ");
+    if (tolerance >= 0.0)
+        print_real64(g, tolerance);
+    else if (g->set->exact_compare == EXACT_NAN_EQUAL)
+        emit_str(g->out, "funit_exact_nan_equal");
+    else if (g->set->exact_compare == EXACT_BITWISE)
+        emit_str(g->out, "funit_exact_bitwise");
+    else
+        emit_str(g->out, "funit_exact");
+    print_array_a(g, a);
+    if (tolerance >= 0.0)
+        emit_printf(g->out, "is not within %g of", tolerance);
+    else if (g->set->exact_compare == EXACT_BITWISE)
+        emit_str(g->out, "is not bitwise equal to");
+    else
+        emit_str(g->out, "is not equal to");
+    print_array_b(g, b);
 }
 
 /* assert_array_equal(a,b) becomes:
  *
- *     if (size(a) /= size(b)) then
- *       write(funit_message_,*) "-a- is length", size(a), &
- *         "which is not the same as -b- which is length", size(b)
- *       funit_passed_ = .false.
- *       return
- *     end if
- *     do funit_i_ = 1,size(a)
- *       if (a(funit_i_) /= b(funit_i_)) then
- *         write(funit_message_,*) "-a-(", funit_i_, ") is not equal to -b-(", &
- *           funit_i_, "): ", a(funit_i_), "vs", b(funit_i_)
- *         funit_passed_ = .false.
- *         return
- *       end if
- *     end do
+ *     associate (funit_a_ => a, funit_b_ => b)
+ *       if (funit_array_differ(funit_a_, funit_b_, funit_exact, SHOWN, &
+ *         lbound(funit_a_), lbound(funit_b_), "-a-", "is not equal to", "-b-", &
+ *         funit_passed_, funit_message_)) return
+ *     end associate
+ *
+ * funit_array_differ() in the funit module checks the shapes, compares the
+ * arrays with a whole-array reduction the compiler can vectorize, and only
+ * if that fails scans for the mismatches to report.  funit_exact is
+ * funit_exact_nan_equal or funit_exact_bitwise as the set's exact_compare
+ * asks.  SHOWN is the set's mismatch_stats, -1 unless it asks for statistics
+ * on all the mismatches.
  */
-static int generate_assert_array_equal(struct Code *macro)
+static int generate_assert_array_equal(struct CodeGen *g, struct Code *macro)
 {
     struct Code *a = macro->u.m.args, *b;
 
-    if (check_assert_args("assert_array_equal", macro, a, 2) != 2)
+    if (check_assert_args(g, "assert_array_equal", macro, a, 2) != 2)
         return -1;
     b = a->next;
 
-    fputs("! assert_array_equal()\n", fout);
+    emit_str(g->out, "! assert_array_equal()\n");
+    print_associate(g, a, b);
+    print_array_differ(g, a, b, -1.0);
+
+    return 0;
+}
 
-    print_array_size_check(a, b);
+/* assert_array_equal_with(a,b[,tol]) becomes:
+ *
+ *     associate (funit_a_ => a, funit_b_ => b)
+ *       if (funit_array_differ(funit_a_, funit_b_, TOLERANCE, SHOWN, &
+ *         lbound(funit_a_), lbound(funit_b_), "-a-", &
+ *         "is not within TOLERANCE of", "-b-", funit_passed_, &
+ *         funit_message_)) return
+ *     end associate
+ *
+ * or with a zero TOLERANCE, the same as assert_array_equal(a,b).
+ */
+static int generate_assert_array_equal_with(struct CodeGen *g,
+                                            struct Code *macro)
+{
+    struct Code *a = macro->u.m.args;
+    double tolerance;
+    int num_args;
 
-    // do loop
-    fputs("    do funit_i_ = 1,size(", fout);
-    PRINT_CODE(a);
-    fputs(")\n", fout);
-    fputs("      if (", fout);
-    PRINT_CODE(a);
-    fputs("(funit_i_) /= ", fout);
-    PRINT_CODE(b);
-    fputs("(funit_i_)) then\n", fout);
-    fputs("        write(funit_message_,*) \"", fout);
-    print_macro_arg(a);
-    fputs("(\", funit_i_, &\n          \") is not equal to ", fout);
-    print_macro_arg(b);
-    fputs("(\", funit_i_, &\n          \"): \", ", fout);
+    num_args = check_assert_args2(g, "assert_array_equal_with", macro, a,
+                                  2, 3);
+    if (num_args < 2)
+        return -1;
+    if (with_tolerance(g, "assert_array_equal_with", macro, num_args,
+                       &tolerance))
+        return -1;
+
+    emit_printf(g->out, "! assert_array_equal_with(%s)\n",
+            (num_args == 3) ? "tol" : "");
+    print_associate(g, a, a->next);
+    // a zero tolerance is an exact comparison, which is cheaper
+    print_array_differ(g, a, a->next, tolerance > 0.0 ? tolerance : -1.0);
+
+    return 0;
+}
+
+/* The tolerances of assert_close() and assert_array_close(), given after a
+ * and b by position, rtol then atol, or as rtol= and atol=.  Either may be
+ * left out (NULL), but not both.
+ */
+struct CloseTolerances {
+    struct Code rtol_value, atol_value;
+    struct Code *rtol, *atol;
+};
+
+static int close_tolerances(struct CodeGen *g, const char *macro_name,
+                            struct Code *macro, struct Code *arg,
+                            struct CloseTolerances *t)
+{
+    struct Code **tol, *value;
+    int keywords = 0;
+
+    if (check_assert_args2(g, macro_name, macro, arg, 3, 4) < 3)
+        return -1;
+    t->rtol = t->atol = NULL;
+    for (arg = arg->next->next; arg; arg = arg->next) {
+        if (keyword_arg(arg, "rtol", &t->rtol_value)) {
+            tol = &t->rtol;
+            value = &t->rtol_value;
+            keywords = 1;
+        } else if (keyword_arg(arg, "atol", &t->atol_value)) {
+            tol = &t->atol;
+            value = &t->atol_value;
+            keywords = 1;
+        } else if (keywords) {
+            fprintf(g->err, "near %s:%li: in %s(): a tolerance without rtol= "
+                    "or atol= follows one with\n", g->file_name, arg->lineno,
+                    macro_name);
+            return -1;
+        } else {
+            tol = t->rtol ? &t->atol : &t->rtol;
+            value = arg;
+        }
+        if (*tol) {
+            fprintf(g->err, "near %s:%li: in %s(): %s is given twice\n",
+                    g->file_name, arg->lineno, macro_name,
+                    (tol == &t->rtol) ? "rtol" : "atol");
+            return -1;
+        }
+        *tol = value;
+    }
+    return 0;
+}
+
+/* Prints "rtol=RTOL, atol=ATOL" for messages, leaving out a missing one.
+ */
+static void print_close_tolerances(struct CodeGen *g,
+                                   const struct CloseTolerances *t)
+{
+    if (t->rtol) {
+        emit_str(g->out, "rtol=");
+        print_macro_arg(g, t->rtol);
+    }
+    if (t->atol) {
+        emit_str(g->out, t->rtol ? ", atol=" : "atol=");
+        print_macro_arg(g, t->atol);
+    }
+}
+
+/* assert_close(a,b,[rtol=]RTOL,[atol=]ATOL) becomes:
+ *
+ *     if (funit_fails(.not. (abs((a) - (b)) <= ATOL + RTOL * abs(b)), a, &
+ *       "-a-", "is not within rtol=RTOL, atol=ATOL of", "-b-", &
+ *       funit_passed_, funit_message_)) return
+ *
+ * leaving out the term for a missing tolerance.  The test is written so that
+ * a NaN never passes.  RTOL and ATOL are printed as double precision values
+ * (see print_tolerance()).
+ */
+static int generate_assert_close(struct CodeGen *g, struct Code *macro)
+{
+    struct Code *a = macro->u.m.args, *b;
+    struct CloseTolerances t;
+
+    if (close_tolerances(g, "assert_close", macro, a, &t))
+        return -1;
+    b = a->next;
+
+    emit_str(g->out, "! assert_close()\n");
+    emit_str(g->out, "    if (funit_fails(.not. (abs((");
     PRINT_CODE(a);
-    fputs("(funit_i_), \"vs\", ", fout);
+    emit_str(g->out, ") - (");
     PRINT_CODE(b);
-    fputs("(funit_i_)\n", fout);
-    fputs("        funit_passed_ = .false.\n", fout);
-    fputs("        return\n", fout);
-    fputs("      end if\n", fout);
-    fputs("    end do", fout);
+    emit_str(g->out, ")) <= ");
+    if (t.atol && print_tolerance(g, t.atol))
+        return -1;
+    if (t.rtol) {
+        if (t.atol)
+            emit_str(g->out, " + ");
+        if (print_tolerance(g, t.rtol))
+            return -1;
+        emit_str(g->out, " * abs(");
+        PRINT_CODE(b);
+        emit_str(g->out, ")");
+    }
+    emit_str(g->out, "), ");
+    print_fails_a(g, a);
+    emit_str(g->out, "is not within ");
+    print_close_tolerances(g, &t);
+    emit_str(g->out, " of");
+    print_fails_b(g, b);
 
     return 0;
 }
 
-/* assert_array_equal_with(a,b[,tol]) becomes:
+/* assert_array_close(a,b,[rtol=]RTOL,[atol=]ATOL) becomes:
  *
- *     if (size(a) /= size(b)) then
- *       write(_message,*) "-a- is length", size(a), &
- *         "which is not the same as -b- which is length", size(b)
- *       funit_passed_ = .false.
- *       return
- *     end if
- *     do funit_i_ = 1,size(a)
- *       if (abs(a(funit_i_) - b(funit_i_)) > TOLERANCE) then
- *         write(_message,*) "-a-(", funit_i_, ") is not within", TOLERANCE, &
- *           "of -b-(", funit_i_, "): ", a(funit_i_), "vs", b(funit_i_)
- *         funit_passed_ = .false.
- *         return
- *       end if
- *     end do
+ *     associate (funit_a_ => a, funit_b_ => b)
+ *       if (funit_array_not_close(funit_a_, funit_b_, RTOL, ATOL, SHOWN, &
+ *         lbound(funit_a_), lbound(funit_b_), "-a-", &
+ *         "is not within rtol=RTOL, atol=ATOL of", "-b-", funit_passed_, &
+ *         funit_message_)) return
+ *     end associate
+ *
+ * with 0d0 for a missing tolerance.
  */
-static int generate_assert_array_equal_with(struct Code *macro,
-                                            double tolerance)
+static int generate_assert_array_close(struct CodeGen *g, struct Code *macro)
 {
     struct Code *a = macro->u.m.args, *b;
-    float this_tolerance;
-    int num_args;
+    struct CloseTolerances t;
 
-    num_args = check_assert_args2("assert_array_equal", macro, a, 2, 3);
-    if (num_args < 2) {
+    if (close_tolerances(g, "assert_array_close", macro, a, &t))
         return -1;
-    }
     b = a->next;
-    if (num_args == 2) {
-        if (tolerance < 0.0) {
-            fprintf(stderr, "near %s:%li: in assert_array_equal(): missing "
-                    "a tolerance argument or a set-level default tolerance\n",
-                    test_set_file_name, macro->lineno);
+
+    emit_str(g->out, "! assert_array_close()\n");
+    print_associate(g, a, b);
+    print_array_call(g, "funit_array_not_close");
+    if (t.rtol) {
+        if (print_tolerance(g, t.rtol))
             return -1;
-        }
-        this_tolerance = tolerance;
-    } else if (num_args == 3) {
-        this_tolerance = strtod(b->next->u.c.str, NULL);
-        if (this_tolerance < 0.0) {
-            fprintf(stderr, "near %s:%li: in assert_array_equal(): parsed "
-                    "a tolerance < 0.0; you need to fix that\n",
-                    test_set_file_name, macro->lineno);
+    } else {
+        emit_str(g->out, "0d0");
+    }
+    emit_str(g->out, ", ");
+    if (t.atol) {
+        if (print_tolerance(g, t.atol))
             return -1;
-        }
     } else {
-        abort();
+        emit_str(g->out, "0d0");
     }
+    print_array_a(g, a);
+    emit_str(g->out, "is not within ");
+    print_close_tolerances(g, &t);
+    emit_str(g->out, " of");
+    print_array_b(g, b);
 
-    fprintf(fout, "! assert_array_equal_with(%s)\n",
-            (num_args == 3) ? "tol" : "");
+    return 0;
+}
 
-    // length check
-    print_array_size_check(a, b);
+/* assert_ulp(a,b,n) becomes:
+ *
+ *     if (funit_fails(funit_ulp_distance(a, b) > (n), a, &
+ *       "-a-", "is more than -n- ulps from", "-b-", funit_passed_, &
+ *       funit_message_)) return
+ *
+ * a and b must be reals of the same kind.
+ */
+static int generate_assert_ulp(struct CodeGen *g, struct Code *macro)
+{
+    struct Code *a = macro->u.m.args, *b, *n;
 
-    // XXX generate different code if tolerance = 0
+    if (check_assert_args(g, "assert_ulp", macro, a, 3) != 3)
+        return -1;
+    b = a->next;
+    n = b->next;
 
-    // do loop
-    fputs("    do funit_i_ = 1,size(", fout);
-    PRINT_CODE(a);
-    fputs(")\n", fout);
-    fputs("      if (abs(", fout);
+    emit_str(g->out, "! assert_ulp()\n");
+    emit_str(g->out, "    if (funit_fails(funit_ulp_distance(");
     PRINT_CODE(a);
-    fputs("(funit_i_) - ", fout);
+    emit_str(g->out, ", ");
     PRINT_CODE(b);
-    fprintf(fout, "(funit_i_)) > %g) then\n", this_tolerance);
-    fputs("        write(funit_message_,*) \"", fout);
-    print_macro_arg(a);
-    fprintf(fout, "(\", funit_i_, &\n          \") is not within %g of ",
-            this_tolerance);
-    print_macro_arg(b);
-    fputs("(\", funit_i_, &\n          \"): \", ", fout);
-    PRINT_CODE(a);
-    fputs("(funit_i_), \"vs\", ", fout);
-    PRINT_CODE(b);
-    fputs("(funit_i_)\n", fout);
-    fputs("        funit_passed_ = .false.\n", fout);
-    fputs("        return\n", fout);
-    fputs("      end if\n", fout);
-    fputs("    end do", fout);
+    emit_str(g->out, ") > (");
+    PRINT_CODE(n);
+    emit_str(g->out, "), ");
+    print_fails_a(g, a);
+    emit_str(g->out, "is more than ");
+    print_macro_arg(g, n);
+    emit_str(g->out, " ulps from");
+    print_fails_b(g, b);
+
+    return 0;
+}
+
+/* assert_array_ulp(a,b,n) becomes:
+ *
+ *     associate (funit_a_ => a, funit_b_ => b)
+ *       if (funit_array_not_within_ulps(funit_a_, funit_b_, &
+ *         int(n, selected_int_kind(18)), SHOWN, &
+ *         lbound(funit_a_), lbound(funit_b_), "-a-", &
+ *         "is more than -n- ulps from", "-b-", funit_passed_, &
+ *         funit_message_)) return
+ *     end associate
+ */
+static int generate_assert_array_ulp(struct CodeGen *g, struct Code *macro)
+{
+    struct Code *a = macro->u.m.args, *b, *n;
+
+    if (check_assert_args(g, "assert_array_ulp", macro, a, 3) != 3)
+        return -1;
+    b = a->next;
+    n = b->next;
+
+    emit_str(g->out, "! assert_array_ulp()\n");
+    print_associate(g, a, b);
+    print_array_call(g, "funit_array_not_within_ulps");
+    emit_str(g->out, "&\n        int(");
+    PRINT_CODE(n);
+    emit_str(g->out, ", selected_int_kind(18))");
+    print_array_a(g, a);
+    emit_str(g->out, "is more than ");
+    print_macro_arg(g, n);
+    emit_str(g->out, " ulps from");
+    print_array_b(g, b);
+
+    return 0;
+}
+
+/* Points stmt at a statement argument without any line continuation (or
+ * comment after it) that it starts with, so it can begin a line of its own.
+ */
+static void statement_arg(struct Code *arg, struct Code *stmt)
+{
+    char *s = arg->u.c.str, *end = s + arg->u.c.len;
+
+    while (s < end && strchr(" \t\r\n&!", *s)) {
+        if (*s == '!') {
+            while (s < end && *s != '\n')
+                s++;
+        } else {
+            s++;
+        }
+    }
+    *stmt = *arg;
+    stmt->u.c.str = s;
+    stmt->u.c.len = end - s;
+    stmt->next = NULL;
+}
+
+// the loop running one timed batch of stmt
+static void print_timed_batch(struct CodeGen *g, struct Code *arg,
+                              const char *indent)
+{
+    struct Code stmt;
+
+    statement_arg(arg, &stmt);
+    emit_printf(g->out, "%s  do funit_i_ = 1, funit_n_\n", indent);
+    emit_printf(g->out, "%s    ", indent);
+    PRINT_CODE(&stmt);
+    emit_printf(g->out, "\n%s  end do\n", indent);
+}
+
+/* assert_time_below(stmt,secs) becomes:
+ *
+ *     block
+ *       type(funit_timing) :: funit_t_
+ *       integer(selected_int_kind(18)) :: funit_i_, funit_n_
+ *       call funit_timing_begin(funit_t_, 1)
+ *       do while (funit_timing_next(funit_t_, funit_n_))
+ *         do funit_i_ = 1, funit_n_
+ *           -stmt-
+ *         end do
+ *       end do
+ *       if (funit_time_fails(funit_t_, SECS, "-stmt-", funit_passed_, &
+ *         funit_message_)) return
+ *     end block
+ *
+ * which fails unless the best of several calibrated batches of stmt took
+ * less than secs seconds a run.  SECS is secs as a double precision value
+ * (see print_real_arg()).
+ */
+static int generate_assert_time_below(struct CodeGen *g, struct Code *macro)
+{
+    struct Code *stmt = macro->u.m.args, *secs, text;
+
+    if (check_assert_args(g, "assert_time_below", macro, stmt, 2) != 2)
+        return -1;
+    secs = stmt->next;
+
+    emit_str(g->out, "! assert_time_below()\n");
+    emit_str(g->out, "    block\n");
+    emit_str(g->out, "      type(funit_timing) :: funit_t_\n");
+    emit_str(g->out, "      integer(selected_int_kind(18)) :: funit_i_, "
+             "funit_n_\n");
+    emit_str(g->out, "      call funit_timing_begin(funit_t_, 1)\n");
+    emit_str(g->out, "      do while (funit_timing_next(funit_t_, "
+             "funit_n_))\n");
+    print_timed_batch(g, stmt, "      ");
+    emit_str(g->out, "      end do\n");
+    emit_str(g->out, "      if (funit_time_fails(funit_t_, ");
+    print_real_arg(g, secs);
+    emit_str(g->out, ", &\n        \"");
+    statement_arg(stmt, &text);
+    print_macro_arg(g, &text);
+    emit_printf(g->out, "\", funit_passed_, funit_message_)) %s\n",
+                g->fail_exit);
+    emit_str(g->out, "    end block");
+
+    return 0;
+}
+
+/* assert_faster_than(new,old,ratio) times new and old the same way, taking
+ * their batches in turn so drift in the machine's speed hits both alike:
+ *
+ *     block
+ *       ...
+ *       call funit_timing_begin(funit_t_, 2)
+ *       do while (funit_timing_next(funit_t_, funit_n_))
+ *         if (funit_t_%variant == 1) then
+ *           do funit_i_ = 1, funit_n_
+ *             -new-
+ *           end do
+ *         else
+ *           ... -old- ...
+ *         end if
+ *       end do
+ *       if (funit_slower_fails(funit_t_, RATIO, "-new-", "-old-", &
+ *         funit_passed_, funit_message_)) return
+ *     end block
+ *
+ * which fails unless old's best time is at least ratio times new's.
+ */
+static int generate_assert_faster_than(struct CodeGen *g, struct Code *macro)
+{
+    struct Code *new = macro->u.m.args, *old, *ratio, text;
+
+    if (check_assert_args(g, "assert_faster_than", macro, new, 3) != 3)
+        return -1;
+    old = new->next;
+    ratio = old->next;
+
+    emit_str(g->out, "! assert_faster_than()\n");
+    emit_str(g->out, "    block\n");
+    emit_str(g->out, "      type(funit_timing) :: funit_t_\n");
+    emit_str(g->out, "      integer(selected_int_kind(18)) :: funit_i_, "
+             "funit_n_\n");
+    emit_str(g->out, "      call funit_timing_begin(funit_t_, 2)\n");
+    emit_str(g->out, "      do while (funit_timing_next(funit_t_, "
+             "funit_n_))\n");
+    emit_str(g->out, "        if (funit_t_%variant == 1) then\n");
+    print_timed_batch(g, new, "        ");
+    emit_str(g->out, "        else\n");
+    print_timed_batch(g, old, "        ");
+    emit_str(g->out, "        end if\n");
+    emit_str(g->out, "      end do\n");
+    emit_str(g->out, "      if (funit_slower_fails(funit_t_, ");
+    print_real_arg(g, ratio);
+    emit_str(g->out, ", &\n        \"");
+    statement_arg(new, &text);
+    print_macro_arg(g, &text);
+    emit_str(g->out, "\", &\n        \"");
+    statement_arg(old, &text);
+    print_macro_arg(g, &text);
+    emit_printf(g->out, "\", funit_passed_, funit_message_)) %s\n",
+                g->fail_exit);
+    emit_str(g->out, "    end block");
+
+    return 0;
+}
+
+/* assert_max_allocations(stmt,limit) becomes:
+ *
+ *     block
+ *       integer(selected_int_kind(18)) :: funit_a_(3)
+ *       call funit_allocations_begin(funit_a_)
+ *       -stmt-
+ *       if (funit_allocations_fail(funit_a_, -limit-, "-stmt-", &
+ *         funit_passed_, funit_message_)) return
+ *     end block
+ *
+ * which fails unless running stmt once made at most limit heap allocations,
+ * as counted by memory_helper.c.
+ */
+static int generate_assert_max_allocations(struct CodeGen *g,
+                                           struct Code *macro)
+{
+    struct Code *stmt = macro->u.m.args, *limit, text;
+
+    if (check_assert_args(g, "assert_max_allocations", macro, stmt, 2) != 2)
+        return -1;
+    limit = stmt->next;
+
+    emit_str(g->out, "! assert_max_allocations()\n");
+    emit_str(g->out, "    block\n");
+    emit_str(g->out, "      integer(selected_int_kind(18)) :: funit_a_(3)\n");
+    emit_str(g->out, "      call funit_allocations_begin(funit_a_)\n");
+    statement_arg(stmt, &text);
+    emit_str(g->out, "      ");
+    PRINT_CODE(&text);
+    emit_str(g->out, "\n      if (funit_allocations_fail(funit_a_, ");
+    PRINT_CODE(limit);
+    emit_str(g->out, ", &\n        \"");
+    print_macro_arg(g, &text);
+    emit_printf(g->out, "\", funit_passed_, funit_message_)) %s\n",
+                g->fail_exit);
+    emit_str(g->out, "    end block");
 
     return 0;
 }
@@ -507,143 +1115,379 @@ static int generate_assert_array_equal_with(struct Code *macro,
  *     funit_passed_ = .false.
  *     return
  */
-static int generate_flunk(struct Code *macro)
+static int generate_flunk(struct CodeGen *g, struct Code *macro)
 {
     struct Code *arg = macro->u.m.args;
 
-    if (check_assert_args("flunk", macro, arg, 1) != 1)
+    if (check_assert_args(g, "flunk", macro, arg, 1) != 1)
         return -1;
 
-    fputs("! flunk()\n", fout);
-    fputs("    write(funit_message_,*) ", fout);
+    emit_str(g->out, "! flunk()\n");
+    emit_str(g->out, "    write(funit_message_,*) ");
     PRINT_CODE(arg);
-    fputs("\n", fout);
-    fputs("    funit_passed_ = .false.\n", fout);
-    fputs("    return\n", fout);
+    emit_str(g->out, "\n");
+    emit_str(g->out, "    funit_passed_ = .false.\n");
+    emit_printf(g->out, "    %s\n", g->fail_exit);
 
     return 0;
 }
 
-static int generate_assert(struct Code *macro, double tolerance)
+static int generate_assert(struct CodeGen *g, struct Code *macro)
 {
     assert(macro->type == MACRO_CODE);
 
     switch (macro->u.m.type) {
     case ASSERT_TRUE:
-        return generate_assert_true(macro);
+        return generate_assert_true(g, macro);
     case ASSERT_FALSE:
-        return generate_assert_false(macro);
+        return generate_assert_false(g, macro);
     case ASSERT_EQUAL:
-        return generate_assert_equal(macro);
+        return generate_assert_equal(g, macro);
     case ASSERT_NOT_EQUAL:
-        return generate_assert_not_equal(macro);
+        return generate_assert_not_equal(g, macro);
     case ASSERT_EQUAL_WITH:
-        return generate_assert_equal_with(macro, tolerance);
+        return generate_assert_equal_with(g, macro);
     case ASSERT_ARRAY_EQUAL:
-        return generate_assert_array_equal(macro);
+        return generate_assert_array_equal(g, macro);
     case ASSERT_ARRAY_EQUAL_WITH:
-        return generate_assert_array_equal_with(macro, tolerance);
+        return generate_assert_array_equal_with(g, macro);
+    case ASSERT_CLOSE:
+        return generate_assert_close(g, macro);
+    case ASSERT_ARRAY_CLOSE:
+        return generate_assert_array_close(g, macro);
+    case ASSERT_ULP:
+        return generate_assert_ulp(g, macro);
+    case ASSERT_ARRAY_ULP:
+        return generate_assert_array_ulp(g, macro);
+    case ASSERT_TIME_BELOW:
+        return generate_assert_time_below(g, macro);
+    case ASSERT_FASTER_THAN:
+        return generate_assert_faster_than(g, macro);
+    case ASSERT_MAX_ALLOCATIONS:
+        return generate_assert_max_allocations(g, macro);
     case FLUNK:
-        return generate_flunk(macro);
+        return generate_flunk(g, macro);
     default:
-        fprintf(stderr, "unknown assert type %i\n", macro->u.m.type);
+        fprintf(g->err, "unknown assert type %i\n", macro->u.m.type);
         abort();
     }
     return -1;
 }
 
-static int generate_code(struct Code *code, double tolerance)
+static int generate_code(struct CodeGen *g, struct Code *code)
 {
     switch (code->type) {
     case FORTRAN_CODE:
         PRINT_CODE(code);
         break;
     case MACRO_CODE:
-        if (generate_assert(code, tolerance))
+        if (generate_assert(g, code))
             return -1;
         break;
     default: // arg code
-        fprintf(stderr, "near %s:%li: bad code type %i in generate_code\n",
-                test_set_file_name, code->lineno, (int)code->type);
+        fprintf(g->err, "near %s:%li: bad code type %i in generate_code\n",
+                g->file_name, code->lineno, (int)code->type);
         abort();
         break;
     }
     if (code->next)
-        return generate_code(code->next, tolerance);
+        return generate_code(g, code->next);
     return 0;
 }
 
-static int generate_test(struct TestCase *test, int *test_i, double tolerance)
+static int generate_test(struct CodeGen *g, struct TestCase *test, int *test_i)
 {
-    if (test->next)
-        generate_test(test->next, test_i, tolerance);
+    if (test->next && generate_test(g, test->next, test_i))
+        return -1;
 
     *test_i += 1;
-    fprintf(fout, "  subroutine funit_test%i(funit_passed_, funit_message_)\n",
-            *test_i);
-    fputs("    implicit none\n\n", fout);
-    fputs("    logical, intent(out) :: funit_passed_\n", fout);
-    fputs("    character(*), intent(out) :: funit_message_\n", fout);
-    if (test->need_array_iterator)
-        fputs("    integer :: funit_i_\n", fout);
-    fputs("\n", fout);
+    // a test over a table runs in the set's loop over its cases
+    if (test->over)
+        return 0;
+
+    emit_printf(g->out, "  subroutine funit_test%i(funit_passed_, "
+                "funit_message_)\n", *test_i);
+    emit_str(g->out, "    implicit none\n\n");
+    emit_str(g->out, "    logical, intent(out) :: funit_passed_\n");
+    emit_str(g->out, "    character(*), intent(out) :: funit_message_\n");
+    emit_str(g->out, "\n");
 
     if (test->code) {
-        if (generate_code(test->code, tolerance))
+        if (generate_code(g, test->code))
             return -1;
     }
 
-    fputs("\n    funit_passed_ = .true.\n", fout);
-    fprintf(fout, "  end subroutine funit_test%i\n\n", *test_i);
+    emit_str(g->out, "\n    funit_passed_ = .true.\n");
+    emit_printf(g->out, "  end subroutine funit_test%i\n\n", *test_i);
 
     return 0;
 }
 
-static void generate_support(struct TestSet *set, const char *type)
+// the end of a bench, after its timed region
+static int generate_bench_end(struct CodeGen *g, struct TestBench *bench,
+                              int bench_i)
 {
-    fprintf(fout, "  subroutine funit_%s\n", type);
-    generate_code(set->setup, set->tolerance);
-    fprintf(fout, "  end subroutine funit_%s\n\n", type);
+    emit_str(g->out, "    call funit_bench_end\n\n");
+
+    if (generate_code(g, bench->after))
+        return -1;
+
+    emit_printf(g->out, "  end subroutine funit_bench%i\n\n", bench_i);
+
+    return 0;
 }
 
-static void generate_test_call(struct TestSet *set,
-                               struct TestCase *test, int *test_i,
-                               size_t max_name)
+/* The timed region of a bench comparing variants, which the runtime has
+ * take turns, batch by batch:
+ *
+ *     call funit_bench_variant(1, "-name-")
+ *     ...
+ *     do while (funit_bench_next(funit_n_, funit_v_))
+ *       select case (funit_v_)
+ *       case (1)
+ *         do funit_i_ = 1, funit_n_
+ *           -timed-
+ *         end do
+ *       ...
+ *       end select
+ *     end do
+ */
+static int generate_compare(struct CodeGen *g, struct TestBench *bench,
+                            int bench_i)
 {
-    if (test->next)
-        generate_test_call(set, test->next, test_i, max_name);
+    struct BenchVariant *var;
+    unsigned int i;
+
+    for (var = bench->variants, i = 1; var; var = var->next, i++) {
+        emit_printf(g->out, "    call funit_bench_variant(%u, \"", i);
+        emit_span(g->out, var->name, var->namelen);
+        emit_str(g->out, "\")\n");
+    }
+    emit_str(g->out, "    do while (funit_bench_next(funit_n_, funit_v_))\n");
+    emit_str(g->out, "      select case (funit_v_)\n");
+    for (var = bench->variants, i = 1; var; var = var->next, i++) {
+        emit_printf(g->out, "      case (%u)\n", i);
+        emit_str(g->out, "        do funit_i_ = 1, funit_n_\n");
+        if (generate_code(g, var->timed))
+            return -1;
+        emit_str(g->out, "        end do\n");
+    }
+    emit_str(g->out, "      end select\n");
+    emit_str(g->out, "    end do\n");
+    return generate_bench_end(g, bench, bench_i);
+}
+
+static int generate_bench(struct CodeGen *g, struct TestBench *bench,
+                          int *bench_i)
+{
+    if (bench->next && generate_bench(g, bench->next, bench_i))
+        return -1;
+
+    *bench_i += 1;
+    emit_printf(g->out, "  subroutine funit_bench%i", *bench_i);
+    if (bench->sweep) {
+        emit_str(g->out, "(");
+        emit_span(g->out, bench->sweep_name, bench->sweep_namelen);
+        emit_str(g->out, ")");
+    }
+    emit_str(g->out, "\n    implicit none\n\n");
+    if (bench->sweep) {
+        emit_str(g->out, "    integer, intent(in) :: ");
+        emit_span(g->out, bench->sweep_name, bench->sweep_namelen);
+        emit_str(g->out, "\n");
+    }
+    emit_str(g->out, "    integer(selected_int_kind(18)) :: funit_i_, "
+             "funit_n_\n");
+    if (bench->variants)
+        emit_str(g->out, "    integer :: funit_v_\n");
+    emit_str(g->out, "\n");
+
+    if (generate_code(g, bench->setup))
+        return -1;
+
+    emit_str(g->out, "\n    call funit_bench_begin(\"");
+    emit_span(g->out, bench->name, bench->namelen);
+    emit_str(g->out, "\"");
+    if (bench->sweep) {
+        emit_str(g->out, ", &\n      sweep_name=\"");
+        emit_span(g->out, bench->sweep_name, bench->sweep_namelen);
+        emit_str(g->out, "\", sweep_value=");
+        emit_span(g->out, bench->sweep_name, bench->sweep_namelen);
+    }
+    if (bench->bytes) {
+        emit_str(g->out, ", &\n      bytes=real(");
+        emit_span(g->out, bench->bytes, bench->bytes_len);
+        emit_str(g->out, ", kind(1d0))");
+    }
+    if (bench->flops) {
+        emit_str(g->out, ", &\n      flops=real(");
+        emit_span(g->out, bench->flops, bench->flops_len);
+        emit_str(g->out, ", kind(1d0))");
+    }
+    if (bench->variants)
+        emit_printf(g->out, ", &\n      variants=%u",
+                    (unsigned int)bench->n_variants);
+    emit_str(g->out, ")\n");
+    if (bench->variants)
+        return generate_compare(g, bench, *bench_i);
+    emit_str(g->out, "    do while (funit_bench_next(funit_n_))\n");
+    emit_str(g->out, "      do funit_i_ = 1, funit_n_\n");
+    if (generate_code(g, bench->timed))
+        return -1;
+    emit_str(g->out, "      end do\n");
+    emit_str(g->out, "    end do\n");
+    return generate_bench_end(g, bench, *bench_i);
+}
+
+static void generate_support(struct CodeGen *g, struct Code *code,
+                             const char *type)
+{
+    emit_printf(g->out, "  subroutine funit_%s\n", type);
+    generate_code(g, code);
+    emit_printf(g->out, "  end subroutine funit_%s\n\n", type);
+}
+
+/* A test over a table runs inline for each of its cases, with the table
+ * evaluated once.  It sees its case as the name it gives, and keeps its
+ * declarations in a block, which a failed assertion exits.  The case is
+ * taken through the whole table, which gfortran needs when that is a named
+ * constant.
+ */
+static int generate_test_case(struct CodeGen *g, struct TestCase *test,
+                              int test_i)
+{
+    char fail_exit[32];
+
+    snprintf(fail_exit, sizeof fail_exit, "exit funit_case%i", test_i);
+    g->fail_exit = fail_exit;
+
+    emit_printf(g->out, "    funit_case%i: block\n", test_i);
+    emit_str(g->out, "    associate (");
+    emit_span(g->out, test->case_name, test->case_namelen);
+    emit_str(g->out, " => funit_cases_(funit_case_))\n");
+    emit_str(g->out, "    block\n");
+    if (test->code && generate_code(g, test->code))
+        return -1;
+    emit_str(g->out, "\n    end block\n    end associate\n");
+    emit_str(g->out, "    funit_passed_ = .true.\n");
+    emit_printf(g->out, "    end block funit_case%i\n", test_i);
+
+    g->fail_exit = "return";
+    return 0;
+}
+
+static int generate_test_call(struct CodeGen *g, struct TestSet *set,
+                              struct TestCase *test, int *test_i,
+                              size_t max_name)
+{
+    if (test->next &&
+        generate_test_call(g, set, test->next, test_i, max_name))
+        return -1;
 
     *test_i += 1;
 
-    fputs("\n", fout);
+    const char *indent = "  ";
+    emit_str(g->out, "\n");
+    if (test->over) {
+        emit_str(g->out, "  associate (funit_cases_ => ");
+        emit_span(g->out, test->over, test->overlen);
+        emit_str(g->out, ")\n");
+        // the case names are as wide as the table's bounds make them
+        emit_printf(g->out, "  funit_width_ = max(%u, funit_case_width(\"",
+                    (unsigned int)max_name);
+        emit_span(g->out, test->name, test->namelen);
+        emit_str(g->out, "\", &\n       lbound(funit_cases_, 1), "
+                 "ubound(funit_cases_, 1)) + 2)\n");
+        emit_str(g->out, "  do funit_case_ = lbound(funit_cases_, 1), "
+                 "ubound(funit_cases_, 1)\n");
+        indent = "    ";
+    }
     if (set->setup)
-        fprintf(fout, "  call funit_setup\n");
-    fprintf(fout, "  call funit_test%i(funit_passed_, funit_message_)\n",
-            *test_i);
-    fputs("  call pass_fail(funit_passed_, funit_message_, \"", fout);
-    fwrite(test->name, test->namelen, 1, fout);
-    fprintf(fout, "\", %u)\n", (unsigned int)max_name);
+        emit_printf(g->out, "%scall funit_setup\n", indent);
+    if (g->perf)
+        emit_printf(g->out, "%scall funit_perf_begin\n", indent);
+    if (g->memory)
+        emit_printf(g->out, "%scall funit_memory_begin\n", indent);
+    if (test->over) {
+        if (generate_test_case(g, test, *test_i))
+            return -1;
+    } else {
+        emit_printf(g->out, "%scall funit_test%i(funit_passed_, "
+                    "funit_message_)\n", indent, *test_i);
+    }
+    emit_printf(g->out, "%scall pass_fail(funit_passed_, funit_message_, ",
+                indent);
+    if (test->over)
+        emit_str(g->out, "&\n         funit_case_name(");
+    emit_str(g->out, "\"");
+    emit_span(g->out, test->name, test->namelen);
+    if (test->over)
+        emit_str(g->out, "\", funit_case_), funit_width_)\n");
+    else
+        emit_printf(g->out, "\", %u)\n", (unsigned int)max_name);
     if (set->teardown)
-        fputs("  call funit_teardown\n\n", fout);
+        emit_printf(g->out, "%scall funit_teardown\n\n", indent);
+    if (test->over)
+        emit_str(g->out, "  end do\n  end associate\n");
+    return 0;
+}
+
+static void generate_bench_call(struct CodeGen *g, struct TestSet *set,
+                                struct TestBench *bench, int *bench_i)
+{
+    if (bench->next)
+        generate_bench_call(g, set, bench->next, bench_i);
+
+    *bench_i += 1;
+
+    // a sweep runs the whole bench, setup and all, for each value
+    struct Code *value = bench->sweep;
+    do {
+        if (set->setup)
+            emit_str(g->out, "    call funit_setup\n");
+        emit_printf(g->out, "    call funit_bench%i", *bench_i);
+        if (value) {
+            emit_str(g->out, "(");
+            emit_span(g->out, value->u.c.str, value->u.c.len);
+            emit_str(g->out, ")");
+            value = value->next;
+        }
+        emit_str(g->out, "\n");
+        if (set->teardown)
+            emit_str(g->out, "    call funit_teardown\n");
+    } while (value);
+}
+
+static void print_funit_use(struct CodeGen *g)
+{
+    emit_str(g->out, "  use funit\n");
+    if (g->arrays)
+        emit_str(g->out, "  use funit_arrays\n");
+    if (g->benches)
+        emit_str(g->out, "  use funit_benches\n");
 }
 
-static void print_use(struct TestModule *mod)
+static void print_use(struct CodeGen *g, struct TestModule *mod)
 {
     if (mod->next)
-        print_use(mod->next);
+        print_use(g, mod->next);
 
-    fputs("  use ", fout);
-    fwrite(mod->name, mod->len, 1, fout);
+    emit_str(g->out, "  use ");
+    emit_span(g->out, mod->name, mod->len);
     if (mod->elen > 0) {
-        fwrite(mod->extra, mod->elen, 1, fout);
+        emit_span(g->out, mod->extra, mod->elen);
     }
-    fputs("\n", fout);
+    emit_str(g->out, "\n");
 }
 
 static void max_name_width(struct TestCase *test, size_t *max)
 {
-    if (test->namelen > *max)
-        *max = test->namelen;
+    // a test over a table has at least "name(1)", and may widen its cases'
+    // names to fit its table when it runs
+    size_t len = test->namelen + (test->over ? 3 : 0);
+
+    if (len > *max)
+        *max = len;
     if (test->next)
         max_name_width(test->next, max);
 }
@@ -655,86 +1499,209 @@ static size_t max_test_name_width(struct TestCase *test)
     return max + 2;
 }
 
-static int generate_set(struct TestSet *set, int *set_i)
+static int has_test_cases(struct TestCase *test)
 {
-    int test_i;
+    for (; test; test = test->next) {
+        if (test->over)
+            return TRUE;
+    }
+    return FALSE;
+}
 
-    if (set->next)
-        generate_set(set->next, set_i);
+static int generate_set(struct CodeGen *g, struct TestSet *set, int *set_i)
+{
+    int test_i, bench_i;
 
+    if (set->next && generate_set(g, set->next, set_i))
+        return -1;
+
+    g->set = set;
     (*set_i)++;
-    fprintf(fout, "subroutine funit_set%i\n", *set_i);
-    fputs("  use funit\n", fout);
+    emit_printf(g->out, "subroutine funit_set%i\n", *set_i);
+    print_funit_use(g);
     
     if (set->mods)
-        print_use(set->mods);
+        print_use(g, set->mods);
     
-    fputs("\n", fout);
-    fputs("  implicit none\n\n", fout);
-    fputs("  character*1024 :: funit_message_\n", fout);
-    fputs("  logical :: funit_passed_\n\n", fout);
+    emit_str(g->out, "\n");
+    emit_str(g->out, "  implicit none\n\n");
+    emit_str(g->out, "  character*1024 :: funit_message_\n");
+    emit_str(g->out, "  logical :: funit_passed_\n");
+    if (has_test_cases(set->tests))
+        emit_str(g->out, "  integer :: funit_case_, funit_width_\n");
+    emit_str(g->out, "\n");
     
     if (set->code)
-        generate_code(set->code, set->tolerance);
+        generate_code(g, set->code);
+
+    // the set's variables are shared by its tests and benches, so its
+    // fixtures are set up once for all of them
+    if (set->setup_set)
+        emit_str(g->out, "\n  call funit_setup_set\n");
+
+    // with --bench, run just the benches
+    if (set->benches) {
+        bench_i = 0;
+        emit_str(g->out, "\n  if (funit_bench_mode) then\n");
+        generate_bench_call(g, set, set->benches, &bench_i);
+        if (set->teardown_set)
+            emit_str(g->out, "    call funit_teardown_set\n");
+        emit_str(g->out, "    return\n");
+        emit_str(g->out, "  end if\n");
+    }
 
+    if (set->parallel_asserts >= 0)
+        emit_printf(g->out, "\n  funit_parallel_min_size = %i\n",
+                    set->parallel_asserts);
     if (set->tests) {
         size_t max_name = max_test_name_width(set->tests);
         test_i = 0;
-        generate_test_call(set, set->tests, &test_i, max_name);
+        if (generate_test_call(g, set, set->tests, &test_i, max_name))
+            return -1;
     }
+    if (set->parallel_asserts >= 0)
+        emit_str(g->out, "\n  funit_parallel_min_size = "
+                 "huge(funit_parallel_min_size)\n");
+    if (set->teardown_set)
+        emit_str(g->out, "\n  call funit_teardown_set\n");
     
-    fputs("contains\n\n", fout);
+    emit_str(g->out, "contains\n\n");
     
     if (set->setup)
-        generate_support(set, "setup");
+        generate_support(g, set->setup, "setup");
     if (set->teardown)
-        generate_support(set, "teardown");
+        generate_support(g, set->teardown, "teardown");
+    if (set->setup_set)
+        generate_support(g, set->setup_set, "setup_set");
+    if (set->teardown_set)
+        generate_support(g, set->teardown_set, "teardown_set");
     if (set->tests) {
         test_i = 0;
-        if (generate_test(set->tests, &test_i, set->tolerance))
+        if (generate_test(g, set->tests, &test_i))
+            return -1;
+    }
+    if (set->benches) {
+        bench_i = 0;
+        if (generate_bench(g, set->benches, &bench_i))
             return -1;
     }
 
-    fprintf(fout, "end subroutine funit_set%i\n", *set_i);
+    emit_printf(g->out, "end subroutine funit_set%i\n", *set_i);
 
     return 0;
 }
 
-static void generate_set_call(struct TestSet *set, int *set_i)
+/* Sets without benches are skipped with --bench, which only files with
+ * benches look for.
+ */
+static void generate_set_call(struct CodeGen *g, struct TestSet *set,
+                              int *set_i, int file_has_benches)
 {
+    const char *indent = "  ";
+
     if (set->next)
-        generate_set_call(set->next, set_i);
+        generate_set_call(g, set->next, set_i, file_has_benches);
 
     (*set_i)++;
-    fputs("\n  call start_set(\"", fout);
-    fwrite(set->name, set->namelen, 1, fout);
-    fputs("\")\n", fout);
-    fprintf(fout, "  call funit_set%i\n", *set_i);
+    emit_str(g->out, "\n");
+    if (file_has_benches && !set->benches) {
+        emit_str(g->out, "  if (.not. funit_bench_mode) then\n");
+        indent = "    ";
+    }
+    emit_printf(g->out, "%scall start_set(\"", indent);
+    emit_span(g->out, set->name, set->namelen);
+    emit_str(g->out, "\")\n");
+    emit_printf(g->out, "%scall funit_set%i\n", indent, *set_i);
+    if (file_has_benches && !set->benches)
+        emit_str(g->out, "  end if\n");
+}
+
+static void generate_main(struct CodeGen *g, const struct TestFile *tf,
+                          int *set_i)
+{
+    int benches = has_benches(tf);
+    struct TestSet *file = tf->sets;
+
+    emit_str(g->out, "\n\nprogram main\n");
+    print_funit_use(g);
+    if (tf->perf)
+        emit_str(g->out, "  use funit_perf\n");
+    if (uses_memory_helper(tf))
+        emit_str(g->out, "  use funit_memory\n");
+    emit_str(g->out, "\n  call clear_stats\n");
+    if (tf->perf)
+        emit_str(g->out, "  call funit_perf_init\n");
+    if (uses_memory_helper(tf))
+        emit_str(g->out, "  call funit_memory_init\n");
+    if (benches)
+        emit_str(g->out, "  call funit_read_options\n");
+    generate_set_call(g, file, set_i, benches);
+    emit_str(g->out, "\n  call report_stats\n");
+    emit_printf(g->out, "end program main\n");
+}
+
+/* Works out which of the larger modules tf's test program uses.  Only those
+ * are emitted into it, as they take most of its compile time.
+ */
+static void choose_modules(struct CodeGen *g, const struct TestFile *tf)
+{
+    g->arrays = uses_macros(tf, MACRO_BIT(ASSERT_ARRAY_EQUAL) |
+                            MACRO_BIT(ASSERT_ARRAY_EQUAL_WITH) |
+                            MACRO_BIT(ASSERT_ARRAY_CLOSE) |
+                            MACRO_BIT(ASSERT_ARRAY_ULP));
+    g->benches = has_benches(tf) ||
+        uses_macros(tf, MACRO_BIT(ASSERT_TIME_BELOW) |
+                    MACRO_BIT(ASSERT_FASTER_THAN));
 }
 
-static void generate_main(struct TestSet *file, int *set_i)
+static void emit_modules(struct CodeGen *g, const struct TestFile *tf)
 {
-    fputs("\n\nprogram main\n", fout);
-    fputs("  use funit\n\n",  fout);
-    fputs("  call clear_stats\n", fout);
-    generate_set_call(file, set_i);
-    fputs("\n  call report_stats\n", fout);
-    fprintf(fout, "end program main\n");
+    emit_span(g->out, module_code, sizeof(module_code) - 1);
+    if (g->arrays)
+        emit_span(g->out, arrays_module_code, sizeof(arrays_module_code) - 1);
+    if (g->benches)
+        emit_span(g->out, benches_module_code,
+                  sizeof(benches_module_code) - 1);
+    if (tf->perf)
+        emit_span(g->out, perf_module_code, sizeof(perf_module_code) - 1);
+    if (uses_memory_helper(tf))
+        emit_span(g->out, memory_module_code, sizeof(memory_module_code) - 1);
 }
 
-int generate_code_file(struct TestSet *set, FILE *file_out)
+/* Emits just the funit modules tf's test program uses to out, for building
+ * once and sharing between test programs.
+ */
+void generate_modules(const struct TestFile *tf, struct Emitter *out)
+{
+    struct CodeGen gen = {out, NULL, tf->path, NULL, tf->perf, tf->memory,
+                          "return"};
+
+    choose_modules(&gen, tf);
+    emit_modules(&gen, tf);
+}
+
+/* Emits the Fortran test program for the sets in tf to out.  Problems are
+ * reported to err.  Safe to call from several threads on different files.
+ * Much of the output points into tf's template, so out must be consumed
+ * before tf is closed.  With tf->shared_modules, the program uses the funit
+ * modules without them being emitted.
+ */
+int generate_code_file(const struct TestFile *tf, struct Emitter *out,
+                       FILE *err)
 {
-    // set file-wide out file pointer
-    fout = file_out;
+    struct CodeGen gen = {out, err, tf->path, NULL, tf->perf, tf->memory,
+                          "return"};
+    struct CodeGen *g = &gen;
 
-    // XXX look for this file and emit it if not present
-    fputs(module_code, fout);
+    choose_modules(g, tf);
+    if (!tf->shared_modules)
+        emit_modules(g, tf);
 
     int set_i = 0;
-    if (generate_set(set, &set_i))
+    if (generate_set(g, tf->sets, &set_i))
         return -1;
     set_i = 0;
-    generate_main(set, &set_i);
+    generate_main(g, tf, &set_i);
 
     return 0;
 }
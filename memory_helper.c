@@ -0,0 +1,105 @@
+/* memory_helper.c - memory accounting for test programs.
+ *
+ * funit builds this into test programs that report their tests' memory use
+ * (funit --memory) or check it (assert_max_allocations), whose funit_memory
+ * module calls it through bind(C).  With glibc it counts the program's heap
+ * allocations, Fortran allocate and compiler temporaries included, by
+ * defining malloc, calloc and realloc in the program itself, in front of the
+ * C library's.  The peak memory use comes from the kernel.  Nothing here
+ * allocates, so reading the counts doesn't change them.
+ */
+#define _GNU_SOURCE
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int64_t mem_allocs, mem_bytes;
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+static void count_allocation(size_t size)
+{
+    __atomic_add_fetch(&mem_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&mem_bytes, (int64_t)size, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    count_allocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    count_allocation(n * size);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    count_allocation(size);
+    return __libc_realloc(p, size);
+}
+#endif
+
+/* Starts a new peak of memory use at the current use.  Returns -1 if the
+ * system can't.
+ */
+int funit_mem_reset_peak(void)
+{
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    int ok;
+
+    if (fd < 0)
+        return -1;
+    ok = write(fd, "5", 1) == 1;
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+// the peak resident set size in bytes, or -1 if unknown
+static int64_t peak_rss(void)
+{
+    char buf[4096];
+    int fd = open("/proc/self/status", O_RDONLY);
+    struct rusage ru;
+
+    if (fd >= 0) {
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (n > 0) {
+            buf[n] = '\0';
+            char *hwm = strstr(buf, "VmHWM:");
+            if (hwm)
+                return strtoll(hwm + 6, NULL, 10) * 1024; // in kB
+        }
+    }
+    if (getrusage(RUSAGE_SELF, &ru) == 0) // can't be reset
+        return (int64_t)ru.ru_maxrss * 1024;
+    return -1;
+}
+
+/* Puts the peak memory use in bytes, first starting a new peak if
+ * reset_peak, and the number of allocations and bytes allocated so far in
+ * counts; -1 for what can't be had.
+ */
+void funit_mem_counts(int64_t *counts, int reset_peak)
+{
+    if (reset_peak)
+        funit_mem_reset_peak();
+    counts[0] = peak_rss();
+#ifdef __GLIBC__
+    counts[1] = __atomic_load_n(&mem_allocs, __ATOMIC_RELAXED);
+    counts[2] = __atomic_load_n(&mem_bytes, __ATOMIC_RELAXED);
+#else
+    counts[1] = counts[2] = -1;
+#endif
+}
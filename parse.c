@@ -23,27 +23,27 @@ void parse_fail(struct ParseState *ps, const char *col, const char *message)
 
     // file:line:
     assert(ps->path != NULL);
-    fprintf(stderr, "%s:%li:\n\n", ps->path, ps->lineno);
+    fprintf(ps->err, "%s:%li:\n\n", ps->path, ps->lineno);
     // code
-    fwrite(ps->line_pos, ps->next_line_pos - ps->line_pos, 1, stderr);
-    fputs("\n", stderr);
+    fwrite(ps->line_pos, ps->next_line_pos - ps->line_pos, 1, ps->err);
+    fputs("\n", ps->err);
     // column indicator
     if (col) {
         int n = col - ps->line_pos;
         int spaces = n > 2 ? n - 2 : n;
         while (spaces > 0) {
-            fputs(" ", stderr);
+            fputs(" ", ps->err);
             spaces--;
         }
         if (n > 2)
-            fputs("--", stderr);
-        fputs("^", stderr);
+            fputs("--", ps->err);
+        fputs("^", ps->err);
         if (n <= 2)
-            fputs("--", stderr);
-        fputs("\n", stderr);
+            fputs("--", ps->err);
+        fputs("\n", ps->err);
     }
     // error message
-    fprintf(stderr, "Error: %s\n", message);
+    fprintf(ps->err, "Error: %s\n", message);
 }
 
 void parse_vfail(struct ParseState *ps, const char *col, const char *format, ...)
@@ -159,7 +159,8 @@ char *next_thing(struct ParseState *ps, size_t *len, end_finder_fun end_fun)
 }
 
 /* Opens and mmap()s a file for parsing.  Returns a ParseState struct to keep
- * track of this open file.
+ * track of this open file.  The caller sets ps->err to the stream errors
+ * should be reported to.
  */
 int open_file_for_parsing(const char *path, struct ParseState *ps)
 {
@@ -167,20 +168,20 @@ int open_file_for_parsing(const char *path, struct ParseState *ps)
 
     ps->fd = open(path, O_RDONLY);
     if (ps->fd == -1) {
-        fprintf(stderr, "Opening file %s: %s\n", path, strerror(errno));
+        fprintf(ps->err, "Opening file %s: %s\n", path, strerror(errno));
         return -1;
     }
     ps->path = path;
 
     if (fstat(ps->fd, &statbuf)) {
-        fprintf(stderr, "Stat file %s: %s\n", path, strerror(errno));
+        fprintf(ps->err, "Stat file %s: %s\n", path, strerror(errno));
         goto close_it;
     }
     if (statbuf.st_size < 1) {
-        fprintf(stderr, "File %s is empty!\n", path);
+        fprintf(ps->err, "File %s is empty!\n", path);
         goto close_it;
     } else if (statbuf.st_size > MAX_PARSE_SIZE) {
-        fprintf(stderr, "File %s is too big (> %lu bytes)!\n", path,
+        fprintf(ps->err, "File %s is too big (> %lu bytes)!\n", path,
                 (unsigned long)MAX_PARSE_SIZE);
         goto close_it;
     }
@@ -189,7 +190,7 @@ int open_file_for_parsing(const char *path, struct ParseState *ps)
     ps->file_buf = (char *)mmap(NULL, ps->bufsize, PROT_READ, MAP_SHARED,
                                 ps->fd, 0);
     if (!ps->file_buf) {
-        fprintf(stderr, "Mapping file %s: %s\n", path, strerror(errno));
+        fprintf(ps->err, "Mapping file %s: %s\n", path, strerror(errno));
         goto close_it;
     }
 
@@ -212,7 +213,7 @@ void close_parse_file(struct ParseState *ps)
         if (!munmap(ps->file_buf, ps->bufsize)) {
             ps->file_buf = NULL;
         } else {
-            fprintf(stderr, "Unmapping file %s: %s\n", ps->path,
+            fprintf(ps->err, "Unmapping file %s: %s\n", ps->path,
                     strerror(errno));
             abort();
         }
@@ -221,7 +222,7 @@ void close_parse_file(struct ParseState *ps)
     if (ps->fd && !close(ps->fd)) {
         ps->fd = 0;
     } else {
-        fprintf(stderr, "Closing file %s: %s\n", ps->path, strerror(errno));
+        fprintf(ps->err, "Closing file %s: %s\n", ps->path, strerror(errno));
         abort();
     }
 }
@@ -0,0 +1,460 @@
+/* parse_cache.c - on-disk binary images of parsed test files.
+ *
+ * Parsing a .fun file produces a tree of TestSets, TestCases and Code
+ * fragments whose strings all point into the mmap()ed template.  The tree is
+ * saved as a flat, native-endian record stream where every string is stored
+ * as an (offset, length) span into the template text, so a later run only
+ * has to mmap() the template and the image and re-link the tree -- no
+ * tokenizing or macro scanning.
+ *
+ * Images live in the configured cache directory, named after the hash of the
+ * template's content.  The header repeats the hash and size and records the
+ * cache format version, so a stale or foreign image is simply re-parsed and
+ * overwritten.
+ */
+#include "funit.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+#define CACHE_MAGIC "FUNITPC"
+#define CACHE_BYTE_ORDER 0x01020304u
+#define NO_SPAN 0xFFFFFFFFu
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t hash;
+    uint64_t size;
+};
+
+struct CacheReader {
+    const unsigned char *pos, *end;
+    char *text;       // the mapped template the spans point into
+    size_t text_len;
+    int bad;
+};
+
+// --- writing
+
+static void put_u32(struct StringBuffer *sb, uint32_t u)
+{
+    sb_add_nstr(sb, (const char *)&u, sizeof(u));
+}
+
+static void put_f64(struct StringBuffer *sb, double d)
+{
+    sb_add_nstr(sb, (const char *)&d, sizeof(d));
+}
+
+static void put_span(struct StringBuffer *sb, const struct ParseState *ps,
+                     const char *s, size_t len)
+{
+    if (!s) {
+        put_u32(sb, NO_SPAN);
+        put_u32(sb, 0);
+        return;
+    }
+    assert(s >= ps->file_buf && s + len <= ps->file_end);
+    put_u32(sb, (uint32_t)(s - ps->file_buf));
+    put_u32(sb, (uint32_t)len);
+}
+
+static void put_code(struct StringBuffer *sb, const struct ParseState *ps,
+                     struct Code *code)
+{
+    uint32_t n = 0;
+    for (struct Code *c = code; c; c = c->next)
+        n++;
+    put_u32(sb, n);
+
+    for (; code; code = code->next) {
+        put_u32(sb, code->type);
+        put_u32(sb, (uint32_t)code->lineno);
+        if (code->type == MACRO_CODE) {
+            put_u32(sb, code->u.m.type);
+            put_code(sb, ps, code->u.m.args);
+        } else {
+            put_span(sb, ps, code->u.c.str, code->u.c.len);
+        }
+    }
+}
+
+static void put_set(struct StringBuffer *sb, const struct ParseState *ps,
+                    struct TestSet *set)
+{
+    put_span(sb, ps, set->name, set->namelen);
+    put_f64(sb, set->tolerance);
+    put_u32(sb, (uint32_t)set->exact_compare);
+    put_u32(sb, (uint32_t)set->mismatch_stats);
+    put_u32(sb, (uint32_t)set->parallel_asserts);
+    put_u32(sb, (uint32_t)set->threads);
+    put_f64(sb, set->memory);
+
+    put_u32(sb, (uint32_t)set->n_deps);
+    for (struct TestDependency *dep = set->deps; dep; dep = dep->next)
+        put_span(sb, ps, dep->filename, dep->len);
+
+    put_u32(sb, (uint32_t)set->n_mods);
+    for (struct TestModule *mod = set->mods; mod; mod = mod->next) {
+        put_span(sb, ps, mod->name, mod->len);
+        put_span(sb, ps, mod->extra, mod->elen);
+    }
+
+    put_code(sb, ps, set->setup);
+    put_code(sb, ps, set->teardown);
+    put_code(sb, ps, set->setup_set);
+    put_code(sb, ps, set->teardown_set);
+    put_code(sb, ps, set->code);
+
+    put_u32(sb, (uint32_t)set->n_tests);
+    for (struct TestCase *test = set->tests; test; test = test->next) {
+        put_span(sb, ps, test->name, test->namelen);
+        put_span(sb, ps, test->case_name, test->case_namelen);
+        put_span(sb, ps, test->over, test->overlen);
+        put_u32(sb, test->need_array_iterator);
+        put_code(sb, ps, test->code);
+    }
+
+    put_u32(sb, (uint32_t)set->n_benches);
+    for (struct TestBench *bench = set->benches; bench; bench = bench->next) {
+        put_span(sb, ps, bench->name, bench->namelen);
+        put_span(sb, ps, bench->bytes, bench->bytes_len);
+        put_span(sb, ps, bench->flops, bench->flops_len);
+        put_span(sb, ps, bench->sweep_name, bench->sweep_namelen);
+        put_code(sb, ps, bench->sweep);
+        put_code(sb, ps, bench->setup);
+        put_code(sb, ps, bench->timed);
+        put_code(sb, ps, bench->after);
+        put_u32(sb, (uint32_t)bench->n_variants);
+        for (struct BenchVariant *var = bench->variants; var;
+             var = var->next) {
+            put_span(sb, ps, var->name, var->namelen);
+            put_code(sb, ps, var->timed);
+        }
+    }
+}
+
+// --- reading
+
+static uint32_t get_u32(struct CacheReader *cr)
+{
+    uint32_t u = 0;
+    if ((size_t)(cr->end - cr->pos) < sizeof(u)) {
+        cr->bad = TRUE;
+        return 0;
+    }
+    memcpy(&u, cr->pos, sizeof(u));
+    cr->pos += sizeof(u);
+    return u;
+}
+
+static double get_f64(struct CacheReader *cr)
+{
+    double d = 0.0;
+    if ((size_t)(cr->end - cr->pos) < sizeof(d)) {
+        cr->bad = TRUE;
+        return 0.0;
+    }
+    memcpy(&d, cr->pos, sizeof(d));
+    cr->pos += sizeof(d);
+    return d;
+}
+
+static char *get_span(struct CacheReader *cr, size_t *len)
+{
+    uint32_t off = get_u32(cr), n = get_u32(cr);
+
+    *len = n;
+    if (off == NO_SPAN)
+        return NULL;
+    if ((size_t)off + n > cr->text_len) {
+        cr->bad = TRUE;
+        return NULL;
+    }
+    return cr->text + off;
+}
+
+/* Reads back a Code list written by put_code().  Returns NULL for an empty
+ * list or on error (cr->bad is set in that case).
+ */
+static struct Code *get_code(struct CacheReader *cr)
+{
+    struct Code *head = NULL, **tail = &head;
+    uint32_t n = get_u32(cr);
+
+    while (n-- > 0 && !cr->bad) {
+        struct Code *code = NEW0(struct Code);
+        *tail = code;
+        tail = &code->next;
+
+        code->type = (enum CodeType)get_u32(cr);
+        code->lineno = get_u32(cr);
+        switch (code->type) {
+        case MACRO_CODE:
+            code->u.m.type = (enum MacroType)get_u32(cr);
+            code->u.m.args = get_code(cr);
+            break;
+        case FORTRAN_CODE:
+        case ARG_CODE:
+            code->u.c.str = get_span(cr, &code->u.c.len);
+            break;
+        default:
+            cr->bad = TRUE;
+            break;
+        }
+    }
+    return head;
+}
+
+static struct TestSet *get_set(struct CacheReader *cr)
+{
+    struct TestSet *set = NEW0(struct TestSet);
+    uint32_t i, n;
+
+    set->name = get_span(cr, &set->namelen);
+    set->tolerance = get_f64(cr);
+    set->exact_compare = (enum ExactCompare)get_u32(cr);
+    set->mismatch_stats = (int32_t)get_u32(cr);
+    set->parallel_asserts = (int32_t)get_u32(cr);
+    set->threads = (int32_t)get_u32(cr);
+    set->memory = get_f64(cr);
+
+    struct TestDependency **dep_tail = &set->deps;
+    n = get_u32(cr);
+    for (i = 0; i < n && !cr->bad; i++) {
+        struct TestDependency *dep = NEW0(struct TestDependency);
+        dep->filename = get_span(cr, &dep->len);
+        *dep_tail = dep;
+        dep_tail = &dep->next;
+        set->n_deps++;
+    }
+
+    struct TestModule **mod_tail = &set->mods;
+    n = get_u32(cr);
+    for (i = 0; i < n && !cr->bad; i++) {
+        struct TestModule *mod = NEW0(struct TestModule);
+        mod->name = get_span(cr, &mod->len);
+        mod->extra = get_span(cr, &mod->elen);
+        *mod_tail = mod;
+        mod_tail = &mod->next;
+        set->n_mods++;
+    }
+
+    set->setup = get_code(cr);
+    set->teardown = get_code(cr);
+    set->setup_set = get_code(cr);
+    set->teardown_set = get_code(cr);
+    set->code = get_code(cr);
+
+    struct TestCase **test_tail = &set->tests;
+    n = get_u32(cr);
+    for (i = 0; i < n && !cr->bad; i++) {
+        struct TestCase *test = NEW0(struct TestCase);
+        test->name = get_span(cr, &test->namelen);
+        test->case_name = get_span(cr, &test->case_namelen);
+        test->over = get_span(cr, &test->overlen);
+        test->need_array_iterator = get_u32(cr);
+        test->code = get_code(cr);
+        *test_tail = test;
+        test_tail = &test->next;
+        set->n_tests++;
+    }
+
+    struct TestBench **bench_tail = &set->benches;
+    n = get_u32(cr);
+    for (i = 0; i < n && !cr->bad; i++) {
+        struct TestBench *bench = NEW0(struct TestBench);
+        bench->name = get_span(cr, &bench->namelen);
+        bench->bytes = get_span(cr, &bench->bytes_len);
+        bench->flops = get_span(cr, &bench->flops_len);
+        bench->sweep_name = get_span(cr, &bench->sweep_namelen);
+        bench->sweep = get_code(cr);
+        bench->setup = get_code(cr);
+        bench->timed = get_code(cr);
+        bench->after = get_code(cr);
+        struct BenchVariant **var_tail = &bench->variants;
+        uint32_t j, n_variants = get_u32(cr);
+        for (j = 0; j < n_variants && !cr->bad; j++) {
+            struct BenchVariant *var = NEW0(struct BenchVariant);
+            var->name = get_span(cr, &var->namelen);
+            var->timed = get_code(cr);
+            *var_tail = var;
+            var_tail = &var->next;
+            bench->n_variants++;
+        }
+        *bench_tail = bench;
+        bench_tail = &bench->next;
+        set->n_benches++;
+    }
+
+    return set;
+}
+
+// ---
+
+static void cache_file_name(char *buf, const char *cache_dir, uint64_t hash)
+{
+    snprintf(buf, PATH_MAX, "%s/%016llx.fpc", cache_dir,
+             (unsigned long long)hash);
+}
+
+/* Maps the cached image at cache_path and rebuilds the set list of tf from
+ * it.  Returns 0 on success, or -1 if there is no usable image.
+ */
+static int load_cache(struct TestFile *tf, const char *cache_path,
+                      uint64_t hash)
+{
+    struct CacheReader cr;
+    struct CacheHeader hdr;
+    struct stat statbuf;
+    void *image;
+    int fd;
+
+    fd = open(cache_path, O_RDONLY);
+    if (fd == -1)
+        return -1; // not cached yet
+    if (fstat(fd, &statbuf) || statbuf.st_size < (off_t)sizeof(hdr)) {
+        close(fd);
+        return -1;
+    }
+    image = mmap(NULL, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+        return -1;
+
+    memcpy(&hdr, image, sizeof(hdr));
+    if (memcmp(hdr.magic, CACHE_MAGIC, sizeof(hdr.magic)) ||
+        hdr.byte_order != CACHE_BYTE_ORDER ||
+        hdr.version != FUNIT_CACHE_VERSION ||
+        hdr.hash != hash || hdr.size != tf->ps.bufsize) {
+        munmap(image, statbuf.st_size);
+        return -1;
+    }
+
+    cr.pos = (const unsigned char *)image + sizeof(hdr);
+    cr.end = (const unsigned char *)image + statbuf.st_size;
+    cr.text = tf->ps.file_buf;
+    cr.text_len = tf->ps.bufsize;
+    cr.bad = FALSE;
+
+    struct TestSet **set_tail = &tf->sets;
+    uint32_t n = get_u32(&cr);
+    while (n-- > 0 && !cr.bad) {
+        struct TestSet *set = get_set(&cr);
+        *set_tail = set;
+        set_tail = &set->next;
+    }
+
+    munmap(image, statbuf.st_size);
+
+    if (cr.bad || !tf->sets) {
+        fprintf(tf->ps.err, "FUnit: ignoring corrupt parse cache %s\n",
+                cache_path);
+        discard_test_sets(tf);
+        return -1;
+    }
+    return 0;
+}
+
+/* Writes the image of tf's sets atomically: the image is written to a
+ * temporary file in the cache directory and then renamed into place, so
+ * concurrent runs never see a partial image.  Failing to save is not fatal.
+ */
+static void save_cache(struct TestFile *tf, const char *cache_dir,
+                       const char *cache_path, uint64_t hash)
+{
+    char tmp_path[PATH_MAX + 1];
+    struct StringBuffer sb;
+    struct CacheHeader hdr;
+    uint32_t n_sets = 0;
+    int fd;
+
+    if (mkdir(cache_dir, 0777) && errno != EEXIST) {
+        fprintf(tf->ps.err, "FUnit: could not create cache directory %s: %s\n",
+                cache_dir, strerror(errno));
+        return;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    hdr.byte_order = CACHE_BYTE_ORDER;
+    hdr.version = FUNIT_CACHE_VERSION;
+    hdr.hash = hash;
+    hdr.size = tf->ps.bufsize;
+
+    sb_init(&sb, 4096);
+    sb_add_nstr(&sb, (const char *)&hdr, sizeof(hdr));
+    for (struct TestSet *set = tf->sets; set; set = set->next)
+        n_sets++;
+    put_u32(&sb, n_sets);
+    for (struct TestSet *set = tf->sets; set; set = set->next)
+        put_set(&sb, &tf->ps, set);
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", cache_path);
+    fd = mkstemp(tmp_path);
+    if (fd == -1) {
+        fprintf(tf->ps.err, "FUnit: could not create %s: %s\n", tmp_path,
+                strerror(errno));
+        goto done;
+    }
+    if (fu_write_all(fd, sb.s, sb.len) || close(fd)) {
+        fprintf(tf->ps.err, "FUnit: error writing %s: %s\n", tmp_path,
+                strerror(errno));
+        unlink(tmp_path);
+        goto done;
+    }
+    if (rename(tmp_path, cache_path)) {
+        fprintf(tf->ps.err, "FUnit: could not rename %s to %s: %s\n", tmp_path,
+                cache_path, strerror(errno));
+        unlink(tmp_path);
+    }
+ done:
+    sb_free(&sb);
+}
+
+/* Like parse_test_file(), but first looks for a binary image of the parsed
+ * file in cache_dir and only parses the template if there is none (saving
+ * one for next time).  With a NULL cache_dir this is just parse_test_file().
+ */
+struct TestFile *parse_test_file_cached(const char *path,
+                                        const char *cache_dir, FILE *err)
+{
+    char cache_path[PATH_MAX + 1];
+    struct TestFile *tf;
+    uint64_t hash;
+
+    if (!cache_dir)
+        return parse_test_file(path, err);
+
+    tf = NEW0(struct TestFile);
+    tf->path = fu_strdup(path);
+    tf->ps.err = err;
+    if (open_file_for_parsing(tf->path, &tf->ps) != 0) {
+        free((void *)tf->path);
+        free(tf);
+        return NULL;
+    }
+
+    hash = fu_hash(tf->ps.file_buf, tf->ps.bufsize);
+    cache_file_name(cache_path, cache_dir, hash);
+
+    if (!load_cache(tf, cache_path, hash))
+        return tf;
+
+    if (parse_opened_test_file(tf)) {
+        close_testfile(tf);
+        return NULL;
+    }
+    save_cache(tf, cache_dir, cache_path, hash);
+
+    return tf;
+}
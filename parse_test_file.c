@@ -15,6 +15,10 @@
       teardown
         ! fortran code to run after each test case
       end teardown
+
+      setup_set
+        ! fortran code to run once before all the test cases
+      end setup_set
     
       test name1
         ...
@@ -33,6 +37,7 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <string.h>
 #include <strings.h>
@@ -59,6 +64,28 @@ static void free_cases(struct TestCase *test)
     free(test);
 }
 
+static void free_benches(struct TestBench *bench)
+{
+    if (bench->next)
+        free_benches(bench->next);
+    if (bench->sweep)
+        free_code(bench->sweep);
+    if (bench->setup)
+        free_code(bench->setup);
+    if (bench->timed)
+        free_code(bench->timed);
+    if (bench->after)
+        free_code(bench->after);
+    while (bench->variants) {
+        struct BenchVariant *next = bench->variants->next;
+        if (bench->variants->timed)
+            free_code(bench->variants->timed);
+        free(bench->variants);
+        bench->variants = next;
+    }
+    free(bench);
+}
+
 static void free_deps(struct TestDependency *deps)
 {
     if (deps->next)
@@ -66,23 +93,47 @@ static void free_deps(struct TestDependency *deps)
     free(deps);
 }
 
+static void free_mods(struct TestModule *mods)
+{
+    if (mods->next)
+        free_mods(mods->next);
+    free(mods);
+}
+
 static void free_sets(struct TestSet *set)
 {
     if (set->next)
         free_sets(set->next);
     if (set->deps)
         free_deps(set->deps);
+    if (set->mods)
+        free_mods(set->mods);
     if (set->setup)
         free_code(set->setup);
     if (set->teardown)
         free_code(set->teardown);
+    if (set->setup_set)
+        free_code(set->setup_set);
+    if (set->teardown_set)
+        free_code(set->teardown_set);
     if (set->tests)
         free_cases(set->tests);
+    if (set->benches)
+        free_benches(set->benches);
     if (set->code)
         free_code(set->code);
     free(set);
 }
 
+/* Frees just the parsed sets of tf, leaving the file open for parsing.
+ */
+void discard_test_sets(struct TestFile *tf)
+{
+    if (tf->sets)
+        free_sets(tf->sets);
+    tf->sets = NULL;
+}
+
 /* Call when done with the test file and all data structures associated
  * with it.  Frees the TestSet list returned by parse_test_file().
  */
@@ -408,6 +459,14 @@ find_macro(struct ParseState *ps, enum MacroType *type, int *need_array_it)
                 *need_array_it = 1;
                 ps->next_pos = s + 5;
                 *type = ASSERT_ARRAY_EQUAL;
+            } else if (rest_len > 5 && !strncasecmp(s, "close", 5)) {
+                *need_array_it = 1;
+                ps->next_pos = s + 5;
+                *type = ASSERT_ARRAY_CLOSE;
+            } else if (rest_len > 3 && !strncasecmp(s, "ulp", 3)) {
+                *need_array_it = 1;
+                ps->next_pos = s + 3;
+                *type = ASSERT_ARRAY_ULP;
             } else {
                 assert_pos = NULL; // not an assert macro
             }
@@ -426,6 +485,22 @@ find_macro(struct ParseState *ps, enum MacroType *type, int *need_array_it)
         } else if (rest_len >  9 && !strncasecmp(s, "not_equal",   9)) {
             ps->next_pos = s + 9;
             *type = ASSERT_NOT_EQUAL;
+        } else if (rest_len >  5 && !strncasecmp(s, "close",       5)) {
+            ps->next_pos = s + 5;
+            *type = ASSERT_CLOSE;
+        } else if (rest_len >  3 && !strncasecmp(s, "ulp",         3)) {
+            ps->next_pos = s + 3;
+            *type = ASSERT_ULP;
+        } else if (rest_len > 10 && !strncasecmp(s, "time_below", 10)) {
+            ps->next_pos = s + 10;
+            *type = ASSERT_TIME_BELOW;
+        } else if (rest_len > 11 && !strncasecmp(s, "faster_than", 11)) {
+            ps->next_pos = s + 11;
+            *type = ASSERT_FASTER_THAN;
+        } else if (rest_len > 15 &&
+                   !strncasecmp(s, "max_allocations", 15)) {
+            ps->next_pos = s + 15;
+            *type = ASSERT_MAX_ALLOCATIONS;
         } else {
             assert_pos = NULL; // not an assert macro
         }
@@ -482,6 +557,8 @@ static int is_test_token(char *tok, size_t len)
             (same_token(tok, len, "test",        4) ||
              same_token(tok, len, "setup",       5) ||
              same_token(tok, len, "teardown",    8) ||
+             same_token(tok, len, "setup_set",   9) ||
+             same_token(tok, len, "teardown_set", 12) ||
              same_token(tok, len, "dep",         3) ||
              // XXX add 'use'?
              same_token(tok, len, "tolerance",   9)));
@@ -499,11 +576,70 @@ static int next_is_test_end_token(struct ParseState *ps)
 
     return (tok != END_OF_LINE &&
             (same_token(tok, len, "test",        4) ||
+             same_token(tok, len, "bench",       5) ||
+             same_token(tok, len, "timed",       5) ||
+             same_token(tok, len, "compare",     7) ||
              same_token(tok, len, "setup",       5) ||
              same_token(tok, len, "teardown",    8) ||
+             same_token(tok, len, "setup_set",   9) ||
+             same_token(tok, len, "teardown_set", 12) ||
              same_token(tok, len, "set", 3)));
 }
 
+/* A "timed" or "compare" line starts the timed part of a bench.  It must be
+ * alone on its line, which no Fortran statement could be.
+ */
+static int next_is_eol(struct ParseState *ps)
+{
+    char *tok = next_token(ps, NULL);
+    assert(tok != NULL);
+    return tok == END_OF_LINE;
+}
+
+/* "threads" and "memory" are common variable names, so they only declare
+ * what a set needs when a number follows, which no Fortran statement could.
+ */
+static int next_is_number(struct ParseState *ps)
+{
+    size_t len;
+    char *tok = next_token(ps, &len);
+    assert(tok != NULL);
+    return tok != END_OF_LINE && isdigit((unsigned char)*tok);
+}
+
+/* "mismatch_stats" and "parallel_asserts" could be variables too, so they
+ * only end the Fortran alone on their line or before a number.
+ */
+static int next_is_eol_or_number(struct ParseState *ps)
+{
+    size_t len;
+    char *tok = next_token(ps, &len);
+    assert(tok != NULL);
+    return tok == END_OF_LINE || isdigit((unsigned char)*tok);
+}
+
+/* Likewise "exact_compare" only ends the Fortran before one of its modes.
+ */
+static int next_is_compare_mode(struct ParseState *ps)
+{
+    size_t len;
+    char *tok = next_token(ps, &len);
+    assert(tok != NULL);
+    return (same_token("value", 5, tok, len) ||
+            same_token("nan_equal", 9, tok, len) ||
+            same_token("bitwise", 7, tok, len));
+}
+
+/* "bench" is also a common variable name, so it only starts a bench when
+ * a name follows that isn't the "=" or "(" of an assignment to it.
+ */
+static int next_is_bench_name(struct ParseState *ps)
+{
+    char *tok = next_token(ps, NULL);
+    assert(tok != NULL);
+    return tok != END_OF_LINE && *tok != '=' && *tok != '(';
+}
+
 static struct Code *parse_fortran(struct ParseState *ps, int *need_array_it)
 {
     struct Code *code = NEW0(struct Code);
@@ -521,6 +657,16 @@ static struct Code *parse_fortran(struct ParseState *ps, int *need_array_it)
         tok = next_token(ps, &len);
         assert(tok != NULL);
         if (is_test_token(tok, len) ||
+            ((same_token("timed", 5, tok, len) ||
+              same_token("compare", 7, tok, len)) && next_is_eol(ps)) ||
+            ((same_token("threads", 7, tok, len) ||
+              same_token("memory", 6, tok, len)) && next_is_number(ps)) ||
+            ((same_token("mismatch_stats", 14, tok, len) ||
+              same_token("parallel_asserts", 16, tok, len)) &&
+             next_is_eol_or_number(ps)) ||
+            (same_token("exact_compare", 13, tok, len) &&
+             next_is_compare_mode(ps)) ||
+            (same_token("bench", 5, tok, len) && next_is_bench_name(ps)) ||
             (same_token("end", 3, tok, len) && next_is_test_end_token(ps))) {
             break;
         } else if (ps->read_pos == ps->file_end) {
@@ -694,6 +840,139 @@ static struct Code *parse_support(struct ParseState *ps, const char *kind)
     return NULL;
 }
 
+/* Splits a test name like "name(c) over table" into the name, the name
+ * of its case and the table of cases, a rank one array.  Returns 0 on
+ * success, or -1 after reporting an error.
+ */
+static int parse_test_cases(struct ParseState *ps, struct TestCase *test)
+{
+    char *paren = memchr(test->name, '(', test->namelen), *s;
+    char *end = test->name + test->namelen;
+
+    if (!paren)
+        return 0;
+    test->namelen = paren - test->name;
+    while (test->namelen > 0 &&
+           isblank((unsigned char)test->name[test->namelen - 1]))
+        test->namelen--;
+    s = paren + 1;
+    while (s < end && isblank((unsigned char)*s))
+        s++;
+    test->case_name = s;
+    while (s < end && (isalnum((unsigned char)*s) || *s == '_'))
+        s++;
+    test->case_namelen = s - test->case_name;
+    while (s < end && isblank((unsigned char)*s))
+        s++;
+    if (test->namelen == 0 || test->case_namelen == 0 || s == end ||
+        *s != ')') {
+        parse_fail(ps, s, "expected \"test name(case) over table\"");
+        return -1;
+    }
+    s++;
+    while (s < end && isblank((unsigned char)*s))
+        s++;
+    if (end - s < 4 || strncasecmp(s, "over", 4) ||
+        (end - s > 4 && !isspace((unsigned char)s[4]))) {
+        parse_fail(ps, s, "expected \"over\" and the table of cases");
+        return -1;
+    }
+    s += 4;
+    while (s < end && isblank((unsigned char)*s))
+        s++;
+    while (end > s && isspace((unsigned char)end[-1]))
+        end--;
+    if (s == end) {
+        parse_fail(ps, s, "expected the table of cases");
+        return -1;
+    }
+    test->over = s;
+    test->overlen = end - s;
+    return 0;
+}
+
+static int is_name_char(char c)
+{
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+/* Finds a return statement in Fortran code, skipping strings and comments,
+ * or returns NULL.  A statement is taken to start a line, or follow a ";",
+ * a label, or the condition of an if.
+ */
+static char *find_return(char *s, size_t len)
+{
+    char *end = s + len, *p, quote = 0;
+    int at_statement = TRUE;
+
+    for (; s < end; s++) {
+        if (quote) {
+            if (*s == quote || *s == '\n')
+                quote = 0;
+            continue;
+        }
+        if (*s == '!') {
+            while (s < end && *s != '\n')
+                s++;
+            at_statement = TRUE;
+        } else if (*s == '\n' || *s == ';' || *s == ')') {
+            at_statement = TRUE;
+        } else if (*s == '\'' || *s == '"') {
+            quote = *s;
+            at_statement = FALSE;
+        } else if (is_name_char(*s)) {
+            for (p = s; p < end && is_name_char(*p); p++)
+                ;
+            if (at_statement && p - s == 6 && !strncasecmp(s, "return", 6)) {
+                while (p < end && isblank((unsigned char)*p))
+                    p++;
+                if (p == end || (*p != '=' && *p != '(' && *p != '%'))
+                    return s;
+            }
+            // a label leaves the statement still to come
+            while (s < p && isdigit((unsigned char)*s))
+                s++;
+            at_statement = at_statement && s == p;
+            s = p - 1;
+        } else if (!isblank((unsigned char)*s) && *s != '\r') {
+            at_statement = FALSE;
+        }
+    }
+    return NULL;
+}
+
+/* A test over a table runs inline in its set's subroutine, where a return
+ * would skip the rest of the set, so it is reported as an error on its own
+ * line.  Returns 0 if the code has none, or -1.
+ */
+static int check_no_return(struct ParseState *ps, struct Code *code)
+{
+    struct ParseState at;
+    char *ret = NULL, *s;
+
+    for (; code && !ret; code = code->next) {
+        if (code->type == FORTRAN_CODE)
+            ret = find_return(code->u.c.str, code->u.c.len);
+    }
+    if (!ret)
+        return 0;
+
+    at = *ps;
+    at.lineno = 1;
+    at.line_pos = ps->file_buf;
+    for (s = ps->file_buf; s < ret; s++) {
+        if (*s == '\n') {
+            at.lineno++;
+            at.line_pos = s + 1;
+        }
+    }
+    at.next_line_pos = memchr(ret, '\n', ps->file_end - ret);
+    if (!at.next_line_pos)
+        at.next_line_pos = ps->file_end;
+    parse_fail(&at, ret, "return not allowed in a test over a table");
+    return -1;
+}
+
 static struct TestCase *parse_test_case(struct ParseState *ps)
 {
     struct TestCase *test = NEW0(struct TestCase);
@@ -705,6 +984,8 @@ static struct TestCase *parse_test_case(struct ParseState *ps)
         parse_fail(ps, ps->read_pos, "double quotes (\") not allowed in test names");
         goto err;
     }
+    if (parse_test_cases(ps, test))
+        goto err;
 
     if (expect_eol(ps))
         goto err;
@@ -713,6 +994,8 @@ static struct TestCase *parse_test_case(struct ParseState *ps)
     test->code = parse_fortran(ps, &test->need_array_iterator);
     if (!test->code)
         goto err;
+    if (test->over && check_no_return(ps, test->code))
+        goto err;
 
     if (parse_end_sequence(ps, "test", test->name, test->namelen))
         goto err;
@@ -723,6 +1006,257 @@ static struct TestCase *parse_test_case(struct ParseState *ps)
     return NULL;
 }
 
+/* Reads the expression after a bench's "bytes" or "flops" into *expr.
+ * Returns FALSE, leaving the line to be parsed as Fortran, if the keyword
+ * is really a variable being assigned to; otherwise returns TRUE, with *expr
+ * NULL if there was an error.
+ */
+static int parse_bench_work(struct ParseState *ps, const char *kind,
+                            char **expr, size_t *len)
+{
+    char *s = skip_next_ws(ps);
+
+    if (s < ps->next_line_pos && *s == '=')
+        return FALSE;
+    if (*expr) {
+        parse_vfail(ps, ps->read_pos, "more than one %s given", kind);
+        *expr = NULL;
+        return TRUE;
+    }
+    *expr = next_name(ps, len);
+    if (*expr == END_OF_LINE) {
+        parse_vfail(ps, ps->read_pos, "expected an expression after %s",
+                    kind);
+        *expr = NULL;
+        return TRUE;
+    }
+    // drop the spaces before a comment
+    while (*len > 0 && isblank((unsigned char)(*expr)[*len - 1]))
+        (*len)--;
+    if (expect_eol(ps))
+        *expr = NULL;
+    return TRUE;
+}
+
+/* Reads "NAME = VALUE, VALUE..." after a bench's "sweep".  Returns FALSE,
+ * leaving the line to be parsed as Fortran, if "sweep" is really a variable
+ * being assigned to; otherwise returns TRUE, with bench->sweep NULL if there
+ * was an error.
+ */
+static int parse_sweep(struct ParseState *ps, struct TestBench *bench)
+{
+    struct Code **tail = &bench->sweep;
+    char *s = skip_next_ws(ps), *value;
+    int depth = 0;
+
+    if (s < ps->next_line_pos && *s == '=')
+        return FALSE;
+    if (bench->sweep) {
+        parse_fail(ps, s, "more than one sweep given");
+        goto err;
+    }
+
+    bench->sweep_name = s;
+    while (s < ps->next_line_pos && (isalnum((unsigned char)*s) || *s == '_'))
+        s++;
+    bench->sweep_namelen = s - bench->sweep_name;
+    if (bench->sweep_namelen == 0) {
+        parse_fail(ps, s, "expected the name of the variable to sweep");
+        goto err;
+    }
+    ps->next_pos = s;
+    s = skip_next_ws(ps);
+    if (s == ps->next_line_pos || *s != '=') {
+        parse_fail(ps, s, "expected '='");
+        goto err;
+    }
+
+    // split the values at commas outside parentheses
+    value = ++s;
+    for (;; s++) {
+        int end = (s == ps->next_line_pos || *s == '!' || *s == '\r' ||
+                   *s == '\n');
+        if (end || (*s == ',' && depth == 0)) {
+            char *v = value, *v_end = s;
+            while (v < v_end && isblank((unsigned char)*v))
+                v++;
+            while (v_end > v && isblank((unsigned char)v_end[-1]))
+                v_end--;
+            if (v == v_end) {
+                parse_fail(ps, v, "expected a value to sweep");
+                goto err;
+            }
+            struct Code *code = NEW0(struct Code);
+            code->type = ARG_CODE;
+            code->lineno = ps->lineno;
+            code->u.c.str = v;
+            code->u.c.len = v_end - v;
+            *tail = code;
+            tail = &code->next;
+            value = s + 1;
+            if (end)
+                break;
+        } else if (*s == '(') {
+            depth++;
+        } else if (*s == ')') {
+            depth--;
+        }
+    }
+    ps->next_pos = s;
+    if (expect_eol(ps))
+        goto err;
+    return TRUE;
+ err:
+    if (bench->sweep)
+        free_code(bench->sweep);
+    bench->sweep = NULL;
+    return TRUE;
+}
+
+/* Reads the "timed NAME ... end timed" variants of a bench's compare block,
+ * up to "end compare", into bench->variants in order.
+ */
+static int parse_compare(struct ParseState *ps, struct TestBench *bench)
+{
+    struct BenchVariant **tail = &bench->variants;
+    char *tok;
+    size_t len;
+
+    if (expect_eol(ps))
+        return -1;
+    for (;;) {
+        tok = next_token(ps, &len);
+        if (tok == END_OF_LINE) {
+            if (!next_line(ps)) {
+                parse_fail(ps, ps->read_pos, "expected \"end compare\"");
+                return -1;
+            }
+            continue;
+        }
+        if (same_token("end", 3, tok, len))
+            break;
+        if (!same_token("timed", 5, tok, len)) {
+            parse_fail(ps, tok, "expected \"timed NAME\" or \"end compare\"");
+            return -1;
+        }
+
+        struct BenchVariant *var = NEW0(struct BenchVariant);
+        *tail = var;
+        tail = &var->next;
+        bench->n_variants++;
+        var->name = expect_name(ps, &var->namelen, "variant");
+        if (!var->name)
+            return -1;
+        while (var->namelen > 0 &&
+               isblank((unsigned char)var->name[var->namelen - 1]))
+            var->namelen--;
+        if (memchr(var->name, '"', var->namelen)) {
+            parse_fail(ps, var->name,
+                       "double quotes (\") not allowed in variant names");
+            return -1;
+        }
+        for (struct BenchVariant *v = bench->variants; v != var; v = v->next) {
+            if (same_token(v->name, v->namelen, var->name, var->namelen)) {
+                parse_fail(ps, var->name, "variant name used twice");
+                return -1;
+            }
+        }
+        if (expect_eol(ps))
+            return -1;
+
+        var->timed = parse_fortran(ps, NULL);
+        if (!var->timed)
+            return -1;
+        if (parse_end_sequence(ps, "timed", var->name, var->namelen))
+            return -1;
+    }
+    if (bench->n_variants < 2) {
+        parse_fail(ps, tok, "compare needs at least two variants");
+        return -1;
+    }
+    ps->next_pos = ps->read_pos = ps->line_pos;
+    return parse_end_sequence(ps, "compare", NULL, 0);
+}
+
+static struct TestBench *parse_bench(struct ParseState *ps)
+{
+    struct TestBench *bench = NEW0(struct TestBench);
+    char *tok;
+    size_t len;
+
+    bench->name = expect_name(ps, &bench->namelen, "bench");
+    if (!bench->name)
+        goto err;
+    if (memchr(bench->name, '"', bench->namelen)) {
+        parse_fail(ps, ps->read_pos, "double quotes (\") not allowed in bench names");
+        goto err;
+    }
+
+    if (expect_eol(ps))
+        goto err;
+
+    // sweep, bytes and flops lines come first
+    for (;;) {
+        tok = next_token(ps, &len);
+        if (tok == END_OF_LINE) {
+            if (!next_line(ps))
+                break; // parse_fortran reports it
+        } else if (same_token("bytes", 5, tok, len)) {
+            if (!parse_bench_work(ps, "bytes", &bench->bytes,
+                                  &bench->bytes_len))
+                break;
+            if (!bench->bytes)
+                goto err;
+        } else if (same_token("flops", 5, tok, len)) {
+            if (!parse_bench_work(ps, "flops", &bench->flops,
+                                  &bench->flops_len))
+                break;
+            if (!bench->flops)
+                goto err;
+        } else if (same_token("sweep", 5, tok, len)) {
+            if (!parse_sweep(ps, bench))
+                break;
+            if (!bench->sweep)
+                goto err;
+        } else {
+            break;
+        }
+    }
+    ps->next_pos = ps->read_pos = ps->line_pos;
+
+    bench->setup = parse_fortran(ps, NULL);
+    if (!bench->setup)
+        goto err;
+
+    tok = next_token(ps, &len);
+    if (same_token("compare", 7, tok, len)) {
+        if (parse_compare(ps, bench))
+            goto err;
+    } else {
+        ps->next_pos = ps->read_pos = ps->line_pos;
+        if (expect_token(ps, "timed", "timed\" or \"compare") ||
+            expect_eol(ps))
+            goto err;
+        bench->timed = parse_fortran(ps, NULL);
+        if (!bench->timed)
+            goto err;
+        if (parse_end_sequence(ps, "timed", NULL, 0))
+            goto err;
+    }
+
+    bench->after = parse_fortran(ps, NULL);
+    if (!bench->after)
+        goto err;
+
+    if (parse_end_sequence(ps, "bench", bench->name, bench->namelen))
+        goto err;
+
+    return bench;
+ err:
+    free_benches(bench);
+    return NULL;
+}
+
 static struct TestSet *parse_set(struct ParseState *ps)
 {
     struct TestSet *set = NEW0(struct TestSet);
@@ -737,8 +1271,13 @@ static struct TestSet *parse_set(struct ParseState *ps)
 
     if (expect_eol(ps)) goto err;
 
-    // set contents: dep, tolerance, setup, teardown, test case, fortran
-    set->tolerance = 0.0; // XXX magic number == BAD
+    // set contents: dep, tolerance, exact_compare, mismatch_stats,
+    // parallel_asserts, threads, memory, setup, teardown, setup_set,
+    // teardown_set, test case, bench, fortran
+    set->tolerance = NO_TOLERANCE;
+    set->exact_compare = EXACT_VALUE;
+    set->mismatch_stats = -1;
+    set->parallel_asserts = -1;
     for (;;) {
         tok = next_token(ps, &len);
         if (tok == END_OF_LINE) {
@@ -774,7 +1313,78 @@ static struct TestSet *parse_set(struct ParseState *ps)
                     parse_fail(ps, ps->read_pos, "not a floating point value");
                     goto err;
                 }
+                if (set->tolerance < 0.0) {
+                    parse_fail(ps, ps->read_pos, "tolerance must be >= 0");
+                    goto err;
+                }
                 ps->next_pos = tolend;
+            } else if (same_token("threads", 7, tok, len)) {
+                char *nend;
+                tok = next_token(ps, &len);
+                long n = -1;
+                if (tok != END_OF_LINE)
+                    n = strtol(ps->read_pos, &nend, 10);
+                if (tok == END_OF_LINE || nend == ps->read_pos ||
+                    nend != ps->next_pos || n < 1 || n > INT_MAX) {
+                    parse_fail(ps, ps->read_pos, "expected the number of "
+                               "threads the tests use");
+                    goto err;
+                }
+                set->threads = (int)n;
+            } else if (same_token("memory", 6, tok, len)) {
+                char *send;
+                tok = next_token(ps, &len);
+                if (tok != END_OF_LINE)
+                    set->memory = fu_parse_size(ps->read_pos, &send);
+                if (tok == END_OF_LINE || send == ps->read_pos ||
+                    send != ps->next_pos) {
+                    parse_fail(ps, ps->read_pos, "expected the memory the "
+                               "tests need, like 512MB or 20GB");
+                    goto err;
+                }
+            } else if (same_token("exact_compare", 13, tok, len)) {
+                tok = next_token(ps, &len);
+                if (tok && same_token("value", 5, tok, len)) {
+                    set->exact_compare = EXACT_VALUE;
+                } else if (tok && same_token("nan_equal", 9, tok, len)) {
+                    set->exact_compare = EXACT_NAN_EQUAL;
+                } else if (tok && same_token("bitwise", 7, tok, len)) {
+                    set->exact_compare = EXACT_BITWISE;
+                } else {
+                    parse_fail(ps, ps->read_pos, "expected value, nan_equal "
+                               "or bitwise");
+                    goto err;
+                }
+            } else if (same_token("mismatch_stats", 14, tok, len)) {
+                char *nend;
+                tok = next_token(ps, &len);
+                if (tok == END_OF_LINE) {
+                    set->mismatch_stats = DEFAULT_MISMATCHES_SHOWN;
+                } else {
+                    long n = strtol(ps->read_pos, &nend, 10);
+                    if (nend == ps->read_pos || nend != ps->next_pos ||
+                        n < 0 || n > INT_MAX) {
+                        parse_fail(ps, ps->read_pos, "expected the number of "
+                                   "mismatches to show");
+                        goto err;
+                    }
+                    set->mismatch_stats = (int)n;
+                }
+            } else if (same_token("parallel_asserts", 16, tok, len)) {
+                char *nend;
+                tok = next_token(ps, &len);
+                if (tok == END_OF_LINE) {
+                    set->parallel_asserts = DEFAULT_PARALLEL_MIN_SIZE;
+                } else {
+                    long n = strtol(ps->read_pos, &nend, 10);
+                    if (nend == ps->read_pos || nend != ps->next_pos ||
+                        n < 0 || n > INT_MAX) {
+                        parse_fail(ps, ps->read_pos, "expected the smallest "
+                                   "array size to compare in parallel");
+                        goto err;
+                    }
+                    set->parallel_asserts = (int)n;
+                }
             } else if (same_token("setup", 5, tok, len)) {
                 if (set->setup) {
                     parse_fail(ps, ps->next_pos,
@@ -793,6 +1403,24 @@ static struct TestSet *parse_set(struct ParseState *ps)
                 set->teardown = parse_support(ps, "teardown");
                 if (!set->teardown)
                     goto err;
+            } else if (same_token("setup_set", 9, tok, len)) {
+                if (set->setup_set) {
+                    parse_fail(ps, ps->next_pos,
+                         "more than one setup_set specified");
+                    goto err;
+                }
+                set->setup_set = parse_support(ps, "setup_set");
+                if (!set->setup_set)
+                    goto err;
+            } else if (same_token("teardown_set", 12, tok, len)) {
+                if (set->teardown_set) {
+                    parse_fail(ps, ps->next_pos,
+                         "more than one teardown_set specified");
+                    goto err;
+                }
+                set->teardown_set = parse_support(ps, "teardown_set");
+                if (!set->teardown_set)
+                    goto err;
             } else if (same_token("test", 4, tok, len)) {
                 struct TestCase *test = parse_test_case(ps);
                 if (!test)
@@ -800,6 +1428,13 @@ static struct TestSet *parse_set(struct ParseState *ps)
                 test->next = set->tests;
                 set->tests = test;
                 set->n_tests++;
+            } else if (same_token("bench", 5, tok, len)) {
+                struct TestBench *bench = parse_bench(ps);
+                if (!bench)
+                    goto err;
+                bench->next = set->benches;
+                set->benches = bench;
+                set->n_benches++;
             } else if (same_token("end", 3, tok, len)) {
                 ps->next_pos = ps->read_pos;
                 break; // end of test set
@@ -827,22 +1462,16 @@ static struct TestSet *parse_set(struct ParseState *ps)
     return NULL;
 }
 
-/* Parser entry point.  Opens and parses the test sets in the given file.
+/* Parses the test sets of a TestFile whose ParseState has already been
+ * opened.  Returns 0 on success; parse failures have already been reported.
  */
-struct TestFile *parse_test_file(const char *path)
+int parse_opened_test_file(struct TestFile *tf)
 {
-    struct TestFile *tf = NEW0(struct TestFile);
     struct ParseState *ps = &tf->ps;
-    tf->path = fu_strdup(path);
-
-    if (open_file_for_parsing(path, ps) != 0) {
-        free(tf);
-        return NULL;
-    }
 
     if (!next_line(ps)) {
         syntax_error(ps);
-        goto close_it;
+        return -1;
     }
 
     for (;;) {
@@ -851,7 +1480,7 @@ struct TestFile *parse_test_file(const char *path)
         if (same_token("set", 3, token, toklen)) {
             struct TestSet *set = parse_set(ps);
             if (!set) // parse failure already reported
-                goto close_it;
+                return -1;
             set->next = tf->sets;
             tf->sets = set;
         } else if (token == END_OF_LINE) {
@@ -859,18 +1488,95 @@ struct TestFile *parse_test_file(const char *path)
                 if (!tf->sets) {
                     goto no_sets;
                 }
-                goto done;
+                return 0;
             }
             // else swallow blank line
         } else {
 no_sets:
             parse_fail(ps, ps->read_pos, "expected a test set");
-            goto close_it;
+            return -1;
+        }
+    }
+}
+
+/* Returns TRUE if any set in tf has a bench.
+ */
+int has_benches(const struct TestFile *tf)
+{
+    for (struct TestSet *set = tf->sets; set; set = set->next) {
+        if (set->benches)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static int code_uses_macros(const struct Code *code, unsigned types)
+{
+    for (; code; code = code->next) {
+        if (code->type == MACRO_CODE &&
+            ((types & MACRO_BIT(code->u.m.type)) ||
+             code_uses_macros(code->u.m.args, types)))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Whether any code in tf, in its sets, fixtures, tests or benches, has one
+ * of the macros in types, a set of MACRO_BIT()s.
+ */
+int uses_macros(const struct TestFile *tf, unsigned types)
+{
+    for (struct TestSet *set = tf->sets; set; set = set->next) {
+        if (code_uses_macros(set->code, types) ||
+            code_uses_macros(set->setup, types) ||
+            code_uses_macros(set->teardown, types) ||
+            code_uses_macros(set->setup_set, types) ||
+            code_uses_macros(set->teardown_set, types))
+            return TRUE;
+        for (struct TestCase *test = set->tests; test; test = test->next) {
+            if (code_uses_macros(test->code, types))
+                return TRUE;
+        }
+        for (struct TestBench *b = set->benches; b; b = b->next) {
+            if (code_uses_macros(b->setup, types) ||
+                code_uses_macros(b->timed, types) ||
+                code_uses_macros(b->after, types))
+                return TRUE;
+            for (struct BenchVariant *v = b->variants; v; v = v->next) {
+                if (code_uses_macros(v->timed, types))
+                    return TRUE;
+            }
         }
     }
+    return FALSE;
+}
 
- close_it:
-    close_testfile(tf);
- done:
+/* Whether the test program for tf needs memory_helper.c: to report each
+ * test's memory use, or for an assert_max_allocations.
+ */
+int uses_memory_helper(const struct TestFile *tf)
+{
+    return tf->memory || uses_macros(tf, MACRO_BIT(ASSERT_MAX_ALLOCATIONS));
+}
+
+/* Parser entry point.  Opens and parses the test sets in the given file,
+ * reporting any problems to err.
+ */
+struct TestFile *parse_test_file(const char *path, FILE *err)
+{
+    struct TestFile *tf = NEW0(struct TestFile);
+    tf->path = fu_strdup(path);
+    tf->ps.err = err;
+
+    if (open_file_for_parsing(tf->path, &tf->ps) != 0) {
+        free((void *)tf->path);
+        free(tf);
+        return NULL;
+    }
+
+    if (parse_opened_test_file(tf)) {
+        close_testfile(tf);
+        return NULL;
+    }
     return tf;
 }
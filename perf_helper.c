@@ -0,0 +1,91 @@
+/* perf_helper.c - hardware performance counters for test programs.
+ *
+ * funit --perf builds this into each test program, whose funit_perf module
+ * calls it through bind(C).  It counts the program's cycles, instructions,
+ * cache misses and branch misses in user space with perf_event_open(2),
+ * including threads started later, like OpenMP's.  It uses only the C
+ * library, so it builds with any C compiler the Fortran compiler can drive.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+// in the order the funit module reports them
+#define FUNIT_PERF_EVENTS 4
+
+static int perf_fds[FUNIT_PERF_EVENTS] = {-1, -1, -1, -1};
+
+/* Starts the counters.  Returns how many could be opened; if none, note
+ * (note_size chars) says why.
+ */
+int funit_perf_open(char *note, int note_size)
+{
+#ifdef __linux__
+    static const uint64_t events[FUNIT_PERF_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    int n_open = 0, first_errno = 0;
+
+    for (int i = 0; i < FUNIT_PERF_EVENTS; i++) {
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = events[i];
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // to scale the counts up when the counters are shared out
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        perf_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (perf_fds[i] >= 0)
+            n_open++;
+        else if (!first_errno)
+            first_errno = errno;
+    }
+
+    if (n_open == 0) {
+        const char *hint = "";
+        if (first_errno == EACCES || first_errno == EPERM)
+            hint = " (see /proc/sys/kernel/perf_event_paranoid)";
+        else if (first_errno == ENOENT || first_errno == EOPNOTSUPP)
+            hint = " (no hardware events, as in many virtual machines)";
+        snprintf(note, note_size, "perf_event_open: %s%s",
+                 strerror(first_errno), hint);
+    }
+    return n_open;
+#else
+    snprintf(note, note_size, "not supported on this system");
+    return 0;
+#endif
+}
+
+/* Puts each counter's count so far in counts, or -1 for one that isn't
+ * counting.
+ */
+void funit_perf_read(int64_t *counts)
+{
+    for (int i = 0; i < FUNIT_PERF_EVENTS; i++) {
+        uint64_t v[3]; // value, time enabled, time running
+
+        counts[i] = -1;
+        if (perf_fds[i] < 0 || read(perf_fds[i], v, sizeof(v)) != sizeof(v)
+            || v[2] == 0)
+            continue;
+        if (v[2] < v[1]) // only counted part of the time
+            counts[i] = (int64_t)((double)v[0] * v[1] / v[2]);
+        else
+            counts[i] = (int64_t)v[0];
+    }
+}
@@ -0,0 +1,102 @@
+/* Microbenchmark for the code generator: writes a synthetic template with
+ * many tests, parses it once, then times repeated generate_code_file() runs
+ * into an in-memory consumer and through writev() to /dev/null.
+ *
+ * Usage: bench_generate [N_TESTS [N_RUNS]]
+ */
+#include "../funit.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char test_body[] =
+"  test case%i\n"
+"    real :: a(100), b(100), x\n"
+"    integer :: i, j\n"
+"    a = 1.0\n"
+"    b = a\n"
+"    x = 2.0\n"
+"    i = 3; j = 3\n"
+"    assert_true(i == j)\n"
+"    assert_false(i /= j)\n"
+"    assert_equal(i, j)\n"
+"    assert_not_equal(i, 4)\n"
+"    assert_equal_with(x, 2.0001)\n"
+"    assert_array_equal(a, b)\n"
+"    assert_array_equal_with(a, b, 0.01)\n"
+"  end test case%i\n"
+"\n";
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int count_consumer(void *data, const struct iovec *iov, int iovcnt)
+{
+    size_t *n = (size_t *)data;
+    for (int i = 0; i < iovcnt; i++)
+        *n += iov[i].iov_len;
+    return 0;
+}
+
+static void report(const char *what, double secs, int runs, size_t bytes)
+{
+    printf("%-26s %8.3f ms/file %9.1f MB/s\n", what, secs / runs * 1e3,
+           bytes * (double)runs / secs / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    int n_tests = argc > 1 ? atoi(argv[1]) : 2000;
+    int n_runs = argc > 2 ? atoi(argv[2]) : 20;
+    char path[] = "/tmp/bench_generateXXXXXX";
+    size_t bytes = 0;
+    double t;
+
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    FILE *f = fdopen(fd, "w");
+    fputs("set bench\n  tolerance 0.001\n\n", f);
+    for (int i = 0; i < n_tests; i++)
+        fprintf(f, test_body, i, i);
+    fputs("end set\n\n", f);
+    fclose(f);
+
+    t = now();
+    struct TestFile *tf = parse_test_file(path, stderr);
+    assert(tf != NULL);
+    printf("parsed %i tests in %.3f ms\n", n_tests, (now() - t) * 1e3);
+
+    t = now();
+    for (int r = 0; r < n_runs; r++) {
+        struct Emitter out;
+        emit_init(&out);
+        generate_code_file(tf, &out, stderr);
+        bytes = 0;
+        emit_consume(&out, count_consumer, &bytes);
+        emit_free(&out);
+    }
+    report("generate (in memory)", now() - t, n_runs, bytes);
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    assert(null_fd != -1);
+    t = now();
+    for (int r = 0; r < n_runs; r++) {
+        struct Emitter out;
+        emit_init(&out);
+        generate_code_file(tf, &out, stderr);
+        emit_writev(&out, null_fd);
+        emit_free(&out);
+    }
+    report("generate + writev", now() - t, n_runs, bytes);
+    close(null_fd);
+
+    close_testfile(tf);
+    unlink(path);
+    return 0;
+}
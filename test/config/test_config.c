@@ -157,6 +157,61 @@ void test_parse_config_bad_keys()
     close_parse_file(&ps);
 }
 
+void test_parse_config_bench()
+{
+    struct ParseState ps;
+    struct Config conf;
+
+    memset(&conf, 0, sizeof(struct Config));
+
+    int ret = try_open_file("funitrc-6", &ps);
+    assert(ret == 0);
+
+    ret = parse_config(&ps, &conf);
+    assert(ret == 0);
+
+    assert(conf.baseline_dir_len == 13);
+    assert(strncmp(conf.baseline_dir, "bench results", 13) == 0);
+    assert(conf.bench_threshold == 2.5);
+
+    close_parse_file(&ps);
+
+    ret = try_open_file("funitrc-7", &ps);
+    assert(ret == 0);
+
+    ret = parse_config(&ps, &conf);
+    assert(ret != 0);
+
+    close_parse_file(&ps);
+}
+
+void test_parse_config_module_build()
+{
+    struct ParseState ps;
+    struct Config conf;
+
+    memset(&conf, 0, sizeof(struct Config));
+
+    int ret = try_open_file("funitrc-8", &ps);
+    assert(ret == 0);
+
+    ret = parse_config(&ps, &conf);
+    assert(ret == 0);
+
+    assert(conf.cache_dir_len == 12);
+    assert(strncmp(conf.cache_dir, ".funit-cache", 12) == 0);
+    assert(conf.module_build_len == 32);
+    assert(strncmp(conf.module_build, "gfortran -c -o {{EXE}} {{SRC.F}}",
+                   32) == 0);
+
+    set_defaults(&conf);
+    assert(conf.module_build_fragments != NULL);
+    assert(conf.build_fragments != conf.module_build_fragments);
+
+    close_parse_file(&ps);
+    free_config(&conf);
+}
+
 void test_set_defaults_empty(void)
 {
     struct Config conf;
@@ -172,6 +227,8 @@ void test_set_defaults_empty(void)
     assert(conf.fortran_ext_len == strlen(conf.fortran_ext));
     assert(conf.template_ext != NULL);
     assert(conf.template_ext_len == strlen(conf.template_ext));
+    assert(conf.module_build == NULL);
+    assert(conf.module_build_fragments == NULL);
 
     free_config(&conf);
 }
@@ -216,6 +273,8 @@ int main(int argc, char **argv)
     test_parse_config();
     test_parse_config_escapes();
     test_parse_config_bad_keys();
+    test_parse_config_bench();
+    test_parse_config_module_build();
 
     test_set_defaults_empty();
     test_set_defaults_full();
@@ -0,0 +1,190 @@
+#include "../../funit.h"
+#include <string.h>
+#include <unistd.h>
+
+#define CACHE_DIR "cache-tmp"
+
+static void same_code(struct Code *a, struct Code *b)
+{
+    while (a && b) {
+        assert(a->type == b->type);
+        assert(a->lineno == b->lineno);
+        if (a->type == MACRO_CODE) {
+            assert(a->u.m.type == b->u.m.type);
+            same_code(a->u.m.args, b->u.m.args);
+        } else {
+            assert(a->u.c.len == b->u.c.len);
+            assert(memcmp(a->u.c.str, b->u.c.str, a->u.c.len) == 0);
+        }
+        a = a->next;
+        b = b->next;
+    }
+    assert(a == NULL && b == NULL);
+}
+
+static void same_span(const char *a, size_t alen, const char *b, size_t blen)
+{
+    assert(alen == blen);
+    assert((a == NULL) == (b == NULL));
+    if (a)
+        assert(memcmp(a, b, alen) == 0);
+}
+
+static void same_sets(struct TestSet *a, struct TestSet *b)
+{
+    while (a && b) {
+        same_span(a->name, a->namelen, b->name, b->namelen);
+        assert(a->tolerance == b->tolerance);
+        assert(a->exact_compare == b->exact_compare);
+        assert(a->mismatch_stats == b->mismatch_stats);
+        assert(a->parallel_asserts == b->parallel_asserts);
+        assert(a->threads == b->threads);
+        assert(a->memory == b->memory);
+        assert(a->n_deps == b->n_deps);
+        assert(a->n_mods == b->n_mods);
+        assert(a->n_tests == b->n_tests);
+        assert(a->n_benches == b->n_benches);
+
+        struct TestDependency *da = a->deps, *db = b->deps;
+        for (; da && db; da = da->next, db = db->next)
+            same_span(da->filename, da->len, db->filename, db->len);
+        assert(da == NULL && db == NULL);
+
+        struct TestModule *ma = a->mods, *mb = b->mods;
+        for (; ma && mb; ma = ma->next, mb = mb->next) {
+            same_span(ma->name, ma->len, mb->name, mb->len);
+            same_span(ma->extra, ma->elen, mb->extra, mb->elen);
+        }
+        assert(ma == NULL && mb == NULL);
+
+        same_code(a->setup, b->setup);
+        same_code(a->teardown, b->teardown);
+        same_code(a->setup_set, b->setup_set);
+        same_code(a->teardown_set, b->teardown_set);
+        same_code(a->code, b->code);
+
+        struct TestCase *ta = a->tests, *tb = b->tests;
+        for (; ta && tb; ta = ta->next, tb = tb->next) {
+            same_span(ta->name, ta->namelen, tb->name, tb->namelen);
+            same_span(ta->case_name, ta->case_namelen,
+                      tb->case_name, tb->case_namelen);
+            same_span(ta->over, ta->overlen, tb->over, tb->overlen);
+            assert(ta->need_array_iterator == tb->need_array_iterator);
+            same_code(ta->code, tb->code);
+        }
+        assert(ta == NULL && tb == NULL);
+
+        struct TestBench *ba = a->benches, *bb = b->benches;
+        for (; ba && bb; ba = ba->next, bb = bb->next) {
+            same_span(ba->name, ba->namelen, bb->name, bb->namelen);
+            same_span(ba->bytes, ba->bytes_len, bb->bytes, bb->bytes_len);
+            same_span(ba->flops, ba->flops_len, bb->flops, bb->flops_len);
+            same_span(ba->sweep_name, ba->sweep_namelen,
+                      bb->sweep_name, bb->sweep_namelen);
+            same_code(ba->sweep, bb->sweep);
+            same_code(ba->setup, bb->setup);
+            same_code(ba->timed, bb->timed);
+            same_code(ba->after, bb->after);
+
+            assert(ba->n_variants == bb->n_variants);
+            struct BenchVariant *va = ba->variants, *vb = bb->variants;
+            for (; va && vb; va = va->next, vb = vb->next) {
+                same_span(va->name, va->namelen, vb->name, vb->namelen);
+                same_code(va->timed, vb->timed);
+            }
+            assert(va == NULL && vb == NULL);
+        }
+        assert(ba == NULL && bb == NULL);
+
+        a = a->next;
+        b = b->next;
+    }
+    assert(a == NULL && b == NULL);
+}
+
+/* Parse each file directly, then through a cold and a warm cache, and make
+ * sure all three trees agree.
+ */
+static void test_round_trip(const char *path)
+{
+    struct TestFile *parsed = parse_test_file(path, stderr);
+    assert(parsed != NULL);
+
+    struct TestFile *cold = parse_test_file_cached(path, CACHE_DIR, stderr);
+    assert(cold != NULL);
+    same_sets(parsed->sets, cold->sets);
+
+    struct TestFile *warm = parse_test_file_cached(path, CACHE_DIR, stderr);
+    assert(warm != NULL);
+    same_sets(parsed->sets, warm->sets);
+
+    close_testfile(warm);
+    close_testfile(cold);
+    close_testfile(parsed);
+}
+
+/* A variable named "bench" doesn't start a bench.
+ */
+static void test_bench_variable(void)
+{
+    struct TestFile *tf = parse_test_file("bench_names.fun", stderr);
+    assert(tf != NULL);
+    assert(tf->sets->n_tests == 1);
+    assert(tf->sets->n_benches == 1);
+    close_testfile(tf);
+}
+
+/* Nor do variables named like the settings of a set, though the settings
+ * themselves still apply.
+ */
+static void test_setting_variables(void)
+{
+    struct TestFile *tf = parse_test_file("resources.fun", stderr);
+    assert(tf != NULL);
+    struct TestSet *set = tf->sets;
+    while (set && !(set->namelen == 13 &&
+                    !strncmp(set->name, "compare_names", 13)))
+        set = set->next;
+    assert(set != NULL);
+    assert(set->n_tests == 1);
+    assert(set->mismatch_stats == 3);
+    assert(set->exact_compare == EXACT_BITWISE);
+    assert(set->parallel_asserts == -1);
+    close_testfile(tf);
+}
+
+/* A return in a test over a table would leave its whole set, so it is an
+ * error, reported on its own line.
+ */
+static void test_case_return(void)
+{
+    char message[256];
+    FILE *err = tmpfile();
+    assert(err != NULL);
+
+    assert(parse_test_file("case_return.fun", err) == NULL);
+    rewind(err);
+    assert(fgets(message, sizeof message, err) != NULL);
+    assert(strstr(message, "case_return.fun:7:") != NULL);
+    fclose(err);
+}
+
+int main(int argc, char **argv)
+{
+    test_round_trip("all_macros.fun");
+    test_round_trip("attrs.fun");
+    test_round_trip("bench.fun");
+    test_round_trip("resources.fun");
+    test_round_trip("cases.fun");
+    test_round_trip("bench_names.fun");
+    test_round_trip("test1.fun");
+
+    test_bench_variable();
+    test_setting_variables();
+    test_case_return();
+
+    system("rm -rf " CACHE_DIR);
+
+    puts("all parse cache tests passed!");
+    return 0;
+}
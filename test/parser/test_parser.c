@@ -61,6 +61,27 @@ void print_code(char *label, struct Code *code)
         case ASSERT_ARRAY_EQUAL_WITH:
             puts("assert_array_equal_with");
             break;
+        case ASSERT_CLOSE:
+            puts("assert_close");
+            break;
+        case ASSERT_ARRAY_CLOSE:
+            puts("assert_array_close");
+            break;
+        case ASSERT_ULP:
+            puts("assert_ulp");
+            break;
+        case ASSERT_ARRAY_ULP:
+            puts("assert_array_ulp");
+            break;
+        case ASSERT_TIME_BELOW:
+            puts("assert_time_below");
+            break;
+        case ASSERT_FASTER_THAN:
+            puts("assert_faster_than");
+            break;
+        case ASSERT_MAX_ALLOCATIONS:
+            puts("assert_max_allocations");
+            break;
         case FLUNK:
             puts("flunk");
             break;
@@ -92,11 +113,55 @@ void print_test(struct TestCase *test)
     printf("  Test '");
     fwrite(test->name, test->namelen, 1, stdout);
     puts("'");
+    if (test->over) {
+        printf("    Case '");
+        fwrite(test->case_name, test->case_namelen, 1, stdout);
+        printf("' over '");
+        fwrite(test->over, test->overlen, 1, stdout);
+        puts("'");
+    }
 
     if (test->code)
         print_code("    Code", test->code);
 }
 
+void print_bench(struct TestBench *bench)
+{
+    if (bench->next)
+        print_bench(bench->next);
+
+    printf("  Bench '");
+    fwrite(bench->name, bench->namelen, 1, stdout);
+    puts("'");
+
+    if (bench->bytes) {
+        printf("    Bytes '");
+        fwrite(bench->bytes, bench->bytes_len, 1, stdout);
+        puts("'");
+    }
+    if (bench->flops) {
+        printf("    Flops '");
+        fwrite(bench->flops, bench->flops_len, 1, stdout);
+        puts("'");
+    }
+    if (bench->sweep) {
+        printf("    Sweep '");
+        fwrite(bench->sweep_name, bench->sweep_namelen, 1, stdout);
+        puts("' over");
+        print_code(NULL, bench->sweep);
+    }
+    print_code("    Setup", bench->setup);
+    if (bench->timed)
+        print_code("    Timed", bench->timed);
+    for (struct BenchVariant *var = bench->variants; var; var = var->next) {
+        printf("    Variant '");
+        fwrite(var->name, var->namelen, 1, stdout);
+        puts("'");
+        print_code("    Timed", var->timed);
+    }
+    print_code("    After", bench->after);
+}
+
 void print_sets(struct TestSet *set)
 {
     if (set->next)
@@ -106,15 +171,28 @@ void print_sets(struct TestSet *set)
     fwrite(set->name, set->namelen, 1, stdout);
     printf("'\n");
 
-    if (set->tolerance > 0.0) {
+    if (set->tolerance != NO_TOLERANCE) {
         printf("  Tolerance %f\n", set->tolerance);
     } else {
         puts("  No tolerance given");
     }
+    if (set->exact_compare == EXACT_NAN_EQUAL)
+        puts("  Exact comparisons with NaN equal");
+    else if (set->exact_compare == EXACT_BITWISE)
+        puts("  Exact comparisons bitwise");
+    if (set->mismatch_stats >= 0)
+        printf("  Mismatch stats, showing %i\n", set->mismatch_stats);
+    if (set->parallel_asserts >= 0)
+        printf("  Parallel asserts from %i elements\n", set->parallel_asserts);
+    if (set->threads > 0)
+        printf("  Uses %i threads\n", set->threads);
+    if (set->memory > 0)
+        printf("  Needs %.0f bytes\n", set->memory);
 
     printf("  # deps: %zu\n", set->n_deps);
     printf("  # mods: %zu\n", set->n_mods);
     printf("  # test cases: %zu\n", set->n_tests);
+    printf("  # benches: %zu\n", set->n_benches);
 
     if (set->deps)
         print_dependency(set->deps);
@@ -131,9 +209,18 @@ void print_sets(struct TestSet *set)
     if (set->teardown)
         print_code("  Teardown", set->teardown);
 
+    if (set->setup_set)
+        print_code("  Setup set", set->setup_set);
+
+    if (set->teardown_set)
+        print_code("  Teardown set", set->teardown_set);
+
     if (set->tests)
         print_test(set->tests);
 
+    if (set->benches)
+        print_bench(set->benches);
+
     puts("");
 }
 
@@ -146,7 +233,7 @@ int main(int argc, char **argv)
 
     for (int i = 1; i < argc; i++) {
         printf("Parsing %s:\n\n", argv[i]);
-        struct TestFile *tf = parse_test_file(argv[i]);
+        struct TestFile *tf = parse_test_file(argv[i], stderr);
         if (tf && tf->sets) {
             print_sets(tf->sets);
             close_testfile(tf);
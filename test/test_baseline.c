@@ -0,0 +1,97 @@
+#include "../funit.h"
+#include "../baseline.c"
+#include <unistd.h>
+
+#define SAMPLES_FILE "baseline-tmp.csv"
+
+static void test_parse_samples_line()
+{
+    char line1[] = "\"set\",\"a \"\"quoted\"\" bench\",,,1.5E-006,2.0E-006\n";
+    char line2[] = "\"s\",\"sweep\",\"n\",1000, 3.0E-006\n";
+    char bad[] = "\"s\",\"b\",,,1.0,x\n";
+    char empty[] = "\"s\",\"b\",,\n";
+    struct BenchSamples *bs;
+
+    bs = parse_samples_line(line1);
+    assert(bs != NULL);
+    assert(strcmp(bs->key, "set/a \"quoted\" bench") == 0);
+    assert(bs->n == 2);
+    assert(bs->t[0] == 1.5e-6 && bs->t[1] == 2.0e-6);
+    free_bench_samples(bs);
+
+    bs = parse_samples_line(line2);
+    assert(bs != NULL);
+    assert(strcmp(bs->key, "s/sweep (n = 1000)") == 0);
+    assert(bs->n == 1 && bs->t[0] == 3.0e-6);
+    free_bench_samples(bs);
+
+    assert(parse_samples_line(bad) == NULL);
+    assert(parse_samples_line(empty) == NULL);
+}
+
+static void test_mann_whitney()
+{
+    double a[20], b[20], c[20];
+
+    for (int i = 0; i < 20; i++) {
+        a[i] = 1.0 + 0.01 * i;
+        b[i] = 1.0 + 0.01 * (19 - i); // same values
+        c[i] = 1.5 + 0.01 * i;        // all bigger
+    }
+    assert(mann_whitney_p(a, 20, b, 20) > 0.9);
+    assert(mann_whitney_p(a, 20, c, 20) < 1e-6);
+    assert(mann_whitney_p(c, 20, a, 20) < 1e-6);
+
+    // all tied
+    for (int i = 0; i < 20; i++)
+        b[i] = a[i] = 1.0;
+    assert(mann_whitney_p(a, 20, b, 20) == 1);
+}
+
+static void test_compare()
+{
+    struct BenchSamples *base, *now;
+    FILE *f, *out;
+
+    f = fopen(SAMPLES_FILE, "w");
+    fputs("\"s\",\"same\",,", f);
+    for (int i = 0; i < 20; i++)
+        fprintf(f, ",%g", 1.0 + 0.01 * i);
+    fputs("\n\"s\",\"slower\",,", f);
+    for (int i = 0; i < 20; i++)
+        fprintf(f, ",%g", 1.0 + 0.01 * i);
+    fputs("\n", f);
+    fclose(f);
+    assert(read_bench_samples(SAMPLES_FILE, &base, stderr) == 0);
+    assert(base && base->next && !base->next->next);
+
+    f = fopen(SAMPLES_FILE, "w");
+    fputs("\"s\",\"slower\",,", f);
+    for (int i = 0; i < 20; i++)
+        fprintf(f, ",%g", 1.2 + 0.01 * i);
+    fputs("\n\"s\",\"same\",,", f);
+    for (int i = 0; i < 20; i++)
+        fprintf(f, ",%g", 1.0 + 0.01 * (19 - i));
+    fputs("\n\"s\",\"new\",,,1\n", f);
+    fclose(f);
+    assert(read_bench_samples(SAMPLES_FILE, &now, stderr) == 0);
+
+    out = fopen("/dev/null", "w");
+    assert(compare_bench_samples(now, base, 5, out) == 1);
+    assert(compare_bench_samples(now, base, 25, out) == 0);
+    fclose(out);
+
+    free_bench_samples(now);
+    free_bench_samples(base);
+    unlink(SAMPLES_FILE);
+}
+
+int main(int argc, char **argv)
+{
+    test_parse_samples_line();
+    test_mann_whitney();
+    test_compare();
+
+    puts("all baseline tests passed!");
+    return 0;
+}
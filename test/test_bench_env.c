@@ -0,0 +1,57 @@
+#include "../bench_env.c"
+
+static void test_parse_cpu_list()
+{
+    FILE *err = fopen("/dev/null", "w");
+    cpu_set_t set;
+
+    assert(parse_cpu_list("3", &set, err) == 0);
+    assert(CPU_COUNT(&set) == 1 && CPU_ISSET(3, &set));
+
+    assert(parse_cpu_list("0-3,6", &set, err) == 0);
+    assert(CPU_COUNT(&set) == 5);
+    assert(CPU_ISSET(0, &set) && CPU_ISSET(3, &set) && CPU_ISSET(6, &set));
+    assert(!CPU_ISSET(4, &set));
+
+    assert(parse_cpu_list("", &set, err) == -1);
+    assert(parse_cpu_list("1,", &set, err) == -1);
+    assert(parse_cpu_list("3-1", &set, err) == -1);
+    assert(parse_cpu_list("1-", &set, err) == -1);
+    assert(parse_cpu_list("-1", &set, err) == -1);
+    assert(parse_cpu_list("1;2", &set, err) == -1);
+    assert(parse_cpu_list("100000", &set, err) == -1);
+    fclose(err);
+}
+
+static void test_enter_bench_env()
+{
+    cpu_set_t before, during, after;
+    char governor[64];
+    double mhz;
+    int cpu;
+
+    sched_getaffinity(0, sizeof(before), &before);
+    for (cpu = 0; !CPU_ISSET(cpu, &before); cpu++)
+        ;
+    char list[16];
+    snprintf(list, sizeof(list), "%i", cpu);
+
+    assert(enter_bench_env(list, FALSE, 0, stderr) == 0);
+    sched_getaffinity(0, sizeof(during), &during);
+    assert(CPU_COUNT(&during) == 1 && CPU_ISSET(cpu, &during));
+    assert(describe_bench_cpu(governor, sizeof(governor), &mhz) == cpu);
+    assert(mhz >= 0);
+    leave_bench_env();
+
+    sched_getaffinity(0, sizeof(after), &after);
+    assert(CPU_EQUAL(&before, &after));
+}
+
+int main(int argc, char **argv)
+{
+    test_parse_cpu_list();
+    test_enter_bench_env();
+
+    puts("all bench environment tests passed!");
+    return 0;
+}
@@ -32,6 +32,26 @@ void test_expand_deps(void)
     assert(sb.len == 7);
     assert(strncmp("d b c a", sb.s, 7) == 0);
 
+    // the C helpers go last, with or without other deps
+    tf.perf_c = "perf.c";
+    sb.len = 0;
+    expand_deps(&sb, &tf, NULL);
+    assert(sb.len == 14);
+    assert(strncmp("d b c a perf.c", sb.s, 14) == 0);
+
+    struct TestSet no_deps = {.deps = NULL, .n_deps = 0, .next = NULL};
+    tf.sets = &no_deps;
+    sb.len = 0;
+    expand_deps(&sb, &tf, NULL);
+    assert(sb.len == 6);
+    assert(strncmp("perf.c", sb.s, 6) == 0);
+
+    tf.memory_c = "mem.c";
+    sb.len = 0;
+    expand_deps(&sb, &tf, NULL);
+    assert(sb.len == 12);
+    assert(strncmp("perf.c mem.c", sb.s, 12) == 0);
+
     sb_free(&sb);
 }
 
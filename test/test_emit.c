@@ -0,0 +1,97 @@
+#include "../funit.h"
+#include "../emit.c"
+#include <sys/uio.h>
+
+static int collect_consumer(void *data, const struct iovec *iov, int iovcnt)
+{
+    struct StringBuffer *sb = (struct StringBuffer *)data;
+    for (int i = 0; i < iovcnt; i++)
+        sb_add_nstr(sb, iov[i].iov_base, iov[i].iov_len);
+    return 0;
+}
+
+static void test_spans()
+{
+    static const char text[] = "abcdef";
+    struct StringBuffer sb;
+    struct Emitter em;
+
+    emit_init(&em);
+    emit_span(&em, text, 2);
+    emit_span(&em, text + 2, 2); // adjacent, merged
+    assert(em.n == 1);
+    emit_printf(&em, "<%i>", 42);
+    emit_printf(&em, "<%s>", "x"); // adjacent in scratch, merged
+    assert(em.n == 2);
+    emit_str(&em, "!");
+    assert(em.n == 3);
+    assert(em.len == 4 + 4 + 3 + 1);
+
+    sb_init(&sb, 4);
+    emit_consume(&em, collect_consumer, &sb);
+    assert(sb.len == em.len);
+    assert(strncmp(sb.s, "abcd<42><x>!", sb.len) == 0);
+
+    sb_free(&sb);
+    emit_free(&em);
+}
+
+static void test_write_file()
+{
+    const char *path = "emit-test.out";
+    struct Emitter em;
+    struct stat before, after;
+
+    unlink(path);
+
+    emit_init(&em);
+    emit_str(&em, "program p\n");
+    emit_printf(&em, "end program %s\n", "p");
+
+    assert(emit_write_file(&em, path, stderr) == 1);  // new file
+    assert(stat(path, &before) == 0);
+    assert(emit_write_file(&em, path, stderr) == 0);  // unchanged
+    assert(stat(path, &after) == 0);
+    assert(before.st_ino == after.st_ino);
+
+    emit_str(&em, "! changed\n");
+    assert(emit_write_file(&em, path, stderr) == 1);
+    assert(stat(path, &after) == 0);
+    assert((size_t)after.st_size == em.len);
+
+    emit_free(&em);
+    unlink(path);
+}
+
+static void test_memory_file()
+{
+    struct Emitter em;
+    char path[32], buf[64];
+    FILE *f;
+    int fd;
+
+    emit_init(&em);
+    emit_str(&em, "program p\n");
+    emit_printf(&em, "end program %s\n", "p");
+
+    fd = emit_memory_file(&em, "test.f90", path, sizeof(path), stderr);
+    assert(fd != -1);
+    // readable by name, as a child process would
+    f = fopen(path, "r");
+    assert(f != NULL);
+    assert(fread(buf, 1, sizeof(buf), f) == em.len);
+    assert(!memcmp(buf, "program p\nend program p\n", em.len));
+    fclose(f);
+    close(fd);
+
+    emit_free(&em);
+}
+
+int main(int argc, char **argv)
+{
+    test_spans();
+    test_write_file();
+    test_memory_file();
+
+    puts("all emit tests passed!");
+}
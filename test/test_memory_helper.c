@@ -0,0 +1,42 @@
+#include "../memory_helper.c"
+#include <assert.h>
+#include <stdio.h>
+
+static void test_counts()
+{
+    int64_t before[3], after[3];
+
+    funit_mem_counts(before, 0);
+    funit_mem_counts(after, 0);
+    assert(after[0] >= before[0]);
+    assert(after[1] == before[1]); // reading them doesn't allocate
+
+#ifdef __GLIBC__
+    void *p = malloc(1000);
+    p = realloc(p, 2000);
+    free(calloc(10, 100));
+    funit_mem_counts(after, 0);
+    assert(after[1] - before[1] == 3);
+    assert(after[2] - before[2] == 4000);
+    free(p);
+#endif
+
+    // a new peak starts at the current use
+    if (funit_mem_reset_peak() == 0) {
+        char *big = malloc(64 << 20);
+        memset(big, 1, 64 << 20);
+        funit_mem_counts(before, 0);
+        free(big);
+        funit_mem_counts(after, 1);
+        assert(before[0] >= 64 << 20);
+        assert(after[0] < before[0]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    test_counts();
+
+    puts("all memory helper tests passed!");
+    return 0;
+}
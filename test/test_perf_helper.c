@@ -0,0 +1,37 @@
+#include "../perf_helper.c"
+#include <assert.h>
+
+static void test_counters()
+{
+    char note[256] = "";
+    int64_t before[FUNIT_PERF_EVENTS], after[FUNIT_PERF_EVENTS];
+    volatile double x = 0;
+
+    int n_open = funit_perf_open(note, sizeof(note));
+    assert(n_open >= 0 && n_open <= FUNIT_PERF_EVENTS);
+    if (n_open == 0) { // no counters here, but we must say why
+        assert(note[0] != '\0');
+        funit_perf_read(before);
+        for (int i = 0; i < FUNIT_PERF_EVENTS; i++)
+            assert(before[i] == -1);
+        printf("(counters unavailable: %s)\n", note);
+        return;
+    }
+
+    funit_perf_read(before);
+    for (int i = 0; i < 1000000; i++)
+        x += i;
+    funit_perf_read(after);
+    for (int i = 0; i < FUNIT_PERF_EVENTS; i++)
+        assert(after[i] >= before[i]);
+    if (before[1] >= 0) // instructions
+        assert(after[1] - before[1] >= 1000000);
+}
+
+int main(int argc, char **argv)
+{
+    test_counters();
+
+    puts("all perf helper tests passed!");
+    return 0;
+}
@@ -67,6 +67,14 @@ void test_file_exists()
     assert(!fu_file_exists("does-not-exist"));
 }
 
+void test_hash()
+{
+    // FNV-1a reference values
+    assert(fu_hash("", 0) == 0xcbf29ce484222325ULL);
+    assert(fu_hash("a", 1) == 0xaf63dc4c8601ec8cULL);
+    assert(fu_hash("foobar", 6) == 0x85944171f73967e8ULL);
+}
+
 void test_subfileext()
 {
     char *s = fu_sub_file_ext("foo.exe", ".exe", ".txt");
@@ -82,12 +90,37 @@ void test_subfileext()
     free(s);
 }
 
+static void test_parse_size()
+{
+    const char *s;
+    char *end;
+
+    assert(fu_parse_size("4096", &end) == 4096 && *end == '\0');
+    assert(fu_parse_size("512M", &end) == 512.0 * 1024 * 1024 && !*end);
+    assert(fu_parse_size("20GB", &end) == 20.0 * 1024 * 1024 * 1024 &&
+           !*end);
+    assert(fu_parse_size("1.5gib", &end) == 1.5 * 1024 * 1024 * 1024 &&
+           !*end);
+    assert(fu_parse_size("2kB", &end) == 2048 && !*end);
+    assert(fu_parse_size("1T", &end) == 1024.0 * 1024 * 1024 * 1024 &&
+           !*end);
+
+    s = "3Mx";
+    assert(fu_parse_size(s, &end) == 3.0 * 1024 * 1024 && end == s + 2);
+    s = "GB";
+    assert(fu_parse_size(s, &end) == -1 && end == s);
+    s = "-1G";
+    assert(fu_parse_size(s, &end) == -1 && end == s);
+}
+
 int main(int argc, char **argv)
 {
     test_fu_strndup();
     test_string_buffer();
     test_file_exists();
+    test_hash();
     test_subfileext();
+    test_parse_size();
 
     puts("all util tests passed!");
 }
@@ -1,11 +1,13 @@
 /* Utility functions for FUnit.
  */
 #include "funit.h"
+#include <ctype.h>
 #include <errno.h>
 #include <string.h>
 #include <limits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 char *fu_strndup(const char *str, size_t len)
 {
@@ -38,6 +40,40 @@ int fu_file_exists(const char *path)
     return FALSE;
 }
 
+/* 64-bit FNV-1a hash of a block of memory.
+ */
+uint64_t fu_hash(const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    while (len-- > 0) {
+        h ^= *p++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* write() all len bytes of data to fd, retrying short writes.  Returns 0 on
+ * success or -1 with errno set.
+ */
+int fu_write_all(int fd, const void *data, size_t len)
+{
+    const char *p = data;
+
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
 char *fu_sub_file_ext(const char *path, const char *oldext, const char *newext)
 {
     static char buf[PATH_MAX + 1];
@@ -62,6 +98,36 @@ char *fu_sub_file_ext(const char *path, const char *oldext, const char *newext)
     abort();
 }
 
+/* Parses a memory size like "512M", "20GB" or "1.5GiB" at s, in bytes;
+ * K, M, G and T are powers of 1024 and a plain number is bytes.  Like
+ * strtod, sets *end past the size, or to s if there is none, in which case
+ * it returns -1.
+ */
+double fu_parse_size(const char *s, char **end)
+{
+    static const char units[] = "KMGT";
+    const char *unit;
+    char *e;
+    double size = strtod(s, &e);
+
+    if (e == s || size < 0 || size != size)
+        goto none;
+    if (*e && (unit = strchr(units, toupper((unsigned char)*e)))) {
+        for (int i = 0; i <= unit - units; i++)
+            size *= 1024;
+        e++;
+        if (*e == 'i' && (e[1] == 'B' || e[1] == 'b'))
+            e++;
+    }
+    if (*e == 'B' || *e == 'b')
+        e++;
+    *end = e;
+    return size;
+ none:
+    *end = (char *)s;
+    return -1;
+}
+
 void sb_init(struct StringBuffer *sb, size_t length)
 {
     sb->s = NEWA(char, length);